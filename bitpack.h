@@ -0,0 +1,134 @@
+/****************************************************
+ * BIT PACKING HELPERS
+ * - MSB-first bit writer / reader over a byte buffer
+ * - Exp-Golomb variable-length integers (small = short)
+ * - CRC-8 / CRC-16 for frame and image integrity
+ *
+ * Plain C++ only (no Arduino calls), so the same code
+ * is used by the firmware and by the host tools.
+ ****************************************************/
+
+#ifndef BITPACK_H
+#define BITPACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============= WRITER =============
+
+struct BitWriter {
+  uint8_t* buf;
+  size_t   capBytes;
+  size_t   bitPos;
+  bool     overflow;   // set if a write did not fit
+};
+
+inline void bitsBegin(BitWriter& w, uint8_t* buf, size_t capBytes) {
+  w.buf      = buf;
+  w.capBytes = capBytes;
+  w.bitPos   = 0;
+  w.overflow = false;
+}
+
+// Write the low 'nbits' bits of value (nbits <= 32), MSB first
+inline void bitsPut(BitWriter& w, uint32_t value, int nbits) {
+  for (int i = nbits - 1; i >= 0; i--) {
+    size_t byteIdx = w.bitPos >> 3;
+    if (byteIdx >= w.capBytes) {
+      w.overflow = true;
+      return;
+    }
+    uint8_t mask = 0x80 >> (w.bitPos & 7);
+    if ((value >> i) & 1) {
+      w.buf[byteIdx] |= mask;
+    } else {
+      w.buf[byteIdx] &= ~mask;
+    }
+    w.bitPos++;
+  }
+}
+
+// Exp-Golomb (k=0): 0 -> "1", 1 -> "010", 2 -> "011", 3 -> "00100" ...
+inline void bitsPutVar(BitWriter& w, uint32_t value) {
+  uint32_t v   = value + 1;
+  int      len = 0;
+  while ((v >> len) > 1) len++;
+  bitsPut(w, 0, len);
+  bitsPut(w, v, len + 1);
+}
+
+// Bytes used so far (last byte zero-padded)
+inline size_t bitsBytes(const BitWriter& w) {
+  return (w.bitPos + 7) >> 3;
+}
+
+// ============= READER =============
+
+struct BitReader {
+  const uint8_t* buf;
+  size_t         lenBytes;
+  size_t         bitPos;
+  bool           underflow;   // set if a read ran past the end
+};
+
+inline void bitsBeginRead(BitReader& r, const uint8_t* buf, size_t lenBytes) {
+  r.buf       = buf;
+  r.lenBytes  = lenBytes;
+  r.bitPos    = 0;
+  r.underflow = false;
+}
+
+inline uint32_t bitsGet(BitReader& r, int nbits) {
+  uint32_t value = 0;
+  for (int i = 0; i < nbits; i++) {
+    size_t byteIdx = r.bitPos >> 3;
+    if (byteIdx >= r.lenBytes) {
+      r.underflow = true;
+      return 0;
+    }
+    uint8_t bit = (r.buf[byteIdx] >> (7 - (r.bitPos & 7))) & 1;
+    value = (value << 1) | bit;
+    r.bitPos++;
+  }
+  return value;
+}
+
+inline uint32_t bitsGetVar(BitReader& r) {
+  int len = 0;
+  while (bitsGet(r, 1) == 0) {
+    if (r.underflow || ++len > 31) {
+      r.underflow = true;
+      return 0;
+    }
+  }
+  uint32_t v = (1u << len) | bitsGet(r, len);
+  return v - 1;
+}
+
+// ============= CRC =============
+
+// CRC-8, polynomial 0x07, init 0x00
+inline uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// CRC-16/CCITT-FALSE, polynomial 0x1021, init 0xFFFF
+inline uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/****************************************************
+ * CABINET BUS FRAMES
+ * - Controller <-> cabinet serial bus (RS-485, SDLC
+ *   style) in place of one wire per lamp / detector:
+ *   every tick the controller sends its output frame
+ *   (sigout.h) to the load switches, and the cabinet
+ *   answers with its detector input frame (detin.h)
+ * - HDLC framing: 0x7E flag at both ends, 0x7E / 0x7D
+ *   inside sent as 0x7D, byte ^ 0x20; FCS-16 (the
+ *   X.25 / SDLC CRC) over address .. data, low byte
+ *   first
+ * - Body: address(8) type(8) seq(8) frame(64, LSB
+ *   first). A response has the command's type + 128
+ *   (as NEMA TS 2) and echoes its seq
+ ****************************************************/
+
+#ifndef CABBUS_H
+#define CABBUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============= FRAME LAYOUT =============
+
+const uint8_t CAB_FLAG       = 0x7E;
+const uint8_t CAB_ESCAPE     = 0x7D;
+const uint8_t CAB_ESCAPE_XOR = 0x20;
+
+const uint8_t CAB_ADDR_CABINET = 0x01;   // the one bus interface unit
+
+const uint8_t CAB_TYPE_OUTPUTS = 0;      // controller -> cabinet: load switch drivers
+const uint8_t CAB_TYPE_INPUTS  = 128;    // cabinet -> controller: detector levels
+
+const int CAB_BODY_LEN = 3 + 8;                          // address, type, seq, frame
+const int CAB_MAX_WIRE = 2 + 2 * (CAB_BODY_LEN + 2);     // every byte escaped
+
+struct CabFrame {
+  uint8_t  addr;
+  uint8_t  type;
+  uint8_t  seq;
+  uint64_t data;   // SigFrame or DetFrame
+};
+
+// ============= FCS =============
+
+// FCS-16 (CRC-16/X-25): reflected 0x1021, init 0xFFFF, complemented
+inline uint16_t cabFcs(const uint8_t* data, size_t len) {
+  uint16_t fcs = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    fcs ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      fcs = (fcs & 1) ? (uint16_t)((fcs >> 1) ^ 0x8408) : (uint16_t)(fcs >> 1);
+    }
+  }
+  return (uint16_t)~fcs;
+}
+
+// ============= ENCODE =============
+
+inline size_t cabPutEscaped(uint8_t c, uint8_t* out, size_t n) {
+  if (c == CAB_FLAG || c == CAB_ESCAPE) {
+    out[n++] = CAB_ESCAPE;
+    c ^= CAB_ESCAPE_XOR;
+  }
+  out[n++] = c;
+  return n;
+}
+
+// Wire bytes of one frame; 0 if 'cap' is under CAB_MAX_WIRE
+inline size_t cabEncode(const CabFrame& f, uint8_t* out, size_t cap) {
+  if (cap < (size_t)CAB_MAX_WIRE) return 0;
+  uint8_t body[CAB_BODY_LEN + 2];
+  body[0] = f.addr;
+  body[1] = f.type;
+  body[2] = f.seq;
+  for (int i = 0; i < 8; i++) body[3 + i] = (uint8_t)(f.data >> (8 * i));
+  uint16_t fcs = cabFcs(body, CAB_BODY_LEN);
+  body[CAB_BODY_LEN]     = (uint8_t)fcs;
+  body[CAB_BODY_LEN + 1] = (uint8_t)(fcs >> 8);
+
+  size_t n = 0;
+  out[n++] = CAB_FLAG;
+  for (int i = 0; i < CAB_BODY_LEN + 2; i++) n = cabPutEscaped(body[i], out, n);
+  out[n++] = CAB_FLAG;
+  return n;
+}
+
+// ============= DECODE =============
+
+// Byte-at-a-time receiver: resynchronises on every flag, so a
+// frame cut short by noise costs only that frame
+struct CabDecoder {
+  uint8_t  body[CAB_BODY_LEN + 2];
+  int      len;        // -1 = waiting for a flag
+  bool     escape;
+  uint32_t good;
+  uint32_t bad;        // FCS or length errors
+};
+
+inline void cabDecoderReset(CabDecoder& d) {
+  d.len    = -1;
+  d.escape = false;
+  d.good   = 0;
+  d.bad    = 0;
+}
+
+// True when 'c' completes a valid frame, returned in 'f'
+inline bool cabDecodeByte(CabDecoder& d, uint8_t c, CabFrame& f) {
+  if (c == CAB_FLAG) {
+    bool done = false;
+    if (d.len == CAB_BODY_LEN + 2 && !d.escape) {
+      uint16_t fcs = (uint16_t)(d.body[CAB_BODY_LEN] | d.body[CAB_BODY_LEN + 1] << 8);
+      if (cabFcs(d.body, CAB_BODY_LEN) == fcs) {
+        f.addr = d.body[0];
+        f.type = d.body[1];
+        f.seq  = d.body[2];
+        f.data = 0;
+        for (int i = 0; i < 8; i++) f.data |= (uint64_t)d.body[3 + i] << (8 * i);
+        done = true;
+      }
+    }
+    // Back-to-back flags (idle, or closing + opening) are not errors
+    if (done)             d.good++;
+    else if (d.len > 0)   d.bad++;
+    d.len    = 0;
+    d.escape = false;
+    return done;
+  }
+  if (d.len < 0) return false;
+  if (c == CAB_ESCAPE) {
+    d.escape = true;
+    return false;
+  }
+  if (d.escape) {
+    c ^= CAB_ESCAPE_XOR;
+    d.escape = false;
+  }
+  if (d.len >= CAB_BODY_LEN + 2) {
+    d.bad++;
+    d.len = -1;   // too long: drop until the next flag
+    return false;
+  }
+  d.body[d.len++] = c;
+  return false;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/****************************************************
+ * VEHICLE CLASSIFICATION
+ * - Bins each vehicle crossing an approach's count loop
+ *   by its length: presence time on the loop times its
+ *   speed, less the loop's own length
+ * - Speed comes from a trap loop a fixed distance ahead
+ *   of the count loop (time between the two leading
+ *   edges); without one, or for an implausible time,
+ *   the assumed approach speed is used
+ * - A length past CLASS_MAX_LENGTH_MM is a vehicle that
+ *   slowed or stopped on the loop: unclassified
+ * - Each class has a passenger-car equivalent (PCE, in
+ *   tenths) that main.cpp sums as green time demand;
+ *   unclassified vehicles count as cars
+ ****************************************************/
+
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <stdint.h>
+
+// ============= CLASSES =============
+
+enum VehClass : uint8_t {
+  VEH_CAR,            // cars, vans, pickups
+  VEH_SINGLE_UNIT,    // single-unit trucks, buses
+  VEH_COMBINATION,    // tractor-trailers
+  VEH_UNCLASSIFIED
+};
+
+const int VEH_CLASSES = 4;
+
+struct VehClassInfo {
+  const char* name;
+  int32_t     maxLengthMm;   // upper bound of the bin
+  uint8_t     pceTenths;
+};
+
+// ============= GEOMETRY =============
+
+const int32_t CLASS_LOOP_LENGTH_MM   = 1800;    // 6 ft loop
+const int32_t CLASS_TRAP_SPACING_MM  = 5000;    // trap to count loop, leading edges
+const int32_t CLASS_ASSUMED_SPEED_MM = 11100;   // per s, 40 km/h
+const int32_t CLASS_MIN_SPEED_MM     = 2000;    // per s; slower trap times are stale
+const int32_t CLASS_MAX_SPEED_MM     = 40000;
+const int32_t CLASS_MAX_LENGTH_MM    = 25000;
+
+const VehClassInfo VEH_CLASS_INFO[VEH_CLASSES] = {
+  {"car",           6500, 10},
+  {"single",       12500, 20},
+  {"combo",        CLASS_MAX_LENGTH_MM, 30},
+  {"unclassified", 0,     10},
+};
+
+// ============= CLASSIFIER =============
+
+// One approach's count loop (and trap loop)
+struct VehClassifier {
+  bool    on      = false;   // count loop occupied
+  bool    counted = false;   // that vehicle joined the red queue
+  int64_t onUs    = 0;       // count loop leading edge
+  int64_t trapUs  = -1;      // trap loop leading edge, -1 = none pending
+  int32_t speed   = 0;       // mm/s of the vehicle on the loop
+};
+
+// Speed from the two leading edges, or the assumed one
+inline int32_t vehTrapSpeed(int64_t trapUs, int64_t onUs) {
+  int64_t dt = onUs - trapUs;
+  if (trapUs < 0 || dt <= 0) return CLASS_ASSUMED_SPEED_MM;
+  int64_t speed = (int64_t)CLASS_TRAP_SPACING_MM * 1000000 / dt;
+  if (speed < CLASS_MIN_SPEED_MM || speed > CLASS_MAX_SPEED_MM) return CLASS_ASSUMED_SPEED_MM;
+  return (int32_t)speed;
+}
+
+inline VehClass vehClassify(int64_t occupancyUs, int32_t speed) {
+  int64_t lengthMm = (int64_t)speed * occupancyUs / 1000000 - CLASS_LOOP_LENGTH_MM;
+  for (int c = VEH_CAR; c < VEH_UNCLASSIFIED; c++) {
+    if (lengthMm < VEH_CLASS_INFO[c].maxLengthMm) return (VehClass)c;
+  }
+  return VEH_UNCLASSIFIED;
+}
+
+// Whole PCEs for the green policy, a started one counting in full
+inline int vehPceCount(int pceTenths) {
+  return (pceTenths + 9) / 10;
+}
+
+#endif
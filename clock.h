@@ -0,0 +1,103 @@
+/****************************************************
+ * CLOCK DISCIPLINE
+ * - Keeps a "disciplined" microsecond clock derived
+ *   from the free-running local timer
+ * - Reference samples (GPS PPS edge or NTP sync) give
+ *   (localUs, referenceUs) pairs
+ * - Large errors step the clock; small ones are slewed
+ *   with a PI loop that also estimates the oscillator
+ *   drift (ppm) so the clock stays close between samples
+ * - Metrics: last offset, jitter (EWMA of offset change)
+ *   and estimated drift; a step restarts the first two
+ ****************************************************/
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// ============= CONSTANTS =============
+
+const int64_t CLOCK_STEP_US      = 128000;   // step instead of slew above this
+const double  CLOCK_PHASE_GAIN   = 0.5;      // fraction of offset removed per sample
+const double  CLOCK_FREQ_GAIN    = 0.1;      // fraction of frequency error per sample
+const double  CLOCK_MAX_DRIFT_PPM = 500.0;   // reject estimates beyond crystal spec
+
+// ============= STATE =============
+
+struct ClockDiscipline {
+  bool     locked;
+  int64_t  anchorLocalUs;   // local timer at the last correction
+  int64_t  anchorRefUs;     // disciplined time at that instant
+  double   driftPpm;        // local timer runs this much fast (+) or slow (-)
+
+  // Metrics
+  int64_t  lastOffsetUs;    // reference - disciplined, before correction (0 after a step)
+  uint32_t jitterUs;        // EWMA of |offset change| since the last step
+  uint32_t samples;
+  uint32_t steps;
+};
+
+inline void clockInit(ClockDiscipline& c, int64_t localUs) {
+  c.locked        = false;
+  c.anchorLocalUs = localUs;
+  c.anchorRefUs   = localUs;
+  c.driftPpm      = 0.0;
+  c.lastOffsetUs  = 0;
+  c.jitterUs      = 0;
+  c.samples       = 0;
+  c.steps         = 0;
+}
+
+// Disciplined time for a local timer reading
+inline int64_t clockAt(const ClockDiscipline& c, int64_t localUs) {
+  int64_t elapsed = localUs - c.anchorLocalUs;
+  return c.anchorRefUs + elapsed - (int64_t)((double)elapsed * c.driftPpm * 1e-6);
+}
+
+// Local timer microseconds that make up 'us' of disciplined time
+inline int64_t clockLocalSpan(const ClockDiscipline& c, int64_t us) {
+  return us + (int64_t)((double)us * c.driftPpm * 1e-6);
+}
+
+// Feed one reference sample: at local timer 'localUs' the true time was 'refUs'
+inline void clockSample(ClockDiscipline& c, int64_t localUs, int64_t refUs) {
+  int64_t predicted = clockAt(c, localUs);
+  int64_t offset    = refUs - predicted;
+  int64_t interval  = localUs - c.anchorLocalUs;
+
+  c.samples++;
+
+  if (!c.locked || offset > CLOCK_STEP_US || offset < -CLOCK_STEP_US) {
+    // Step: jump straight to the reference, keep the drift estimate. The
+    // offset history restarts from here: a step is not jitter.
+    c.anchorLocalUs = localUs;
+    c.anchorRefUs   = refUs;
+    c.locked        = true;
+    c.lastOffsetUs  = 0;
+    c.jitterUs      = 0;
+    c.steps++;
+    return;
+  }
+
+  uint64_t change = (uint64_t)(offset > c.lastOffsetUs ? offset - c.lastOffsetUs
+                                                       : c.lastOffsetUs - offset);
+  uint64_t jitter = ((uint64_t)c.jitterUs * 7 + change) / 8;
+  c.jitterUs      = jitter > UINT32_MAX ? UINT32_MAX : (uint32_t)jitter;
+  c.lastOffsetUs  = offset;
+
+  // Frequency: an offset accumulated over 'interval' means we drifted.
+  // Errors no crystal could produce are reference noise, not drift.
+  double freqErrPpm = interval > 0 ? -(double)offset / (double)interval * 1e6 : 0.0;
+  if (freqErrPpm <= CLOCK_MAX_DRIFT_PPM && freqErrPpm >= -CLOCK_MAX_DRIFT_PPM) {
+    c.driftPpm += CLOCK_FREQ_GAIN * freqErrPpm;
+    if (c.driftPpm >  CLOCK_MAX_DRIFT_PPM) c.driftPpm =  CLOCK_MAX_DRIFT_PPM;
+    if (c.driftPpm < -CLOCK_MAX_DRIFT_PPM) c.driftPpm = -CLOCK_MAX_DRIFT_PPM;
+  }
+
+  // Phase: remove part of the offset now, the rest over later samples
+  c.anchorRefUs   = predicted + (int64_t)(CLOCK_PHASE_GAIN * (double)offset);
+  c.anchorLocalUs = localUs;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/****************************************************
+ * PEER COORDINATION MESSAGES
+ * - Neighbouring controllers exchange platoon events
+ *   directly (ESP-NOW on the ESP32, UDP on Linux sim)
+ * - GREEN_START: an approach turned green with 'count'
+ *   vehicles queued, i.e. a platoon is departing
+ * - GREEN_END:   the approach served 'count' vehicles
+ *
+ * Frame layout (MSB first):
+ *   magic(4) type(2) approach(1) srcId(8) seq(8)
+ *   count(8) greenSec(6)   + crc8   = 6 bytes
+ *
+ * A downstream unit tracks the expected platoon arrival
+ * (CoordPlatoon) and may end its cross-street green
+ * early so its own green starts as the platoon arrives.
+ ****************************************************/
+
+#ifndef COORD_H
+#define COORD_H
+
+#include "bitpack.h"
+
+// ============= CONSTANTS =============
+
+const int COORD_MAGIC          = 0xA;
+const int COORD_FRAME_LEN      = 6;
+
+const int COORD_EVT_GREEN_START = 0;
+const int COORD_EVT_GREEN_END   = 1;
+
+const int COORD_APPROACH_NS = 0;
+const int COORD_APPROACH_EW = 1;
+
+const int COORD_HEADWAY_SEC = 2;    // discharge headway within a platoon
+
+// ============= MESSAGE =============
+
+struct CoordEvent {
+  uint8_t type;       // COORD_EVT_*
+  uint8_t approach;   // COORD_APPROACH_*
+  uint8_t srcId;      // sending intersection
+  uint8_t seq;        // per-sender sequence, wraps
+  uint8_t count;      // queued (GREEN_START) or served (GREEN_END)
+  uint8_t greenSec;   // planned green length
+};
+
+inline size_t coordEncode(const CoordEvent& e, uint8_t* out, size_t cap) {
+  BitWriter w;
+  bitsBegin(w, out, cap);
+  bitsPut(w, COORD_MAGIC, 4);
+  bitsPut(w, e.type, 2);
+  bitsPut(w, e.approach, 1);
+  bitsPut(w, e.srcId, 8);
+  bitsPut(w, e.seq, 8);
+  bitsPut(w, e.count, 8);
+  bitsPut(w, e.greenSec, 6);
+
+  size_t n = bitsBytes(w);
+  bitsPut(w, 0, (int)(n * 8 - w.bitPos));
+  if (w.overflow || n + 1 > cap) return 0;
+  out[n] = crc8(out, n);
+  return n + 1;
+}
+
+inline bool coordDecode(const uint8_t* in, size_t len, CoordEvent& e) {
+  if (len != COORD_FRAME_LEN || crc8(in, len - 1) != in[len - 1]) return false;
+
+  BitReader r;
+  bitsBeginRead(r, in, len - 1);
+  if (bitsGet(r, 4) != (uint32_t)COORD_MAGIC) return false;
+  e.type     = (uint8_t)bitsGet(r, 2);
+  e.approach = (uint8_t)bitsGet(r, 1);
+  e.srcId    = (uint8_t)bitsGet(r, 8);
+  e.seq      = (uint8_t)bitsGet(r, 8);
+  e.count    = (uint8_t)bitsGet(r, 8);
+  e.greenSec = (uint8_t)bitsGet(r, 6);
+  return !r.underflow;
+}
+
+// ============= PLATOON TRACKER =============
+
+struct CoordPlatoon {
+  bool active;
+  int  etaSec;    // seconds until the head reaches our stop line
+  int  size;      // vehicles in the platoon
+};
+
+// Upstream green start: its queue will arrive after travelSec
+inline void coordPlatoonDeparted(CoordPlatoon& p, int count, int travelSec) {
+  p.active = count > 0;
+  p.etaSec = travelSec;
+  p.size   = count;
+}
+
+// Called once per second; the platoon expires once its tail has passed
+inline void coordPlatoonTick(CoordPlatoon& p) {
+  if (!p.active) return;
+  p.etaSec--;
+  if (p.etaSec < -p.size * COORD_HEADWAY_SEC) p.active = false;
+}
+
+#endif
@@ -0,0 +1,218 @@
+/****************************************************
+ * COOPERATIVE COROUTINE RUNTIME (C++20)
+ * - Stackless coroutines, frames come from a static
+ *   pool (no heap); a frame that does not fit fails
+ *   cleanly and is counted in coroAllocFailures. The
+ *   task that needed it never runs on as if it had:
+ *   it is parked for good and coroFailed() reports it,
+ *   for the caller to fail safe
+ * - Task: a coroutine that can be co_await-ed by
+ *   another Task (nested phase scripts)
+ * - Scheduler: a few top-level tasks, resumed from
+ *   loop() once per 20 ms tick when their wait is over
+ *
+ *   Task phase() {
+ *     setGreen();
+ *     co_await seconds(10);
+ *     setYellow();
+ *   }
+ ****************************************************/
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <coroutine>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// ============= CONSTANTS =============
+
+const int    CORO_FRAME_SLOTS   = 8;
+const size_t CORO_FRAME_BYTES   = 256;
+const int    CORO_MAX_TASKS     = 6;
+const int    CORO_TICKS_PER_SEC = 50;   // 20 ms tick
+
+// ============= FRAME POOL =============
+
+alignas(16) inline uint8_t coroFramePool[CORO_FRAME_SLOTS][CORO_FRAME_BYTES];
+inline bool     coroFrameUsed[CORO_FRAME_SLOTS];
+inline uint32_t coroAllocFailures = 0;
+inline size_t   coroLargestFrame  = 0;   // for sizing CORO_FRAME_BYTES
+inline int      coroFramesInUse   = 0;
+inline int      coroFramesPeak    = 0;
+
+inline void* coroFrameAlloc(size_t n) {
+  if (n > coroLargestFrame) coroLargestFrame = n;
+  if (n <= CORO_FRAME_BYTES) {
+    for (int i = 0; i < CORO_FRAME_SLOTS; i++) {
+      if (!coroFrameUsed[i]) {
+        coroFrameUsed[i] = true;
+        if (++coroFramesInUse > coroFramesPeak) coroFramesPeak = coroFramesInUse;
+        return coroFramePool[i];
+      }
+    }
+  }
+  coroAllocFailures++;
+  return nullptr;
+}
+
+inline void coroFrameFree(void* p) {
+  int i = (int)(((uint8_t*)p - &coroFramePool[0][0]) / CORO_FRAME_BYTES);
+  if (i >= 0 && i < CORO_FRAME_SLOTS) {
+    coroFrameUsed[i] = false;
+    coroFramesInUse--;
+  }
+}
+
+// ============= TASK =============
+
+inline void coroParkCurrent();
+
+class Task {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    std::coroutine_handle<> await_suspend(Handle h) noexcept {
+      std::coroutine_handle<> next = h.promise().continuation;
+      return next ? next : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  struct promise_type {
+    std::coroutine_handle<> continuation;
+
+    static void* operator new(size_t n) noexcept { return coroFrameAlloc(n); }
+    static void  operator delete(void* p) noexcept { coroFrameFree(p); }
+    static Task  get_return_object_on_allocation_failure() { return Task(nullptr); }
+
+    Task get_return_object() { return Task(Handle::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { abort(); }
+  };
+
+  explicit Task(Handle h) : h_(h) {}
+  Task(Task&& other) noexcept : h_(other.h_) { other.h_ = nullptr; }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { if (h_) h_.destroy(); }
+
+  bool   valid() const { return (bool)h_; }
+  Handle release() { Handle h = h_; h_ = nullptr; return h; }
+
+  // co_await on a Task runs it to completion. A Task whose frame could
+  // not be allocated never runs: the caller is parked instead of going
+  // on as if it had (a script would spin through its loop).
+  bool await_ready() const noexcept { return h_ && h_.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    if (!h_) {
+      coroParkCurrent();
+      return std::noop_coroutine();
+    }
+    h_.promise().continuation = caller;
+    return h_;
+  }
+  void await_resume() noexcept {}
+
+ private:
+  Handle h_;
+};
+
+// ============= SCHEDULER =============
+
+struct CoroSlot {
+  Task::Handle            root;      // owned top-level coroutine
+  std::coroutine_handle<> waiting;   // innermost coroutine to resume
+  uint32_t                wakeTick;
+  bool                    parked;    // awaited a Task with no frame: never resumed
+};
+
+inline CoroSlot coroSlots[CORO_MAX_TASKS];
+inline int      coroCurrent = -1;    // slot being resumed
+inline uint32_t coroTick    = 0;
+inline uint32_t coroSpawnFailures = 0;   // tasks that never started
+
+// Optional hook around every resume (tracing): begin, then !begin
+inline void (*coroResumeHook)(int slot, bool begin) = nullptr;
+
+inline uint32_t coroTicks() { return coroTick; }
+
+// Start a top-level task on the next coroRunDue(); returns slot or -1
+inline int coroSpawn(Task&& t) {
+  for (int i = 0; t.valid() && i < CORO_MAX_TASKS; i++) {
+    if (!coroSlots[i].root) {
+      coroSlots[i].root     = t.release();
+      coroSlots[i].waiting  = coroSlots[i].root;
+      coroSlots[i].wakeTick = coroTick;
+      coroSlots[i].parked   = false;
+      return i;
+    }
+  }
+  coroSpawnFailures++;
+  return -1;
+}
+
+// Destroy a top-level task (and any Task it is awaiting)
+inline void coroCancel(int slot) {
+  if (slot < 0 || slot >= CORO_MAX_TASKS || !coroSlots[slot].root) return;
+  coroSlots[slot].root.destroy();
+  coroSlots[slot].root    = nullptr;
+  coroSlots[slot].waiting = nullptr;
+  coroSlots[slot].parked  = false;
+}
+
+inline void coroParkCurrent() {
+  if (coroCurrent >= 0) coroSlots[coroCurrent].parked = true;
+}
+
+// A task did not start, or one stopped for want of a frame
+inline bool coroFailed() {
+  if (coroSpawnFailures > 0) return true;
+  for (int i = 0; i < CORO_MAX_TASKS; i++) {
+    if (coroSlots[i].parked) return true;
+  }
+  return false;
+}
+
+// Resume every task whose wait has expired, in slot order
+inline void coroRunDue() {
+  for (int i = 0; i < CORO_MAX_TASKS; i++) {
+    CoroSlot& s = coroSlots[i];
+    if (!s.root || s.parked || (int32_t)(coroTick - s.wakeTick) < 0) continue;
+
+    if (coroResumeHook) coroResumeHook(i, true);
+    coroCurrent = i;
+    s.waiting.resume();
+    coroCurrent = -1;
+    if (coroResumeHook) coroResumeHook(i, false);
+
+    if (s.root && s.root.done()) coroCancel(i);
+  }
+}
+
+inline void coroAdvanceTick() { coroTick++; }
+
+// ============= AWAITABLES =============
+
+struct TickAwaiter {
+  uint32_t ticks;
+
+  bool await_ready() const noexcept { return ticks == 0 || coroCurrent < 0; }
+  void await_suspend(std::coroutine_handle<> h) noexcept {
+    coroSlots[coroCurrent].waiting  = h;
+    coroSlots[coroCurrent].wakeTick = coroTick + ticks;
+  }
+  void await_resume() noexcept {}
+};
+
+inline TickAwaiter ticks(uint32_t n)        { return TickAwaiter{n}; }
+inline TickAwaiter seconds(uint32_t n)      { return TickAwaiter{n * CORO_TICKS_PER_SEC}; }
+inline TickAwaiter milliseconds(uint32_t n) { return TickAwaiter{n / (1000 / CORO_TICKS_PER_SEC)}; }
+
+#endif
@@ -0,0 +1,14 @@
+// Generated by tools/plan_compiler from plans/default.plan - do not edit
+#ifndef DEFAULT_PLAN_H
+#define DEFAULT_PLAN_H
+
+#include <stdint.h>
+
+const uint8_t DEFAULT_PLAN[43] = {
+  0x54, 0x50, 0x01, 0x00, 0x2B, 0x00, 0xFB, 0x08, 0x03, 0x08, 0x05, 0x02,
+  0x0A, 0x03, 0x05, 0x0A, 0x0A, 0x14, 0x0F, 0x1E, 0x0A, 0x03, 0x05, 0x0A,
+  0x0A, 0x14, 0x0F, 0x1E, 0x07, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x01,
+  0x01, 0x02, 0x01, 0x03, 0x00, 0x04, 0x00
+};
+
+#endif
@@ -0,0 +1,110 @@
+/****************************************************
+ * DETECTOR INPUT FRAME
+ * - All detector / button inputs are read in one bulk
+ *   scan per tick into a frame, input n = bit n; edges
+ *   for every input come from two frames with a few
+ *   bitwise ops, whatever the input count. A press
+ *   stays pending until it is taken, so a scan between
+ *   ticks cannot lose one
+ * - Inputs are active low (pull-ups): bit 0 = pressed,
+ *   except the rail call's normally-closed contact,
+ *   which is low while there is NO train
+ * - Backends (main.cpp, DETECTOR_INPUT):
+ *     GPIO      one pin per input (buttons, rail call
+ *               contacts, trap and stop-line loops)
+ *     HC165     cascaded 74HC165 read over SPI; input n
+ *               is D(n % 8) of register n / 8, register
+ *               0 being the one wired to MISO
+ *     MCP23017  16 inputs per I2C expander (GPA(n % 8),
+ *               GPB(n % 8) of expander n / 16), read
+ *               only after interrupt-on-change
+ ****************************************************/
+
+#ifndef DETIN_H
+#define DETIN_H
+
+#include <stdint.h>
+
+// ============= INPUTS =============
+
+const int DET_NS      = 0;   // NS vehicle count
+const int DET_EW      = 1;   // EW vehicle count
+const int DET_PED     = 2;   // pedestrian request
+const int DET_RAIL    = 3;   // railroad call, NC contact (open while active)
+const int DET_NS_TRAP = 4;   // NS speed trap loop, ahead of the count loop
+const int DET_EW_TRAP = 5;   // EW speed trap loop
+const int DET_NS_STOP = 6;   // NS stop-line loop, just past the stop bar
+const int DET_EW_STOP = 7;   // EW stop-line loop
+const int DET_RAIL_CHECK  = 8;   // railroad call, NO contact (low while active)
+const int DET_HEAD_INPUTS = 9;   // inputs of one intersection
+
+const int DET_MAX_INPUTS = 64;   // frame width
+const int DET_MAX_HC165  = DET_MAX_INPUTS / 8;
+
+// MCP23017 input registers (IOCON.BANK = 0, sequential addressing)
+const uint8_t MCP23017_GPINTENA = 0x04;
+const uint8_t MCP23017_IOCON    = 0x0A;
+const uint8_t MCP23017_GPPUA    = 0x0C;
+const uint8_t MCP23017_INTFA    = 0x0E;   // INTF A/B, INTCAP A/B, GPIO A/B follow
+
+const uint8_t MCP23017_IOCON_MIRROR = 0x40;   // INTA = INTA | INTB
+const uint8_t MCP23017_IOCON_ODR    = 0x04;   // open-drain INT, wired-OR across chips
+
+const int DET_MCP_INT_REGS = 6;   // bytes read from INTFA on
+
+typedef uint64_t DetFrame;
+
+struct DetScan {
+  DetFrame level;   // last scan (1 = released)
+  DetFrame fell;    // pressed, not taken yet
+};
+
+// ============= EDGES =============
+
+// Returns the inputs pressed since the previous scan
+inline DetFrame detUpdate(DetScan& s, DetFrame level) {
+  DetFrame fell = s.level & ~level;
+  s.fell  |= fell;
+  s.level  = level;
+  return fell;
+}
+
+inline bool detIsLow(const DetScan& s, int in) {
+  return !((s.level >> in) & 1);
+}
+
+inline bool detTakeFell(DetScan& s, int in) {
+  DetFrame bit = (DetFrame)1 << in;
+  bool     hit = (s.fell & bit) != 0;
+  s.fell &= ~bit;
+  return hit;
+}
+
+// ============= BACKEND FRAMES =============
+
+// Bytes as read over SPI: register 0 (on MISO) comes first
+inline DetFrame detUnpackHc165(const uint8_t* in, int chips) {
+  DetFrame f = ~(DetFrame)0;
+  for (int i = 0; i < chips; i++) {
+    f &= ~((DetFrame)0xFF << (8 * i));
+    f |= (DetFrame)in[i] << (8 * i);
+  }
+  return f;
+}
+
+// INTFA..GPIOB of one expander -> its 16 inputs. An input that
+// interrupted on a falling level reads low even if it has been
+// released again, so a press shorter than a tick still counts.
+inline uint16_t detMcpPorts(const uint8_t* regs) {
+  uint16_t intf = (uint16_t)(regs[0] | regs[1] << 8);
+  uint16_t cap  = (uint16_t)(regs[2] | regs[3] << 8);
+  uint16_t gpio = (uint16_t)(regs[4] | regs[5] << 8);
+  return gpio & ~(intf & ~cap);
+}
+
+inline DetFrame detWithMcp(DetFrame f, int chip, uint16_t ports) {
+  f &= ~((DetFrame)0xFFFF << (16 * chip));
+  return f | (DetFrame)ports << (16 * chip);
+}
+
+#endif
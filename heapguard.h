@@ -0,0 +1,71 @@
+/****************************************************
+ * ZERO-HEAP GUARD
+ * - After setup() the control loop must not allocate;
+ *   the allocation hooks in main.cpp report every later
+ *   allocation made on the loop task here
+ * - Call sites are kept in a small fixed table (count,
+ *   last size); a PC of 0 is an allocation seen only by
+ *   the IDF malloc hook, whose caller is not known
+ * - Resolve site PCs with addr2line against the ELF
+ * - The recording path is IRAM_ATTR: the IDF malloc
+ *   hook may run with the flash cache disabled
+ ****************************************************/
+
+#ifndef HEAPGUARD_H
+#define HEAPGUARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ESP_PLATFORM
+#include <esp_attr.h>
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// ============= CONSTANTS =============
+
+const int HEAP_SITE_SLOTS = 16;
+
+// ============= SITE TABLE =============
+
+struct HeapSite {
+  uintptr_t pc;
+  uint32_t  count;
+  uint32_t  lastBytes;
+};
+
+inline HeapSite heapSites[HEAP_SITE_SLOTS];
+inline int      heapSiteCount  = 0;
+inline uint32_t heapSitesLost  = 0;       // allocations from sites that did not fit
+inline uint32_t heapAllocCount = 0;       // allocations after arming
+inline uint32_t heapAllocBytes = 0;
+inline bool     heapGuardArmed = false;   // set at the end of setup()
+
+// Return address -> code address (Xtensa keeps the call window in the top bits)
+inline uintptr_t heapCallerPc(void* ra) {
+#if defined(__XTENSA__)
+  return ((uintptr_t)ra & 0x3FFFFFFF) | 0x40000000;
+#else
+  return (uintptr_t)ra;
+#endif
+}
+
+inline void IRAM_ATTR heapGuardRecord(uintptr_t pc, size_t bytes) {
+  heapAllocCount++;
+  heapAllocBytes += (uint32_t)bytes;
+  for (int i = 0; i < heapSiteCount; i++) {
+    if (heapSites[i].pc == pc) {
+      heapSites[i].count++;
+      heapSites[i].lastBytes = (uint32_t)bytes;
+      return;
+    }
+  }
+  if (heapSiteCount == HEAP_SITE_SLOTS) {
+    heapSitesLost++;
+    return;
+  }
+  heapSites[heapSiteCount++] = HeapSite{pc, 1, (uint32_t)bytes};
+}
+
+#endif
@@ -0,0 +1,171 @@
+/****************************************************
+ * INPUT-TO-OUTPUT LATENCY
+ * - A detector / ped-button edge is stamped in its GPIO
+ *   interrupt; the loop then stamps three stages:
+ *     COUNT   press registered (count / ped latch)
+ *     LCD     LCD finished showing it
+ *     SIGNAL  the served movement turned green / WALK
+ *   (railroad preemption: COUNT = call taken, SIGNAL =
+ *   clearance started)
+ * - A peer coordination frame is stamped (esp_timer) in
+ *   the ESP-NOW receive callback; COUNT is the frame
+ *   applied to the platoon tracking, it has no others
+ * - Stamps pair the CPU cycle counter (exact, wraps in
+ *   ~17 s at 240 MHz) with the 64-bit esp_timer; spans
+ *   longer than LAT_CYCLE_SPAN_US use the latter
+ * - Per input and stage: log2 histogram of microseconds
+ *   (bucket b holds [2^b, 2^(b+1)) us), min / max / mean
+ * - The last LAT_LOG_SIZE events are kept individually
+ ****************************************************/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// ============= CONSTANTS =============
+
+const int LAT_IN_NS   = 0;
+const int LAT_IN_EW   = 1;
+const int LAT_IN_PED  = 2;
+const int LAT_IN_RAIL  = 3;
+const int LAT_IN_COORD = 4;
+const int LAT_PIN_INPUTS = 4;   // inputs stamped at a pin / detector edge
+const int LAT_INPUTS     = 5;
+
+const int LAT_STAGE_COUNT  = 0;
+const int LAT_STAGE_LCD    = 1;
+const int LAT_STAGE_SIGNAL = 2;
+const int LAT_STAGES       = 3;
+
+const int      LAT_BUCKETS       = 32;
+const int      LAT_OPEN_SLOTS    = 8;          // presses waiting for their green, per input
+const int      LAT_LOG_SIZE      = 32;
+const int64_t  LAT_CYCLE_SPAN_US = 8000000;    // cycle deltas trusted below this
+const uint32_t LAT_NONE          = 0xFFFFFFFF;  // stage not reached (yet)
+
+// ============= TYPES =============
+
+struct LatStamp {
+  uint32_t cycles;
+  int64_t  us;
+};
+
+struct LatHistogram {
+  uint32_t buckets[LAT_BUCKETS];
+  uint32_t n;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+struct LatEvent {
+  uint8_t  input;
+  uint32_t stageUs[LAT_STAGES];   // from the edge; LAT_NONE if not reached
+};
+
+struct LatOpen {
+  uint32_t seq;    // log sequence number of the event
+  LatStamp edge;
+};
+
+// ============= STATE =============
+
+inline LatHistogram latHist[LAT_INPUTS][LAT_STAGES];
+inline LatOpen      latOpen[LAT_INPUTS][LAT_OPEN_SLOTS];
+inline int          latOpenCount[LAT_INPUTS];
+inline uint32_t     latOpenDropped = 0;   // presses that found the open list full
+inline LatEvent     latLog[LAT_LOG_SIZE];
+inline uint32_t     latLogHead = 0;       // events ever logged
+inline uint32_t     latCpuMhz  = 240;
+
+// ============= HISTOGRAM =============
+
+inline int latBucket(uint32_t us) {
+  return us == 0 ? 0 : 31 - __builtin_clz(us);
+}
+
+inline void latAdd(LatHistogram& h, uint32_t us) {
+  if (h.n == 0 || us < h.minUs) h.minUs = us;
+  if (us > h.maxUs) h.maxUs = us;
+  h.buckets[latBucket(us)]++;
+  h.sumUs += us;
+  h.n++;
+}
+
+// Upper edge of the bucket holding the pct-th percentile
+inline uint32_t latPercentileUs(const LatHistogram& h, int pct) {
+  uint32_t want = (uint32_t)(((uint64_t)h.n * pct + 99) / 100);
+  uint32_t seen = 0;
+  for (int b = 0; b < LAT_BUCKETS; b++) {
+    seen += h.buckets[b];
+    if (seen >= want && seen > 0) {
+      uint32_t edge = b >= 31 ? 0xFFFFFFFF : (2u << b) - 1;
+      return edge < h.maxUs ? edge : h.maxUs;
+    }
+  }
+  return h.maxUs;
+}
+
+// ============= EVENTS =============
+
+inline uint32_t latElapsedUs(const LatStamp& from, const LatStamp& to) {
+  int64_t us = to.us - from.us;
+  if (us < 0) return 0;
+  if (us < LAT_CYCLE_SPAN_US) return (to.cycles - from.cycles) / latCpuMhz;
+  return us > 0xFFFFFFFE ? 0xFFFFFFFE : (uint32_t)us;
+}
+
+inline LatEvent* latEventFor(uint32_t seq) {
+  if (latLogHead - seq > (uint32_t)LAT_LOG_SIZE || seq >= latLogHead) return nullptr;
+  return &latLog[seq % LAT_LOG_SIZE];
+}
+
+inline void latStage(int input, uint32_t seq, const LatStamp& edge, int stage,
+                     const LatStamp& now) {
+  uint32_t us = latElapsedUs(edge, now);
+  latAdd(latHist[input][stage], us);
+  LatEvent* e = latEventFor(seq);
+  if (e) e->stageUs[stage] = us;
+}
+
+// Input taken: logs the event, records COUNT, returns its seq
+inline uint32_t latApplied(int input, const LatStamp& edge, const LatStamp& now) {
+  uint32_t  seq = latLogHead++;
+  LatEvent& e   = latLog[seq % LAT_LOG_SIZE];
+  e.input = (uint8_t)input;
+  for (int s = 0; s < LAT_STAGES; s++) e.stageUs[s] = LAT_NONE;
+  latStage(input, seq, edge, LAT_STAGE_COUNT, now);
+  return seq;
+}
+
+// Press registered: as latApplied(), and waits for its green
+inline uint32_t latPress(int input, const LatStamp& edge, const LatStamp& now) {
+  uint32_t seq = latApplied(input, edge, now);
+  if (latOpenCount[input] < LAT_OPEN_SLOTS) {
+    latOpen[input][latOpenCount[input]++] = LatOpen{seq, edge};
+  } else {
+    latOpenDropped++;
+  }
+  return seq;
+}
+
+// The movement serving 'input' started: closes every waiting press
+inline void latSignal(int input, const LatStamp& now) {
+  for (int i = 0; i < latOpenCount[input]; i++) {
+    const LatOpen& o = latOpen[input][i];
+    latStage(input, o.seq, o.edge, LAT_STAGE_SIGNAL, now);
+  }
+  latOpenCount[input] = 0;
+}
+
+inline void latReset() {
+  for (int i = 0; i < LAT_INPUTS; i++) {
+    for (int s = 0; s < LAT_STAGES; s++) latHist[i][s] = LatHistogram{};
+    latOpenCount[i] = 0;
+  }
+  latOpenDropped = 0;
+  latLogHead     = 0;
+}
+
+#endif
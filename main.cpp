@@ -1,7 +1,13 @@
 /****************************************************
  * SMART TRAFFIC LIGHT USING ESP32 + LCD
  * - NO millis() USED
- * - waitOneSecondWithButtons() used for timing
+ * - Phase functions are coroutine scripts (coro.h):
+ *   "co_await countdownSecond()" is the 1-second tick;
+ *   detectors, network and housekeeping run as separate
+ *   tasks every 20 ms, paced by deadlines on the
+ *   local timer at the disciplined rate (clock.h). A
+ *   task left without a frame puts every head into red
+ *   flash (failFlashPoll()) instead of freezing them
  * - Vehicle counts taken ONLY when road is RED
  * - During GREEN:
  *      Line1: NSG/EWG base+extra (e.g., "NSG 10+20s")
@@ -10,18 +16,378 @@
  *      Next inter-road phase is pedestrian green,
  *      then only opposite road's green.
  *
- * NEW GREEN-TIME ADAPTATION (for BOTH roads):
- *   Base green = 10 s
- *   +10 s for count >= 5
- *   +20 s for count >= 10
- *   +30 s for count >= 15
+ * TIMING PLAN (see phaseprog.h, plans/default.plan):
+ *   Phase order, yellow / walk times and the green-time
+ *   adaptation come from a compiled plan image run by
+ *   phaseScript(). The built-in default plan:
+ *     Base green = 10 s (both roads)
+ *     +10 s for count >= 5
+ *     +20 s for count >= 10
+ *     +30 s for count >= 15
+ *   "PLAN <hex>" on Serial uploads a new plan; it is
+ *   verified, takes over when the running plan wraps
+ *   around its cycle, and is stored in NVS by a
+ *   low-priority task on core 0 (a write can take far
+ *   longer than a tick).
+ *
+ * LPWAN UPLINK (see uplink.h):
+ *   Every 60 s a bit-packed status frame (phase plan,
+ *   served volumes, faults) is sent as "UL <hex>" on
+ *   Serial (stand-in for the LoRa modem UART). Frames are
+ *   deltas against the last state the gateway ACKed
+ *   ("ACK <seq>"), with a periodic FULL frame.
+ *
+ * SPaT BROADCAST (see spat.h):
+ *   Every 100 ms (every 5th button poll) the state and
+ *   time-to-change of NS, EW and pedestrian movements is
+ *   broadcast as a bit-packed UDP datagram.
+ *
+ * TIME-TO-CHANGE (see ttc.h):
+ *   min/likely/max time until each movement changes is
+ *   predicted from the current phase, counts and ped
+ *   latch; used by SPaT and the ped-request display.
+ *
+ * PEER COORDINATION (see coord.h):
+ *   NS/EW green start/end events are broadcast over
+ *   ESP-NOW. When the upstream unit releases an NS
+ *   platoon, EW green may end early (never below base
+ *   green) so NS green starts as the platoon arrives.
+ *
+ * CLOCK DISCIPLINE (see clock.h):
+ *   The ESP32 timer is steered to GPS PPS (GPIO27) or,
+ *   without PPS, to NTP; drift is estimated and
+ *   compensated. "CLK" on Serial prints offset, jitter
+ *   and drift.
+ *
+ * EVENT TRACE (see tracebuf.h):
+ *   "TRACE ON" records ticks, task resumes, phases,
+ *   button passes and every LCD I2C transaction into a
+ *   RAM ring; "TRACE" dumps it as "TR <hex>" lines for
+ *   tools/trace_export (Chrome / Perfetto JSON).
+ *
+ * SAMPLING PROFILER (see profiler.h):
+ *   "PROF ON" samples the interrupted PC from a ~1 kHz
+ *   timer interrupt until the buffer is full; "PROF"
+ *   dumps "PF <hex>" lines for tools/prof_symbolize
+ *   (addr2line against the ELF). Off = timer stopped.
+ *
+ * ZERO-HEAP GUARD (see heapguard.h):
+ *   A debug build with HEAP_GUARD >= 1 (default 0)
+ *   counts every allocation on the loop task after
+ *   setup() per call site (and raises FAULT_HEAP_ALLOC);
+ *   HEAP_GUARD 2 aborts on it for a backtrace. "RAM"
+ *   prints static, heap, stack high-water and
+ *   coroutine pool usage.
+ *
+ * INPUT LATENCY (see latency.h):
+ *   Button edges are stamped in GPIO interrupts (cycle
+ *   counter); count registered, LCD shown and the served
+ *   green / WALK are stamped against them, and peer
+ *   coordination frames from receipt to applied. "LAT"
+ *   prints per-input log2 histograms, "LAT EV" the last
+ *   events, "LAT RESET" clears.
+ *
+ * SIGNAL OUTPUTS (see sigout.h):
+ *   The state helpers build one frame of all lamp
+ *   outputs and commit it at once. SIGNAL_OUTPUT picks
+ *   the backend: direct GPIO (the LEDs below), a
+ *   74HC595 chain over SPI DMA whose latch pulse
+ *   switches every head together, or MCP23017 I2C
+ *   expanders. "SIG" prints the frame.
+ *
+ * DETECTOR INPUTS (see detin.h):
+ *   All inputs are read in one bulk scan per tick and
+ *   edge-detected as one frame. DETECTOR_INPUT picks
+ *   the backend: the buttons on GPIO, a 74HC165 chain
+ *   on the same SPI bus as the 74HC595s, or MCP23017
+ *   expanders read only after interrupt-on-change.
+ *   "DET" prints the frame and the read count.
+ *
+ * CABINET BUS (see cabbus.h):
+ *   SIGNAL_OUTPUT / DETECTOR_INPUT 3 replace the wires
+ *   with an RS-485 bus: at the end of every tick the
+ *   output frame is sent to the cabinet in one HDLC
+ *   frame with FCS, and the cabinet's answer (read by
+ *   the next detector scan) carries the input frame. A
+ *   silent cabinet releases all inputs and raises
+ *   FAULT_DETECTOR_IN. "BUS" prints frame counters;
+ *   tools/cabinet_sim plays the cabinet for the sim.
+ *
+ * MULTIPLE INTERSECTIONS:
+ *   INTERSECTIONS > 1 runs that many independent
+ *   controllers on the board, each with its own phase
+ *   script, plan, counts, uplink / SPaT / coordination
+ *   id (intersectionId + n) and LCD page; pages rotate
+ *   every 4 s. Unit n owns outputs from n * 8 and
+ *   inputs from n * 9 in the frames, so it needs the
+ *   expander or shift-register backends. Serial
+ *   commands take the unit after the keyword
+ *   ("PLAN1 <hex>", "ACK1 <seq>"); unit 0 has none.
+ *
+ * RAILROAD PREEMPTION (see rail.h):
+ *   The crossing's call relay is wired as a supervised
+ *   pair: its normally-closed contact to the rail input
+ *   (GPIO26, held low while NO train is signalled) and
+ *   its normally-open contact to the check input
+ *   (GPIO17, low while a train is), both to GND. Either
+ *   one calls, so a cut wire, a lost contact or a
+ *   de-energised relay preempts; contacts that disagree
+ *   for 0.5 s raise FAULT_DETECTOR_IN and "RAIL FAULT".
+ *   A call drops the phase script at once:
+ *   a conflicting green goes to yellow, WALK to its
+ *   clearance, on the scan that sees the call. Then,
+ *   after a red clearance (at least 1 s after a yellow),
+ *   the approach crossing the tracks gets a track
+ *   clearance green, and the hold keeps it and the
+ *   pedestrians red (the parallel approach dwells
+ *   green) until the call ends; the plan resumes with
+ *   the track approach. Input-to-clearance time is kept in the
+ *   LAT "rail" stages and checked against a 40 ms
+ *   bound; "RAIL" prints the state and counters.
+ *
+ * WEATHER-RESPONSIVE TIMING (see weather.h):
+ *   A road weather sensor's wet / ice contacts pick a
+ *   dry / wet / ice profile that lengthens yellow, adds
+ *   an all-red after every yellow and stretches greens
+ *   for the lower saturation flow. A worse surface is
+ *   taken after 5 s, a better one only after 5 min.
+ *   Each unit switches its timing at the next phase
+ *   boundary, never within an interval. "WEATHER dry /
+ *   wet / ice" stands in for the sensor, "WEATHER auto"
+ *   returns to it; "WEATHER" prints the state.
+ *
+ * VEHICLE CLASSIFICATION (see classify.h):
+ *   Each vehicle is binned (car / single-unit / combo)
+ *   by its length, from its time on the count loop and
+ *   its speed over the trap loop ahead of it (assumed
+ *   40 km/h without one). Queue demand is kept in
+ *   passenger-car equivalents: a counted vehicle adds a
+ *   car at once and its class correction when it leaves
+ *   the loop; greens follow the PCE demand. "CLASS"
+ *   prints the counts per class.
+ *
+ * RED-LIGHT RUNNING (see rlr.h):
+ *   A stop-line loop just past each stop bar sees
+ *   vehicles entering. One arriving while its approach
+ *   is red (past a 100 ms grace) is logged with its
+ *   time into red and the yellow before it, in ms, and
+ *   with RLR_CAMERA pulses the enforcement camera
+ *   trigger. GPIO loops are judged in their interrupt,
+ *   other backends' at the scan that reads them. "RLR"
+ *   prints the counts and the last violations.
+ *
+ * RE-IDENTIFICATION TRAVEL TIMES (see reid.h):
+ *   Built with REID_SCAN 1, BLE advertisements are
+ *   scanned passively by the BT tasks on core 0 (the
+ *   control loop runs on core 1) and each device heard
+ *   is reduced there to a salted hash; the salt rotates
+ *   every 15 min. New sightings go out over ESP-NOW
+ *   every 2 s. A device a neighbour saw and then this
+ *   unit is one trip; "REID" prints per neighbour the
+ *   trips, median and fastest travel time and the delay
+ *   (median - fastest). The corridor key is
+ *   provisioned in NVS ("REIDKEY <32 hex>" at
+ *   commissioning, never printed); scanning starts once
+ *   it is set and NTP has given true time.
+ *
+ * SNMP / NTCIP 1202 (see snmp.h, ntcip.h):
+ *   A read-only SNMPv2c agent on UDP 161 serves phase
+ *   timings, phase / detector status, calls and
+ *   per-minute detector volumes as NTCIP 1202 objects.
+ *   Community "public" reads unit 0, "public<n>" unit
+ *   n. Requests are taken from a raw lwIP socket (no
+ *   WiFiUDP: it allocates per datagram). "SNMP" prints
+ *   counters; tools/snmp_client walks the tree.
  ****************************************************/
 
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <esp_now.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <esp_cpu.h>
+#include <driver/spi_master.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <lwip/sockets.h>
+#include <sys/time.h>
+#include <new>
+
+#include "uplink.h"
+#include "spat.h"
+#include "ttc.h"
+#include "coord.h"
+#include "clock.h"
+#include "coro.h"
+#include "phaseprog.h"
+#include "default_plan.h"
+#include "tracebuf.h"
+#include "profiler.h"
+#include "heapguard.h"
+#include "latency.h"
+#include "sigout.h"
+#include "detin.h"
+#include "cabbus.h"
+#include "ntcip.h"
+#include "weather.h"
+#include "rail.h"
+#include "classify.h"
+#include "reid.h"
+#include "rlr.h"
+
+// 0 = off (no operator new / delete replacement), 1 = record
+// allocations after setup(), 2 = also abort
+#ifndef HEAP_GUARD
+#define HEAP_GUARD 0
+#endif
+
+// 0 = LEDs on GPIO, 1 = 74HC595 chain over SPI (DMA), 2 = MCP23017 expanders,
+// 3 = cabinet bus (load switches over RS-485)
+#ifndef SIGNAL_OUTPUT
+#define SIGNAL_OUTPUT 0
+#endif
+
+// 0 = buttons on GPIO, 1 = 74HC165 chain over SPI, 2 = MCP23017 expanders,
+// 3 = cabinet bus (detectors over RS-485)
+#ifndef DETECTOR_INPUT
+#define DETECTOR_INPUT 0
+#endif
+
+#if DETECTOR_INPUT == 1 && SIGNAL_OUTPUT == 0
+#error "the 74HC165 chain uses VSPI pins that the GPIO LEDs occupy"
+#endif
+
+#if (SIGNAL_OUTPUT == 3) != (DETECTOR_INPUT == 3)
+#error "the cabinet bus carries outputs and inputs in one exchange: use it for both"
+#endif
+
+// Intersections run by this board; more than one needs the
+// expander / shift-register outputs and inputs (GPIO has one set)
+#ifndef INTERSECTIONS
+#define INTERSECTIONS 1
+#endif
+
+#if INTERSECTIONS > 1 && (SIGNAL_OUTPUT == 0 || DETECTOR_INPUT == 0)
+#error "INTERSECTIONS > 1 needs SIGNAL_OUTPUT and DETECTOR_INPUT other than GPIO"
+#endif
+
+// 1 = pulse an enforcement camera trigger on red-light violations
+// (GPIO25, the cabinet bus transceiver's DE in bus builds)
+#ifndef RLR_CAMERA
+#define RLR_CAMERA (SIGNAL_OUTPUT != 3)
+#endif
+
+#if RLR_CAMERA && SIGNAL_OUTPUT == 3
+#error "the camera trigger pin is the cabinet bus DE: build with RLR_CAMERA 0"
+#endif
+
+// Stop-line loops wired to GPIO34 / GPIO16 (see PIN_STOP_NS)
+#define RLR_STOP_GPIO (DETECTOR_INPUT == 0)
+
+#if RLR_STOP_GPIO && (DETECTOR_INPUT == 2 || DETECTOR_INPUT == 3 || SIGNAL_OUTPUT == 3)
+#error "the GPIO stop-line loops are the expander INT / cabinet bus RX pins"
+#endif
+
+// 1 = passive BLE scan for re-identification travel times (reid.h)
+#ifndef REID_SCAN
+#define REID_SCAN 1
+#endif
+
+#if REID_SCAN
+#include <esp_bt.h>
+#include <esp_bt_main.h>
+#include <esp_gap_ble_api.h>
+#endif
 
 // -------- LCD CONFIG (I2C on GPIO32=SDA, GPIO33=SCL) --------
-LiquidCrystal_I2C lcd(0x27, 16, 2);   // Change address to 0x3F if needed
+void traceMark(uint8_t kind, uint8_t id, uint16_t arg = 0);
+
+// Each LCD command / character is its own I2C transfer; trace them
+class TracedLcd : public LiquidCrystal_I2C {
+ public:
+  using LiquidCrystal_I2C::LiquidCrystal_I2C;
+
+  void clear() {
+    traceMark(TRACE_BEGIN, TRACE_ID_LCD_CLEAR);
+    LiquidCrystal_I2C::clear();
+    traceMark(TRACE_END, TRACE_ID_LCD_CLEAR);
+  }
+  void setCursor(uint8_t col, uint8_t row) {
+    traceMark(TRACE_BEGIN, TRACE_ID_LCD_CURSOR);
+    LiquidCrystal_I2C::setCursor(col, row);
+    traceMark(TRACE_END, TRACE_ID_LCD_CURSOR);
+  }
+  size_t write(uint8_t c) override {
+    traceMark(TRACE_BEGIN, TRACE_ID_LCD_WRITE, c);
+    size_t n = LiquidCrystal_I2C::write(c);
+    traceMark(TRACE_END, TRACE_ID_LCD_WRITE);
+    return n;
+  }
+  using Print::write;
+};
+
+TracedLcd lcd(0x27, 16, 2);   // Change address to 0x3F if needed
+
+// One intersection's screen: kept in RAM and written through to the
+// LCD only while it is the page shown, so units never overwrite
+// each other and a page switch repaints from the buffer
+class LcdPage : public Print {
+ public:
+  bool visible = false;
+
+  LcdPage() { memset(text_, ' ', sizeof(text_)); }
+
+  void clear() {
+    memset(text_, ' ', sizeof(text_));
+    col_ = row_ = 0;
+    if (visible) lcd.clear();
+  }
+  void setCursor(uint8_t col, uint8_t row) {
+    col_ = col;
+    row_ = row < 2 ? row : 1;
+    if (visible) lcd.setCursor(col, row);
+  }
+  size_t write(uint8_t c) override {
+    if (col_ < 16) text_[row_][col_] = (char)c;
+    col_++;
+    if (visible) lcd.write(c);
+    return 1;
+  }
+  using Print::write;
+
+  void show() {
+    visible = true;
+    lcd.clear();
+    for (uint8_t r = 0; r < 2; r++) {
+      lcd.setCursor(0, r);
+      lcd.write((const uint8_t*)text_[r], 16);
+    }
+    lcd.setCursor(col_ < 16 ? col_ : 15, row_);
+  }
+
+ private:
+  char    text_[2][16];
+  uint8_t col_ = 0, row_ = 0;
+};
+
+// -------- WIFI CONFIG (SPaT broadcast) --------
+const char* WIFI_SSID = "Wokwi-GUEST";
+const char* WIFI_PASS = "";
+
+WiFiUDP spatUdp;
+
+const char* SNMP_COMMUNITY = "public";   // unit n answers "public<n>"
+
+const char* NTP_SERVER = "pool.ntp.org";
+
+// -------- PER-UNIT SETTINGS (the Linux sim sets these from argv) --------
+int intersectionId  = 1;   // unit 0; further units take the next ids
+int coordUpstreamId = 0;   // unit whose NS platoons reach unit 0 (0 = none)
+int snmpPort        = SNMP_PORT;   // 0 = no agent
 
 // ============= PIN DEFINITIONS =============
 
@@ -39,17 +405,151 @@ const int PIN_EW_GREEN  = 21;
 const int PIN_PED_RED   = 22;
 const int PIN_PED_GREEN = 23;
 
-// Push buttons
+// 74HC595 chain (SIGNAL_OUTPUT 1): VSPI IO-MUX pins, free once the
+// LEDs move off GPIO. /OE tied low, /SRCLR tied high.
+const int PIN_SR_DATA  = 23;   // SER of the first register
+const int PIN_SR_CLOCK = 18;   // SRCLK
+const int PIN_SR_LATCH = 5;    // RCLK, pulsed once per frame
+
+// Push buttons, and the crossing's call relay (GPIO17 is the bus TX in
+// bus builds, which read both contacts in their frame)
 const int PIN_BTN_NS_TRAFFIC  = 12;   // NS vehicle count (when NS red)
 const int PIN_BTN_EW_TRAFFIC  = 13;   // EW vehicle count (when EW red)
 const int PIN_BTN_PED_REQUEST = 14;   // Pedestrian request
+const int PIN_RAIL_PREEMPT    = 26;   // Rail call, relay NC contact (open = train)
+const int PIN_RAIL_CHECK      = 17;   // Rail call, relay NO contact (low = train)
+
+// Speed trap loops ahead of the count loops (GPIO39: 10k pull-up,
+// it has none)
+const int PIN_TRAP_NS = 15;
+const int PIN_TRAP_EW = 39;
+
+// Stop-line loops just past the stop bars (GPIO34: 10k pull-up). On
+// GPIO only with GPIO detectors (RLR_STOP_GPIO): GPIO34 is the expander
+// INT, GPIO16 the bus RX, and those backends read the loops in their
+// frame
+const int PIN_STOP_NS = 34;
+const int PIN_STOP_EW = 16;
+
+// Enforcement camera trigger (RLR_CAMERA), active high
+const int PIN_CAMERA_TRIGGER = 25;
+
+// 74HC165 chain (DETECTOR_INPUT 1): shares SCLK with the 74HC595s
+const int PIN_DET_DATA = 19;   // QH of the first register (VSPI MISO)
+const int PIN_DET_LOAD = 21;   // SH/LD, pulsed low before each scan
+
+// MCP23017 inputs (DETECTOR_INPUT 2): mirrored, open-drain INT of
+// every expander, 10k pull-up to 3.3 V (GPIO34 has none)
+const int PIN_DET_INT  = 34;
+
+// Cabinet bus (SIGNAL_OUTPUT / DETECTOR_INPUT 3): RS-485 transceiver
+// on UART2, DE driven by the UART's RTS in half-duplex mode
+const int PIN_BUS_TX = 17;
+const int PIN_BUS_RX = 16;
+const int PIN_BUS_DE = 25;
+
+// Timing reference
+const int PIN_GPS_PPS = 27;           // GPS pulse-per-second (rising edge)
+
+// Road weather sensor relay contacts, high while the surface is wet /
+// icy (10k pull-downs; GPIO35/36 are input-only)
+const int PIN_WEATHER_WET = 35;
+const int PIN_WEATHER_ICE = 36;
 
 // ============= CONSTANTS =============
 
-const int YELLOW_TIME_SEC   = 3;
-const int PED_TIME_SEC      = 8;
+const int UPLINK_PERIOD_SEC = 60;     // one status frame per minute
+const int UPLINK_FULL_EVERY = 10;     // force a FULL frame every N frames
+const int UPLINK_HISTORY    = 4;      // sent states kept for ACK matching
+
+const int BTN_STUCK_POLLS   = 1500;   // ~30 s held low -> stuck fault
+
+const int SPAT_PERIOD_POLLS = 5;      // 5 x 20 ms = 10 Hz
+
+const int COORD_TRAVEL_SEC  = 20;     // upstream stop line -> our stop line
+const int COORD_RX_SLOTS    = 8;      // frames buffered between polls
+
+const int LCD_PAGE_SEC      = 4;      // each intersection's page shown this long
+
+const int SNMP_PACKETS_PER_TICK = 4;  // requests answered per tick at most
+
+const uint32_t NVS_SAVE_STACK = 3072;   // nvsSaveTask: NVS write + printf
+
+// Railroad preemption (timing in rail.h)
+const int64_t RAIL_RESPONSE_LIMIT_US = 40000;   // call -> clearance start, 2 ticks
+const int     RAIL_DISAGREE_TICKS    = 25;      // contacts disagree 0.5 s: fault
+
+const uint32_t RLR_CAMERA_PULSE_MS = 50;   // trigger pulse width, at least
+
+// Re-identification: back-to-back 30 s scans; weaker adverts are
+// from beyond the intersection
+const int REID_SCAN_SEC           = 30;
+const int REID_MIN_RSSI           = -85;
+const int REID_HEARD_SLOTS        = 32;   // adverts queued by the scan callback
+const int REID_RX_SLOTS           = 4;    // neighbour frames buffered between polls
+const int REID_REPORT_SEC         = 2;    // sightings sent at least this often
+const int REID_SIGHTINGS_PER_TICK = 8;    // matched per tick at most
+
+// Weather: worse surfaces are believed at once, better ones once dry
+// for a while (a drying sensor flickers)
+const int WEATHER_WORSEN_SEC = 5;
+const int WEATHER_EASE_SEC   = 300;
+
+// detector, network, housekeeping + one phaseScript per unit, each
+// phase script holding its own frame and the phase it awaits
+static_assert(3 + INTERSECTIONS <= CORO_MAX_TASKS &&
+              3 + 2 * INTERSECTIONS <= CORO_FRAME_SLOTS,
+              "coroutine pool too small for INTERSECTIONS (coro.h)");
+
+const int64_t POLL_PERIOD_US   = 20000;    // one button poll
+const int64_t POLL_RESYNC_US   = 100000;   // further behind than this: restart pacing
+const int64_t PPS_FRESH_US     = 3000000;  // PPS newer than this outranks NTP
+const int64_t NTP_OVERRIDE_US  = 500000;   // NTP still steps a PPS clock this far off
+
+const int TRACE_DUMP_PER_LINE  = 16;       // records per "TR" line
+const int TRACE_DUMP_TICKS     = 2;        // one line per 40 ms (~23 ms at 115200 baud)
+const int PROF_DUMP_PER_LINE   = 8;        // PCs per "PF" line
+
+// Word index of the PC in the Xtensa interrupt frame (XT_STK_PC / 4)
+const int PROF_FRAME_PC_WORD   = 1;
+
+// Signal outputs in use (8 here; 24-48 at a 4-leg site with turns)
+const int     SIG_OUTPUT_COUNT = SIG_HEAD_OUTPUTS * INTERSECTIONS;
+const int     SIG_HC595_CHIPS  = (SIG_OUTPUT_COUNT + 7) / 8;
+const int     SIG_MCP_CHIPS    = (SIG_OUTPUT_COUNT + 15) / 16;
+const uint8_t SIG_MCP_ADDR     = 0x20;       // first expander; 0x27 is the LCD
+const int     SIG_SPI_HZ       = 10000000;   // 64 outputs shift in 6.4 us
+
+// Detector inputs in use (32+ with per-lane loops and ped buttons)
+const int     DET_INPUT_COUNT  = DET_HEAD_INPUTS * INTERSECTIONS;
+const int     DET_HC165_CHIPS  = (DET_INPUT_COUNT + 7) / 8;
+const int     DET_MCP_CHIPS    = (DET_INPUT_COUNT + 15) / 16;
+const uint8_t DET_MCP_ADDR     = 0x24;       // after the output expanders
+const int     DET_SPI_HZ       = 5000000;    // 64 inputs in 13 us
+const int     DET_RESYNC_TICKS = 50;         // expanders re-read once a second anyway
+
+// Cabinet bus: one output frame out and one input frame back per tick
+const uart_port_t CAB_UART          = UART_NUM_2;
+const int         CAB_BAUD          = 153600;   // the SDLC rate of TS 2 cabinets
+const int         CAB_UART_BUF      = 256;      // driver ring buffers, bytes
+const int         CAB_TIMEOUT_TICKS = 5;        // no answer for 100 ms: inputs released
+
+// GPIO backend: pin of each input
+const uint8_t DET_GPIO_PINS[DET_HEAD_INPUTS] = {
+  PIN_BTN_NS_TRAFFIC, PIN_BTN_EW_TRAFFIC, PIN_BTN_PED_REQUEST, PIN_RAIL_PREEMPT,
+  PIN_TRAP_NS, PIN_TRAP_EW, PIN_STOP_NS, PIN_STOP_EW, PIN_RAIL_CHECK
+};
+
+// GPIO backend: pin of each output
+const uint8_t SIG_GPIO_PINS[SIG_HEAD_OUTPUTS] = {
+  PIN_NS_RED, PIN_NS_YELLOW, PIN_NS_GREEN,
+  PIN_EW_RED, PIN_EW_YELLOW, PIN_EW_GREEN,
+  PIN_PED_RED, PIN_PED_GREEN
+};
 
-const int BASE_GREEN_SEC    = 10;     // standard base green time
+// FreeRTOS tasks whose stack high-water mark "RAM" reports
+const char* const RAM_TASK_NAMES[] = {"loopTask", "wifi", "tiT", "esp_timer", "sys_evt",
+                                      "nvssave"};
 
 // ============= PHASE ENUM =============
 
@@ -58,400 +558,3022 @@ enum Phase {
   PHASE_NS_YELLOW,
   PHASE_EW_GREEN,
   PHASE_EW_YELLOW,
-  PHASE_PED_GREEN
+  PHASE_PED_GREEN,
+  PHASE_ALL_RED       // red clearance after a yellow
 };
 
-Phase currentPhase = PHASE_NS_GREEN;
-
-// ============= GLOBAL VARIABLES =============
-
-int trafficCountNS = 0;   // vehicles waiting on NS (when NS red)
-int trafficCountEW = 0;   // vehicles waiting on EW (when EW red)
-
-bool pedRequest = false;  // latched pedestrian request
+enum RailState {
+  RAIL_IDLE,
+  RAIL_ENTRY,         // interval cut by the call clearing
+  RAIL_TRACK_CLEAR,   // track clearance green
+  RAIL_HOLD,          // track approach and pedestrians held red
+  RAIL_EXIT           // dwell approach yellow, then the plan resumes
+};
 
-bool lastNsBtnState  = HIGH;
-bool lastEwBtnState  = HIGH;
-bool lastPedBtnState = HIGH;
+// ============= INTERSECTIONS =============
+
+// Uplink state of one intersection
+struct UplinkLink {
+  UplinkStatus sent[UPLINK_HISTORY];   // indexed by seq % UPLINK_HISTORY
+  uint8_t      sentSeq[UPLINK_HISTORY];
+  bool         sentValid[UPLINK_HISTORY];
+  UplinkStatus acked;                  // base for DELTA frames
+  uint8_t      ackedSeq  = 0;
+  bool         haveAck   = false;
+  uint8_t      seq       = 0;
+  int          sinceFull = 0;
+  int          sinceAck  = 0;
+};
 
-// ============= FUNCTION DECLARATIONS =============
+// Everything one intersection owns. Its signal outputs are
+// SIG_HEAD_OUTPUTS bits from index * SIG_HEAD_OUTPUTS in the
+// output frame, its inputs likewise in the detector frame.
+struct Intersection {
+  int  index = 0;
+  int  id = 0;               // reported in SPaT / coordination / uplink
+  int  upstreamId = 0;       // unit whose NS platoons reach us (0 = none)
+  char tag[4] = "";          // "" for unit 0, else its index: "PLAN1", "UL1", ...
+
+  Phase    phase = PHASE_NS_GREEN;
+  int      phaseRemainingSec = 0;   // countdown value shown as "T=" this second
+  int      phaseTotalSec     = 0;   // full length of the current interval
+  uint32_t secondStartTick   = 0;   // scheduler tick the countdown second began
+
+  PhasePlan activePlan;            // basePlan scaled for weatherApplied, being run
+  PhasePlan basePlan;              // verified plan as loaded / uploaded
+  PhasePlan pendingPlan;           // uploaded, starts at the next cycle wrap
+  bool      planPending = false;
+  int       planPc      = 0;       // op being executed
+
+  WeatherLevel weatherApplied = WEATHER_DRY;   // profile activePlan is timed for
+
+  int  trafficCountNS = 0;   // vehicles waiting on NS (when NS red)
+  int  trafficCountEW = 0;   // vehicles waiting on EW (when EW red)
+  int  trafficPce[2]  = {0, 0};   // the same queues in tenths of a PCE (PLAN_APPROACH_*)
+
+  VehClassifier vehClass[2];                  // per approach (PLAN_APPROACH_*)
+  uint32_t      classCounts[2][VEH_CLASSES] = {};
+  bool pedRequest = false;   // latched pedestrian request
+
+  int nsBtnLowPolls  = 0;    // consecutive polls with button held low
+  int ewBtnLowPolls  = 0;
+  int pedBtnLowPolls = 0;
+
+  // Served totals and faults reported over the uplink
+  uint16_t volumeNS       = 0;   // vehicles served on NS (wraps)
+  uint16_t volumeEW       = 0;   // vehicles served on EW (wraps)
+  uint16_t pedCallsServed = 0;   // pedestrian phases served (wraps)
+  uint8_t  faults         = 0;   // this unit's FAULT_*_BTN_STUCK bits
+
+  // Actuations per NTCIP volume period (every press, red or not)
+  uint16_t detVolume[NTCIP_VEH_DETECTORS]     = {0, 0};   // counting
+  uint16_t detVolumeLast[NTCIP_VEH_DETECTORS] = {0, 0};   // last full period
+  uint8_t  volumeSeq = 0;                                  // periods completed
+
+  // Railroad preemption; the phase script runs in slot scriptSlot
+  int       scriptSlot      = -1;
+  RailState rail            = RAIL_IDLE;
+  int       railEntryTicks  = 0;   // left of the interval being cleared
+  uint32_t  railPreempts    = 0;
+  uint32_t  railLate        = 0;   // responses over RAIL_RESPONSE_LIMIT_US
+  uint32_t  railResponseUs  = 0;   // last call -> clearance start
+  uint32_t  railResponseMax = 0;
+  int       railDisagree    = 0;   // ticks the call contacts have disagreed
+  uint32_t  railFaults      = 0;   // disagreements that lasted RAIL_DISAGREE_TICKS
+
+  // Red-light running, per approach (PLAN_APPROACH_*)
+  RlrHead rlrHeads[2];
+
+  CoordPlatoon coordPlatoon = {false, 0, 0};
+  uint8_t      spatMsgCount = 0;
+  UplinkLink   uplink;
+  LcdPage      page;
+};
 
-void readButtons();
-void waitOneSecondWithButtons();
+Intersection intersections[INTERSECTIONS];
+int          lcdPageShown = 0;
+Preferences  planStore;
+Preferences  reidStore;
 
-void phaseNsGreen();
-void phaseNsYellow();
-void phaseEwGreen();
-void phaseEwYellow();
-void phasePedestrianIfRequested();
+// Writes waiting for nvsSaveTask, latest wins: uploaded plans (length
+// 0: none) and the corridor key
+uint8_t      planSaveImage[INTERSECTIONS][PLAN_MAX_BYTES];
+size_t       planSaveLen[INTERSECTIONS];
+uint8_t      reidKeySave[REID_KEY_BYTES];
+bool         reidKeySavePending = false;
+portMUX_TYPE nvsSaveMux  = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t nvsSaveWake = nullptr;
 
-void setAllVehicleRed();
-void setNsGreenState();
-void setNsYellowState();
-void setEwGreenState();
-void setEwYellowState();
-void setPedestrianGreenState();
+// ============= GLOBAL VARIABLES =============
 
-bool isNsRed();
-bool isEwRed();
+uint8_t faultFlags     = 0;   // board-wide FAULT_* bits from uplink.h
+int     uplinkSecCount = 0;
+bool    failFlash      = false;   // a task could not run: red flash until restart
+
+// Clock discipline: reference edges are captured in interrupt /
+// SNTP callback context and fed to the loop from clockPoll()
+ClockDiscipline  sysClock;
+volatile int64_t ppsLocalUs     = 0;
+volatile bool    ppsPending     = false;
+volatile int64_t ntpLocalUs     = 0;
+volatile int64_t ntpRefUs       = 0;
+volatile bool    ntpPending     = false;
+int64_t          lastPpsLocalUs = 0;
+bool             clockTimeSet   = false;   // NTP has given true time (PPS only labels seconds)
+int64_t          pollDeadlineNs = 0;   // local timer at the next poll (ns: keeps sub-us drift)
+
+// Peer coordination: frames are queued by the ESP-NOW receive
+// callback (WiFi task), stamped, and handled twice per tick
+uint8_t          coordRxBuf[COORD_RX_SLOTS][COORD_FRAME_LEN];
+int64_t          coordRxUs[COORD_RX_SLOTS];
+volatile uint8_t coordRxHead = 0;
+volatile uint8_t coordRxTail = 0;
+uint8_t          coordTxSeq  = 0;
+
+char serialLine[8 + 2 * PLAN_MAX_BYTES];   // incoming command line (fits "PLAN <hex>")
+int  serialLineLen = 0;
+
+// Trace dump in progress (recording is paused meanwhile)
+bool     traceDumping = false;
+uint32_t traceDumpPos = 0;
+
+// Sampling profiler: timer created at setup, started by "PROF ON"
+hw_timer_t* profTimer    = nullptr;
+bool        profDumping  = false;
+uint32_t    profDumpPos  = 0;
+
+// Zero-heap guard: only the loop task is held to it
+TaskHandle_t heapGuardTask = nullptr;
+
+// Section bounds from the linker script
+extern "C" uint8_t _data_start[], _data_end[], _bss_start[], _bss_end[];
+
+// Latency: first falling edge per button, stamped by its interrupt and
+// taken by readButtons() when the poll sees the press
+volatile uint32_t latEdgeCycles[LAT_PIN_INPUTS];
+volatile int64_t  latEdgeUs[LAT_PIN_INPUTS];
+volatile bool     latEdgePending[LAT_PIN_INPUTS];
+
+// Signal outputs: the state helpers edit sigFrame, sigCommit() sends
+// it. A frame the backend did not take is retried on the next commit.
+SigFrame            sigFrame       = 0;
+SigFrame            sigCommitted   = 0;
+bool                sigDirty       = true;   // sigCommitted not on the outputs
+uint32_t            sigCommits     = 0;
+uint32_t            sigFailures    = 0;
+spi_device_handle_t sigSpi         = nullptr;
+spi_transaction_t   sigTrans;
+bool                sigTransQueued = false;
+alignas(4) uint8_t  sigTxBuf[SIG_MAX_HC595];   // DMA source
+bool                spiBusReady    = false;
+
+// Detector inputs: one scan per tick into detScan. The expander
+// interrupt only flags (and stamps) that a read is due.
+DetScan             detScan        = {~(DetFrame)0, 0};
+uint32_t            detScans       = 0;
+uint32_t            detReads       = 0;      // bulk transfers actually made
+uint32_t            detReadTick    = 0;
+spi_device_handle_t detSpi         = nullptr;
+alignas(4) uint8_t  detRxBuf[DET_MAX_HC165];   // DMA destination
+volatile bool       detIntPending  = true;   // read once at start
+volatile uint32_t   detIntCycles   = 0;
+volatile int64_t    detIntUs       = 0;
+
+// Cabinet bus: the output frame goes out once per tick with the
+// detector scan, the answer to it is taken by the next scan
+CabDecoder cabRx;
+bool       cabBusReady  = false;
+uint8_t    cabTxSeq     = 0;
+uint32_t   cabRxTick    = 0;            // tick the last answer came in
+uint32_t   cabFramesTx  = 0;
+uint32_t   cabTimeouts  = 0;
+bool       cabOnline    = false;
+DetFrame   cabInputs    = ~(DetFrame)0;
+
+// SNMP agent: requests are parsed in snmpRxBuf and answered from
+// snmpTxBuf without other copies
+int       snmpSock = -1;
+SnmpAgent snmpAgent = {NTCIP_OBJECTS, NTCIP_OBJECT_COUNT, nullptr, nullptr, 0, 0, 0, 0};
+uint8_t   snmpRxBuf[SNMP_MAX_MESSAGE];
+uint8_t   snmpTxBuf[SNMP_MAX_MESSAGE];
+
+// Weather: sensor level after settling, and the Serial stand-in
+WeatherLevel weatherSensed    = WEATHER_DRY;
+WeatherLevel weatherCandidate = WEATHER_DRY;   // sensor reading settling
+int          weatherSettleSec = 0;
+int          weatherOverride  = -1;            // WeatherLevel, -1 = sensor
+
+// Red-light running: violations are logged by the stop-line
+// interrupts (GPIO inputs) or the detector scan; rlrPoll() reports
+// them and drives the camera pulse
+RlrEvent          rlrLog[RLR_LOG_SIZE];
+volatile uint32_t rlrLogHead      = 0;   // violations ever logged
+uint32_t          rlrLogReported  = 0;
+volatile bool     rlrCameraFire   = false;   // set by a violation, taken by rlrPoll()
+bool              rlrCameraOn     = false;
+uint32_t          rlrCameraOffMs  = 0;
+uint32_t          rlrCameraPulses = 0;
+
+// Re-identification: the scan callback (BT task) hashes each advert
+// under reidSalts[reidSaltSlot] and queues it; reidPoll() rotates
+// the salt and does the matching. Neighbour frames are queued by
+// coordOnReceive() like coordination frames. No salt, and no scan,
+// until the corridor key is provisioned and the clock has true time.
+ReidSalt          reidKey;                  // from NVS, never printed
+bool              reidKeyed    = false;
+bool              reidBtUp     = false;     // BLE stack running (REID_SCAN)
+bool              reidScanning = false;     // scan started
+ReidSalt          reidSalts[2];
+volatile uint8_t  reidSaltSlot = 0;
+volatile bool     reidSaltReady = false;
+uint32_t          reidEpoch = 0;
+ReidHeard         reidHeard[REID_HEARD_SLOTS];
+volatile uint8_t  reidHeardHead = 0;
+volatile uint8_t  reidHeardTail = 0;
+uint8_t           reidRxBuf[REID_RX_SLOTS][REID_MAX_FRAME];
+uint8_t           reidRxLen[REID_RX_SLOTS];
+int64_t           reidRxUs[REID_RX_SLOTS];
+volatile uint8_t  reidRxHead = 0;
+volatile uint8_t  reidRxTail = 0;
+ReidTable         reidLocal;                // seen here
+ReidTable         reidRemote;               // reported by neighbours
+ReidLink          reidLinks[REID_LINKS];    // travel times from each neighbour
+ReidFrame         reidTx;
+int32_t           reidTxAtDs[REID_FRAME_MAX];
+int32_t           reidTxLastDs = 0;
+uint32_t          reidAdverts = 0;          // written by the callback only
+uint32_t          reidWeak    = 0;
+uint32_t          reidOverrun = 0;
+uint32_t          reidVisits   = 0;
+uint32_t          reidFramesTx = 0;
+uint32_t          reidFramesRx = 0;
 
-int  computeNsGreenSeconds();
-int  computeEwGreenSeconds();
+// ============= FUNCTION DECLARATIONS =============
 
-void lcdShowTwoLines(const char* line1, const char* line2);
+void readButtons();
+bool handleDetectors(Intersection& ix, const LatStamp& readAt);
+TickAwaiter countdownSecond(Intersection& ix);
+int  pollInSecond(Intersection& ix);
+
+Task phaseScript(Intersection& ix);
+Task detectorTask();
+Task networkTask();
+Task housekeepingTask();
+void failFlashPoll();
+void printTaskStatus();
+void planBegin();
+void nvsSaveTask(void* arg);
+void planUpload(Intersection& ix, const char* hex);
+void planTakePending(Intersection& ix);
+void printPlanStatus();
+void setPhase(Intersection& ix, Phase p);
+void traceResume(int slot, bool begin);
+void traceDumpLine();
+void profBegin();
+void profSample();
+void profStart();
+void profStop();
+void profDumpLine();
+void heapGuardArm();
+void heapGuardCheck(uintptr_t pc, size_t bytes);
+void printRamStatus();
+void latBegin();
+LatStamp latNow();
+void latEdgeIsr(int input);
+void onNsEdge();
+void onEwEdge();
+void onPedEdge();
+void onRailEdge();
+bool latTakeEdge(int input, LatStamp& edge);
+void latDropStaleEdge(int input, const LatStamp& readAt);
+void latMarkEdge(int input, const LatStamp& at);
+void printLatency();
+void printLatencyEvents();
+void updateStuckFault(bool btnLow, int& lowPolls, uint8_t& faults, uint8_t faultBit);
+void sigBegin();
+void sigSet(int out, bool on);
+void sigCommit();
+void sigLatchIsr(spi_transaction_t* t);
+void printSignalStatus();
+bool spiBusBegin();
+void detBegin();
+LatStamp detScanInputs();
+void detLoadIsr(spi_transaction_t* t);
+void onDetInt();
+void printDetectorStatus();
+bool cabBusBegin();
+DetFrame cabReceive();
+void cabSend();
+void printCabinetStatus();
+
+void  snmpBegin();
+void  snmpPoll();
+void* snmpCommunity(const uint8_t* name, size_t len);
+bool  ntcipGet(void* ctx, const SnmpObject& obj, SnmpValue& v);
+void  ntcipVolumeTick();
+void  printSnmpStatus();
+
+void serialPoll();
+void handleSerialLine(const char* line);
+void uplinkTick();
+void uplinkSend(Intersection& ix);
+void uplinkHandleAck(Intersection& ix, uint8_t seq);
+
+void spatBroadcast();
+void spatSend(Intersection& ix);
+void spatFillMovement(SpatMovement& mv, uint8_t signalGroup,
+                      bool green, bool yellow, const TtcEstimate& est);
+
+void coordBegin();
+void coordOnReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+void coordPoll();
+void coordSendEvent(Intersection& ix, uint8_t type, uint8_t approach, int count, int greenSec);
+void coordDeliver(const CoordEvent& e);
+bool coordShouldEndEwGreen(Intersection& ix, int elapsedSec);
+long coordEarliestEwEndDs(Intersection& ix);
+
+void    clockBegin();
+void    clockPoll();
+int64_t clockNowUs();
+void    waitUntilUs(int64_t deadlineUs);
+void    onPpsEdge();
+void    onNtpSync(struct timeval* tv);
+void    printClockStatus();
+
+long currentRemainingDs(Intersection& ix);
+void predictTimeToChange(Intersection& ix, TtcEstimate out[3]);
+
+Task phaseNsGreen(Intersection& ix);
+void endGreen(Intersection& ix, int approach);
+Task phaseNsYellow(Intersection& ix);
+Task phaseEwGreen(Intersection& ix);
+Task phaseEwYellow(Intersection& ix);
+Task phasePedestrianIfRequested(Intersection& ix);
+Task railPreempt(Intersection& ix);
+
+void railPreemptStart(Intersection& ix, const LatStamp& callAt, bool timed);
+bool railCallActive(Intersection& ix);
+void railSupervise(Intersection& ix);
+void printRailStatus();
+
+void classifyPress(Intersection& ix, int approach, int64_t atUs, bool counted);
+void classifyRelease(Intersection& ix, int approach, int64_t atUs);
+void printClassStatus();
+
+void rlrBegin();
+void rlrTrackHeads();
+void rlrEntered(Intersection& ix, int approach, int64_t atUs);
+void onNsStopEdge();
+void onEwStopEdge();
+void rlrPoll();
+void printRlrEvent(const RlrEvent& e);
+void printRlrStatus();
+
+void    reidBegin();
+void    reidPoll();
+void    reidRotateSalt();
+void    reidKeyCommand(const char* hex);
+void    reidSighting(uint32_t hash, int32_t atDs);
+void    reidReceive(const uint8_t* data, size_t len, int32_t rxDs);
+void    reidSend(int32_t nowDs);
+int32_t reidNowDs();
+void    printReidStatus();
+#if REID_SCAN
+void    reidStartScan();
+void    reidOnGap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+#endif
+
+Task phaseAllRed(Intersection& ix);
+void showAllRed(Intersection& ix);
+
+void weatherBegin();
+void weatherTick();
+WeatherLevel weatherLevel();
+void weatherApply(Intersection& ix);
+void weatherCommand(const char* arg);
+void printWeatherStatus();
+
+void headSet(Intersection& ix, int out, bool on);
+void setAllVehicleRed(Intersection& ix);
+void setNsGreenState(Intersection& ix);
+void setNsYellowState(Intersection& ix);
+void setEwGreenState(Intersection& ix);
+void setEwYellowState(Intersection& ix);
+void setPedestrianGreenState(Intersection& ix);
+
+bool isNsRed(Intersection& ix);
+bool isEwRed(Intersection& ix);
+
+int  computeNsGreenSeconds(Intersection& ix);
+int  computeEwGreenSeconds(Intersection& ix);
+
+void lcdShowTwoLines(LcdPage& page, const char* line1, const char* line2);
+void lcdNextPage();
+bool unitCommand(const char* line, const char* kw, Intersection*& ix, const char*& rest);
+void intersectionsBegin();
 
 // ============= SETUP =============
 
 void setup() {
+  Serial.begin(115200);
+
   // Use GPIO32 as SDA and GPIO33 as SCL for I2C
   Wire.begin(32, 33);
 
+  coroResumeHook = traceResume;
+
+  // Probe the LCD so a missing/miswired display is reported as a fault
+  traceMark(TRACE_BEGIN, TRACE_ID_I2C_PROBE);
+  Wire.beginTransmission(0x27);
+  if (Wire.endTransmission() != 0) {
+    faultFlags |= FAULT_LCD_NACK;
+  }
+  traceMark(TRACE_END, TRACE_ID_I2C_PROBE);
+
   lcd.init();
   lcd.backlight();
-  lcdShowTwoLines("Traffic System", "Starting...");
+  intersectionsBegin();
+  lcdShowTwoLines(intersections[0].page, "Traffic System", "Starting...");
   delay(1000);
 
-  pinMode(PIN_NS_RED, OUTPUT);
-  pinMode(PIN_NS_YELLOW, OUTPUT);
-  pinMode(PIN_NS_GREEN, OUTPUT);
-
-  pinMode(PIN_EW_RED, OUTPUT);
-  pinMode(PIN_EW_YELLOW, OUTPUT);
-  pinMode(PIN_EW_GREEN, OUTPUT);
-
-  pinMode(PIN_PED_RED, OUTPUT);
-  pinMode(PIN_PED_GREEN, OUTPUT);
+  sigBegin();
+
+  detBegin();
+  latBegin();
+  rlrBegin();
+
+  // Connect in the background; SPaT is only sent once associated
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+  coordBegin();
+  reidBegin();
+  snmpBegin();
+  clockBegin();
+  planBegin();
+  weatherBegin();
+  profBegin();
+
+  for (Intersection& ix : intersections) {
+    setAllVehicleRed(ix);
+    headSet(ix, SIG_PED_RED, true);
+    headSet(ix, SIG_PED_GREEN, false);
+  }
+  sigCommit();
 
-  pinMode(PIN_BTN_NS_TRAFFIC, INPUT_PULLUP);
-  pinMode(PIN_BTN_EW_TRAFFIC, INPUT_PULLUP);
-  pinMode(PIN_BTN_PED_REQUEST, INPUT_PULLUP);
+  for (Intersection& ix : intersections) lcdShowTwoLines(ix.page, "Traffic System", "Ready");
+  delay(1000);
 
-  setAllVehicleRed();
-  digitalWrite(PIN_PED_RED, HIGH);
-  digitalWrite(PIN_PED_GREEN, LOW);
+  // Slot order is the order tasks run within a tick; further units'
+  // scripts go last so slots 0-3 stay the same for any unit count
+  intersections[0].scriptSlot = coroSpawn(phaseScript(intersections[0]));
+  coroSpawn(detectorTask());
+  coroSpawn(networkTask());
+  coroSpawn(housekeepingTask());
+  for (int k = 1; k < INTERSECTIONS; k++) {
+    intersections[k].scriptSlot = coroSpawn(phaseScript(intersections[k]));
+  }
 
-  lcdShowTwoLines("Traffic System", "Ready");
-  delay(1000);
+  heapGuardArm();
 }
 
 // ============= MAIN LOOP =============
 
+// One scheduler pass per 20 ms tick. Deadlines chain across ticks,
+// so time spent on LCD writes is absorbed instead of adding drift.
 void loop() {
-  // Full cycle: NS -> (Ped?) -> EW -> (Ped?) -> repeat
+  int64_t now = esp_timer_get_time();
+  if (pollDeadlineNs == 0 || now - pollDeadlineNs / 1000 > POLL_RESYNC_US) {
+    pollDeadlineNs = now * 1000;   // first pass, or after a long blocking call
+  }
+  int64_t late = now - pollDeadlineNs / 1000;
+  traceMark(TRACE_COUNTER, TRACE_ID_TICK_LATE, (uint16_t)(late > 65535 ? 65535 : late));
+
+  traceMark(TRACE_BEGIN, TRACE_ID_TICK);
+  coroRunDue();
+  failFlashPoll();
+  cabSend();   // bus builds: the heads as every unit left them this tick
+  traceMark(TRACE_END, TRACE_ID_TICK);
+
+  // The local timer never steps, so neither do the ticks: a clock step
+  // only moves timestamps
+  pollDeadlineNs += clockLocalSpan(sysClock, POLL_PERIOD_US * 1000);
+  // Peer frames are also applied halfway through the wait, so none
+  // waits more than half a tick (10 ms)
+  traceMark(TRACE_BEGIN, TRACE_ID_WAIT);
+  waitUntilUs(pollDeadlineNs / 1000 - POLL_PERIOD_US / 2);
+  coordPoll();
+  waitUntilUs(pollDeadlineNs / 1000);
+  traceMark(TRACE_END, TRACE_ID_WAIT);
+  coroAdvanceTick();
+}
+
+// ============= TASKS =============
+
+// Plan interpreter, one per intersection: one op per interval, so the
+// per-tick cost is a single wake-up check. Default plan:
+// NS -> (Ped?) -> EW -> (Ped?)
+// Respawned by railPreemptStart(): runs the preemption first, then
+// restarts the plan as after a cycle wrap.
+Task phaseScript(Intersection& ix) {
+  int lastYellow = -1;   // approach whose yellow ended last (no green since)
+  ix.planPc = 0;
+  if (ix.rail != RAIL_IDLE) {
+    co_await railPreempt(ix);
+    lastYellow = 1 - RAIL_TRACK_APPROACH;   // the dwell approach
+    if (ix.planPending) planTakePending(ix);
+    ix.planPc = planSwitchStart(ix.activePlan, lastYellow);
+  }
+  for (;;) {
+    weatherApply(ix);   // phase boundary: new timing may start here
+    const PlanOp op = ix.activePlan.ops[ix.planPc];
+    switch (op.code) {
+      case OP_GREEN:
+        if (op.arg == PLAN_APPROACH_NS) co_await phaseNsGreen(ix);
+        else                            co_await phaseEwGreen(ix);
+        lastYellow = -1;
+        break;
+      case OP_YELLOW:
+        if (op.arg == PLAN_APPROACH_NS) co_await phaseNsYellow(ix);
+        else                            co_await phaseEwYellow(ix);
+        if (ix.activePlan.allRedSec > 0) co_await phaseAllRed(ix);
+        lastYellow = op.arg;
+        break;
+      case OP_PED:
+        co_await phasePedestrianIfRequested(ix);
+        break;
+    }
+
+    int next = planNextPc(ix.activePlan, ix.planPc);
+    if (ix.planPending && next <= ix.planPc) {
+      // Cycle wrap: switch plans without re-greening the approach
+      // whose yellow just ended
+      planTakePending(ix);
+      next = planSwitchStart(ix.activePlan, lastYellow);
+    }
+    ix.planPc = next;
+  }
+}
+
+// Vehicle / pedestrian buttons, every tick
+Task detectorTask() {
+  for (;;) {
+    traceMark(TRACE_BEGIN, TRACE_ID_BUTTONS);
+    readButtons();
+    rlrPoll();
+    traceMark(TRACE_END, TRACE_ID_BUTTONS);
+    co_await ticks(1);
+  }
+}
+
+// Serial commands and peer frames every tick, SPaT at 10 Hz
+Task networkTask() {
+  for (;;) {
+    serialPoll();
+    coordPoll();
+    reidPoll();
+    snmpPoll();
+    if (coroTicks() % SPAT_PERIOD_POLLS == 0) spatBroadcast();
+    if (traceDumping && coroTicks() % TRACE_DUMP_TICKS == 0) traceDumpLine();
+    if (profDumping && coroTicks() % TRACE_DUMP_TICKS == 1) profDumpLine();
+    co_await ticks(1);
+  }
+}
 
-  phaseNsGreen();
-  phaseNsYellow();
-  phasePedestrianIfRequested();   // if pedRequest, MUST go now before EW green
+// Clock references every tick, per-second bookkeeping
+Task housekeepingTask() {
+  for (;;) {
+    clockPoll();
+    if (coroTicks() % CORO_TICKS_PER_SEC == 0) {
+      uplinkTick();
+      weatherTick();
+      for (Intersection& ix : intersections) coordPlatoonTick(ix.coordPlatoon);
+      if (coroTicks() > 0 && coroTicks() % (NTCIP_VOLUME_PERIOD_SEC * CORO_TICKS_PER_SEC) == 0) {
+        ntcipVolumeTick();
+      }
+      if (INTERSECTIONS > 1 && coroTicks() % (LCD_PAGE_SEC * CORO_TICKS_PER_SEC) == 0) {
+        lcdNextPage();
+      }
+      if (coroAllocFailures > 0) faultFlags |= FAULT_CORO_POOL;
+      if (heapAllocCount > 0)    faultFlags |= FAULT_HEAP_ALLOC;
+    }
+    co_await ticks(1);
+  }
+}
 
-  phaseEwGreen();
-  phaseEwYellow();
-  phasePedestrianIfRequested();   // if pedRequest, MUST go now before NS green
+// Outside the scheduler: it must work with the frame pool exhausted.
+// A script (or a task the heads depend on) that cannot run would leave
+// them frozen on whatever they showed, so every unit goes to red flash
+// (vehicle reds at 1 Hz, ped heads dark) and stays there.
+void failFlashPoll() {
+  if (!failFlash) {
+    if (!coroFailed()) return;
+    failFlash   = true;
+    faultFlags |= FAULT_CORO_POOL;
+    for (Intersection& ix : intersections) {
+      coroCancel(ix.scriptSlot);
+      ix.scriptSlot = -1;
+      lcdShowTwoLines(ix.page, "FAULT: TASKS", "Red flash");
+    }
+    Serial.printf("FAULT tasks alloc=%lu spawn=%lu: red flash\n",
+                  (unsigned long)coroAllocFailures, (unsigned long)coroSpawnFailures);
+  }
+  bool on = coroTicks() % CORO_TICKS_PER_SEC < CORO_TICKS_PER_SEC / 2;
+  for (Intersection& ix : intersections) {
+    setAllVehicleRed(ix);
+    headSet(ix, SIG_NS_RED, on);
+    headSet(ix, SIG_EW_RED, on);
+    headSet(ix, SIG_PED_RED, false);
+    headSet(ix, SIG_PED_GREEN, false);
+  }
+  sigCommit();
 }
 
 // ============= BUTTON HANDLING =============
 
 void readButtons() {
+  LatStamp readAt  = detScanInputs();   // every detector, one bulk read
+  bool     handled = false;
+  for (Intersection& ix : intersections) {
+    if (handleDetectors(ix, readAt)) handled = true;
+  }
+
+  // A press blocks for its LCD update and debounce; scan again so a
+  // short press during that wait is pending next tick, not missed
+  if (handled) detScanInputs();
+}
+
+// One intersection's inputs from the last scan; true if any press
+// was handled. Latency is measured on unit 0's inputs only.
+bool handleDetectors(Intersection& ix, const LatStamp& readAt) {
+  const int  in      = ix.index * DET_HEAD_INPUTS;
+  const bool lat     = ix.index == 0;
+  LatStamp   edge    = {0, 0};
+  bool       handled = false;
+
+  // Railroad preemption call first: nothing below may delay it. The
+  // NO contact's edge keeps a call shorter than a tick.
+  bool railFell = detTakeFell(detScan, in + DET_RAIL_CHECK);
+  bool railCall = railCallActive(ix);
+  if ((railFell || railCall) && ix.rail == RAIL_IDLE) {
+    bool timed = lat && latTakeEdge(LAT_IN_RAIL, edge);
+    railPreemptStart(ix, timed ? edge : readAt, timed);
+    handled = true;
+  }
+  if (lat && !railCall) latDropStaleEdge(LAT_IN_RAIL, readAt);
+  railSupervise(ix);
+
+  // Trap loops: their edge times the vehicle reaching the count loop
+  if (detTakeFell(detScan, in + DET_NS_TRAP)) ix.vehClass[PLAN_APPROACH_NS].trapUs = readAt.us;
+  if (detTakeFell(detScan, in + DET_EW_TRAP)) ix.vehClass[PLAN_APPROACH_EW].trapUs = readAt.us;
+
+  // Stop-line loops: with GPIO inputs their interrupts judged them
+  if (detTakeFell(detScan, in + DET_NS_STOP) && !RLR_STOP_GPIO) {
+    rlrEntered(ix, PLAN_APPROACH_NS, readAt.us);
+  }
+  if (detTakeFell(detScan, in + DET_EW_STOP) && !RLR_STOP_GPIO) {
+    rlrEntered(ix, PLAN_APPROACH_EW, readAt.us);
+  }
+
   // NS vehicle count button
-  bool nsBtn = digitalRead(PIN_BTN_NS_TRAFFIC);
-  if (nsBtn == LOW && lastNsBtnState == HIGH) {      // just pressed
-    if (isNsRed()) {                                 // NS must be red
-      trafficCountNS++;                              // no upper limit
-
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.print("NS RED: Count");
-      lcd.setCursor(0, 1);
-      lcd.print("NS=");
-      lcd.print(trafficCountNS);
+  if (detTakeFell(detScan, in + DET_NS)) {           // just pressed
+    handled = true;
+    ix.detVolume[0]++;
+    bool timed = lat && latTakeEdge(LAT_IN_NS, edge);
+    classifyPress(ix, PLAN_APPROACH_NS, readAt.us, isNsRed(ix));
+    if (isNsRed(ix)) {                               // NS must be red
+      ix.trafficCountNS++;                           // no upper limit
+      uint32_t seq = timed ? latPress(LAT_IN_NS, edge, latNow()) : 0;
+
+      ix.page.clear();
+      ix.page.setCursor(0, 0);
+      ix.page.print("NS RED: Count");
+      ix.page.setCursor(0, 1);
+      ix.page.print("NS=");
+      ix.page.print(ix.trafficCountNS);
+      if (timed) latStage(LAT_IN_NS, seq, edge, LAT_STAGE_LCD, latNow());
     } else {
-      lcdShowTwoLines("NS not RED", "No count");
+      lcdShowTwoLines(ix.page, "NS not RED", "No count");
     }
     delay(30);   // small debounce
   }
-  lastNsBtnState = nsBtn;
+  bool nsLow = detIsLow(detScan, in + DET_NS);
+  if (lat && !nsLow) latDropStaleEdge(LAT_IN_NS, readAt);
+  if (!nsLow && ix.vehClass[PLAN_APPROACH_NS].on) classifyRelease(ix, PLAN_APPROACH_NS, readAt.us);
+  updateStuckFault(nsLow, ix.nsBtnLowPolls, ix.faults, FAULT_NS_BTN_STUCK);
 
   // EW vehicle count button
-  bool ewBtn = digitalRead(PIN_BTN_EW_TRAFFIC);
-  if (ewBtn == LOW && lastEwBtnState == HIGH) {      // just pressed
-    if (isEwRed()) {                                 // EW must be red
-      trafficCountEW++;                              // no upper limit
-
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.print("EW RED: Count");
-      lcd.setCursor(0, 1);
-      lcd.print("EW=");
-      lcd.print(trafficCountEW);
+  if (detTakeFell(detScan, in + DET_EW)) {           // just pressed
+    handled = true;
+    ix.detVolume[1]++;
+    bool timed = lat && latTakeEdge(LAT_IN_EW, edge);
+    classifyPress(ix, PLAN_APPROACH_EW, readAt.us, isEwRed(ix));
+    if (isEwRed(ix)) {                               // EW must be red
+      ix.trafficCountEW++;                           // no upper limit
+      uint32_t seq = timed ? latPress(LAT_IN_EW, edge, latNow()) : 0;
+
+      ix.page.clear();
+      ix.page.setCursor(0, 0);
+      ix.page.print("EW RED: Count");
+      ix.page.setCursor(0, 1);
+      ix.page.print("EW=");
+      ix.page.print(ix.trafficCountEW);
+      if (timed) latStage(LAT_IN_EW, seq, edge, LAT_STAGE_LCD, latNow());
     } else {
-      lcdShowTwoLines("EW not RED", "No count");
+      lcdShowTwoLines(ix.page, "EW not RED", "No count");
     }
     delay(30);   // small debounce
   }
-  lastEwBtnState = ewBtn;
+  bool ewLow = detIsLow(detScan, in + DET_EW);
+  if (lat && !ewLow) latDropStaleEdge(LAT_IN_EW, readAt);
+  if (!ewLow && ix.vehClass[PLAN_APPROACH_EW].on) classifyRelease(ix, PLAN_APPROACH_EW, readAt.us);
+  updateStuckFault(ewLow, ix.ewBtnLowPolls, ix.faults, FAULT_EW_BTN_STUCK);
 
   // Pedestrian request button
-  bool pedBtn = digitalRead(PIN_BTN_PED_REQUEST);
-  if (pedBtn == LOW && lastPedBtnState == HIGH) {    // just pressed
-    pedRequest = true;                               // latched
-    lcdShowTwoLines("Pedestrian Req", "Stored");
+  if (detTakeFell(detScan, in + DET_PED)) {          // just pressed
+    handled = true;
+    bool timed = lat && latTakeEdge(LAT_IN_PED, edge);
+    ix.pedRequest = true;                            // latched
+    uint32_t seq = timed ? latPress(LAT_IN_PED, edge, latNow()) : 0;
+
+    // Tell the pedestrian roughly how long until WALK
+    TtcEstimate est[3];
+    predictTimeToChange(ix, est);
+    char line2[17];
+    if (ix.phase == PHASE_PED_GREEN || est[TTC_PED].likelyDs == TTC_UNKNOWN) {
+      snprintf(line2, sizeof(line2), "Stored");
+    } else {
+      snprintf(line2, sizeof(line2), "Walk in ~%ds",
+               (int)((est[TTC_PED].likelyDs + 9) / 10) % 1000);
+    }
+    lcdShowTwoLines(ix.page, "Pedestrian Req", line2);
+    if (timed) latStage(LAT_IN_PED, seq, edge, LAT_STAGE_LCD, latNow());
     delay(30);
   }
-  lastPedBtnState = pedBtn;
+  bool pedLow = detIsLow(detScan, in + DET_PED);
+  if (lat && !pedLow) latDropStaleEdge(LAT_IN_PED, readAt);
+  updateStuckFault(pedLow, ix.pedBtnLowPolls, ix.faults, FAULT_PED_BTN_STUCK);
+
+  return handled;
+}
+
+// A detector held low for ~30 s is flagged; the fault clears on release
+void updateStuckFault(bool btnLow, int& lowPolls, uint8_t& faults, uint8_t faultBit) {
+  if (!btnLow) {
+    lowPolls = 0;
+    faults &= ~faultBit;
+    return;
+  }
+  if (lowPolls < BTN_STUCK_POLLS) {
+    lowPolls++;
+  } else {
+    faults |= faultBit;
+  }
 }
 
-// ============= TIMING HELPER (NO millis) =============
+// ============= VEHICLE CLASSIFICATION =============
+
+// Count loop leading edge. A vehicle that joins the red queue adds a
+// car's PCE at once; its class corrects that when it leaves the loop.
+void classifyPress(Intersection& ix, int approach, int64_t atUs, bool counted) {
+  VehClassifier& c = ix.vehClass[approach];
+  if (c.on) classifyRelease(ix, approach, atUs);   // gap shorter than a scan
+  c.on      = true;
+  c.counted = counted;
+  c.onUs    = atUs;
+  c.speed   = vehTrapSpeed(c.trapUs, atUs);
+  c.trapUs  = -1;
+  if (counted) ix.trafficPce[approach] += VEH_CLASS_INFO[VEH_CAR].pceTenths;
+}
 
-// 1 second = 50 × (readButtons + 20 ms)
-void waitOneSecondWithButtons() {
-  for (int i = 0; i < 50; i++) {
-    readButtons();
-    delay(20);
+void classifyRelease(Intersection& ix, int approach, int64_t atUs) {
+  VehClassifier& c   = ix.vehClass[approach];
+  VehClass       cls = vehClassify(atUs - c.onUs, c.speed);
+  c.on = false;
+  ix.classCounts[approach][cls]++;
+  if (c.counted) {
+    ix.trafficPce[approach] += VEH_CLASS_INFO[cls].pceTenths - VEH_CLASS_INFO[VEH_CAR].pceTenths;
   }
 }
 
+void printClassStatus() {
+  static const char* const APPROACHES[] = {"ns", "ew"};
+  for (Intersection& ix : intersections) {
+    for (int a = 0; a < 2; a++) {
+      Serial.printf("CLASS%s %s", ix.tag, APPROACHES[a]);
+      for (int c = 0; c < VEH_CLASSES; c++) {
+        Serial.printf(" %s=%lu", VEH_CLASS_INFO[c].name, (unsigned long)ix.classCounts[a][c]);
+      }
+      Serial.printf(" queue_pce=%d.%d last_speed=%ldkmh\n", ix.trafficPce[a] / 10,
+                    ix.trafficPce[a] % 10, (long)(ix.vehClass[a].speed * 36 / 10000));
+    }
+  }
+}
+
+// ============= RED-LIGHT RUNNING =============
+
+void rlrBegin() {
+#if RLR_CAMERA
+  pinMode(PIN_CAMERA_TRIGGER, OUTPUT);
+  digitalWrite(PIN_CAMERA_TRIGGER, LOW);
+#endif
+#if RLR_STOP_GPIO
+  attachInterrupt(digitalPinToInterrupt(PIN_STOP_NS), onNsStopEdge, FALLING);
+  attachInterrupt(digitalPinToInterrupt(PIN_STOP_EW), onEwStopEdge, FALLING);
+#endif
+}
+
+// Called for every committed frame: the heads' changes take effect now
+void rlrTrackHeads() {
+  uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+  for (Intersection& ix : intersections) {
+    int out = ix.index * SIG_HEAD_OUTPUTS;
+    rlrShow(ix.rlrHeads[PLAN_APPROACH_NS],
+            rlrAspectOf(sigIsOn(sigCommitted, out + SIG_NS_GREEN),
+                        sigIsOn(sigCommitted, out + SIG_NS_YELLOW)), ms);
+    rlrShow(ix.rlrHeads[PLAN_APPROACH_EW],
+            rlrAspectOf(sigIsOn(sigCommitted, out + SIG_EW_GREEN),
+                        sigIsOn(sigCommitted, out + SIG_EW_YELLOW)), ms);
+  }
+}
+
+// A vehicle reached a stop-line loop at atUs. Runs in the loop's
+// GPIO interrupt (GPIO inputs) or from the scan; never both. The
+// camera serves unit 0's approaches; rlrPoll() drives its pin.
+void IRAM_ATTR rlrEntered(Intersection& ix, int approach, int64_t atUs) {
+  uint32_t ms        = (uint32_t)(atUs / 1000);
+  uint32_t intoRedMs = 0;
+  RlrHead& h         = ix.rlrHeads[approach];
+  if (rlrEntry(h, ms, intoRedMs) != RLR_VIOLATION) return;
+
+  bool camera = RLR_CAMERA && ix.index == 0;
+  if (camera) rlrCameraFire = true;
+  rlrLog[rlrLogHead % RLR_LOG_SIZE] =
+      RlrEvent{(uint8_t)ix.index, (uint8_t)approach, camera, atUs, intoRedMs, h.yellowLenMs};
+  rlrLogHead = rlrLogHead + 1;
+}
+
+void IRAM_ATTR onNsStopEdge() {
+  rlrEntered(intersections[0], PLAN_APPROACH_NS, esp_timer_get_time());
+}
+
+void IRAM_ATTR onEwStopEdge() {
+  rlrEntered(intersections[0], PLAN_APPROACH_EW, esp_timer_get_time());
+}
+
+// Every tick: report new violations, start or end the camera pulse. The
+// pulse starts here rather than in the interrupt (gpio_set_level() is
+// not in IRAM), within a tick of the edge; the logged time is the edge's.
+void rlrPoll() {
+  uint32_t head = rlrLogHead;
+  if (head - rlrLogReported > (uint32_t)RLR_LOG_SIZE) rlrLogReported = head - RLR_LOG_SIZE;
+  for (; rlrLogReported != head; rlrLogReported++) {
+    const RlrEvent& e = rlrLog[rlrLogReported % RLR_LOG_SIZE];
+    if (e.camera) rlrCameraPulses++;
+    printRlrEvent(e);
+  }
+
+  // Another violation during the pulse stretches it
+  uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+  if (rlrCameraFire) {
+    rlrCameraFire  = false;
+    rlrCameraOffMs = ms + RLR_CAMERA_PULSE_MS;
+    if (!rlrCameraOn) digitalWrite(PIN_CAMERA_TRIGGER, HIGH);
+    rlrCameraOn = true;
+  } else if (rlrCameraOn && (int32_t)(rlrCameraOffMs - ms) <= 0) {
+    rlrCameraOn = false;
+    digitalWrite(PIN_CAMERA_TRIGGER, LOW);
+  }
+}
+
+// Time on the disciplined clock, for matching the camera's images
+void printRlrEvent(const RlrEvent& e) {
+  static const char* const APPROACHES[] = {"ns", "ew"};
+  Serial.printf("RLR%s %s at=%lldms red+%lums yellow=%lums cam=%d\n",
+                intersections[e.unit].tag, APPROACHES[e.approach],
+                (long long)(clockAt(sysClock, e.atUs) / 1000), (unsigned long)e.intoRedMs,
+                (unsigned long)e.yellowLenMs, e.camera ? 1 : 0);
+}
+
+void printRlrStatus() {
+  static const char* const APPROACHES[] = {"ns", "ew"};
+  for (Intersection& ix : intersections) {
+    for (int a = 0; a < 2; a++) {
+      const RlrHead& h = ix.rlrHeads[a];
+      Serial.printf("RLR%s %s entries=%lu grace=%lu violations=%lu\n", ix.tag, APPROACHES[a],
+                    (unsigned long)h.entries, (unsigned long)h.graceEntries,
+                    (unsigned long)h.violations);
+    }
+  }
+  Serial.printf("RLR logged=%lu camera=%d pulses=%lu\n", (unsigned long)rlrLogHead, RLR_CAMERA,
+                (unsigned long)rlrCameraPulses);
+  uint32_t head = rlrLogHead;
+  for (uint32_t i = head > (uint32_t)RLR_LOG_SIZE ? head - RLR_LOG_SIZE : 0; i != head; i++) {
+    printRlrEvent(rlrLog[i % RLR_LOG_SIZE]);
+  }
+}
+
+// ============= TIMING HELPER (NO millis) =============
+
+// One countdown second (50 ticks). Records where it started so the
+// time-to-change code knows how much of it is left.
+TickAwaiter countdownSecond(Intersection& ix) {
+  ix.secondStartTick = coroTicks();
+  return seconds(1);
+}
+
+// 20 ms poll index (0..49) within the current countdown second
+int pollInSecond(Intersection& ix) {
+  int poll = (int)(coroTicks() - ix.secondStartTick);
+  if (poll < 0) return 0;
+  return poll < CORO_TICKS_PER_SEC ? poll : CORO_TICKS_PER_SEC - 1;
+}
+
 // ============= PHASE FUNCTIONS =============
 
-void phaseNsGreen() {
-  currentPhase = PHASE_NS_GREEN;
+Task phaseNsGreen(Intersection& ix) {
+  setPhase(ix, PHASE_NS_GREEN);
 
   // Total green time based on NS traffic count
-  int totalSecs = computeNsGreenSeconds();
-  int baseSecs  = BASE_GREEN_SEC;
+  int totalSecs = computeNsGreenSeconds(ix);
+  int baseSecs  = ix.activePlan.approaches[PLAN_APPROACH_NS].baseSec;
   int extraSecs = totalSecs - baseSecs;
   if (extraSecs < 0) extraSecs = 0;
 
-  setNsGreenState();
+  setNsGreenState(ix);
+  ix.phaseTotalSec = totalSecs;
+  coordSendEvent(ix, COORD_EVT_GREEN_START, COORD_APPROACH_NS, ix.trafficCountNS, totalSecs);
 
   // Countdown loop (GREEN duration) – syncs exactly with signal
   for (int remaining = totalSecs; remaining > 0; remaining--) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
+    ix.phaseRemainingSec = remaining;
+    ix.page.clear();
+    ix.page.setCursor(0, 0);
     // Line 1 example: "NSG 10+20s"
-    lcd.print("NSG ");
-    lcd.print(baseSecs);
-    lcd.print("+");
-    lcd.print(extraSecs);
-    lcd.print("s");
+    ix.page.print("NSG ");
+    ix.page.print(baseSecs);
+    ix.page.print("+");
+    ix.page.print(extraSecs);
+    ix.page.print("s");
 
     // Line 2 example: "T=30 EW=14"
-    lcd.setCursor(0, 1);
-    lcd.print("T=");
-    lcd.print(remaining);
-    lcd.print(" EW=");
-    lcd.print(trafficCountEW);   // vehicles currently waiting on EW (red)
+    ix.page.setCursor(0, 1);
+    ix.page.print("T=");
+    ix.page.print(remaining);
+    ix.page.print(" EW=");
+    ix.page.print(ix.trafficCountEW);   // vehicles currently waiting on EW (red)
 
-    waitOneSecondWithButtons();  // 1-second tick with frequent button checks
+    co_await countdownSecond(ix);  // 1-second tick; buttons polled by detectorTask
   }
 
   // After NS green is served, reset its own old queue
-  trafficCountNS = 0;
+  endGreen(ix, PLAN_APPROACH_NS);
 }
 
-void phaseNsYellow() {
-  currentPhase = PHASE_NS_YELLOW;
-
-  // Yellow phase – show NSY + EW count
-  for (int remaining = YELLOW_TIME_SEC; remaining > 0; remaining--) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("NSY T=");
-    lcd.print(remaining);
-    lcd.print("s");
+// Green over (served, cut, or a preemption green): report it to the
+// coordination peers and move the served queue into the volume
+void endGreen(Intersection& ix, int approach) {
+  bool ns    = approach == PLAN_APPROACH_NS;
+  int& count = ns ? ix.trafficCountNS : ix.trafficCountEW;
+  coordSendEvent(ix, COORD_EVT_GREEN_END, ns ? COORD_APPROACH_NS : COORD_APPROACH_EW, count,
+                 ix.phaseTotalSec);
+  (ns ? ix.volumeNS : ix.volumeEW) += count;
+  count = 0;
+  ix.trafficPce[approach] = 0;
+  ix.vehClass[approach].counted = false;
+}
 
-    lcd.setCursor(0, 1);
-    lcd.print("EW=");
-    lcd.print(trafficCountEW);
+Task phaseNsYellow(Intersection& ix) {
+  setPhase(ix, PHASE_NS_YELLOW);
 
-    setNsYellowState();
-    waitOneSecondWithButtons();
+  // Yellow phase – show NSY + EW count
+  for (int remaining = ix.activePlan.yellowSec; remaining > 0; remaining--) {
+    ix.phaseRemainingSec = remaining;
+    ix.page.clear();
+    ix.page.setCursor(0, 0);
+    ix.page.print("NSY T=");
+    ix.page.print(remaining);
+    ix.page.print("s");
+
+    ix.page.setCursor(0, 1);
+    ix.page.print("EW=");
+    ix.page.print(ix.trafficCountEW);
+
+    setNsYellowState(ix);
+    co_await countdownSecond(ix);
   }
 }
 
-void phaseEwGreen() {
-  currentPhase = PHASE_EW_GREEN;
+Task phaseEwGreen(Intersection& ix) {
+  setPhase(ix, PHASE_EW_GREEN);
 
-  int totalSecs = computeEwGreenSeconds();
-  int baseSecs  = BASE_GREEN_SEC;
+  int totalSecs = computeEwGreenSeconds(ix);
+  int baseSecs  = ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec;
   int extraSecs = totalSecs - baseSecs;
   if (extraSecs < 0) extraSecs = 0;
 
-  setEwGreenState();
+  setEwGreenState(ix);
+  ix.phaseTotalSec = totalSecs;
+  coordSendEvent(ix, COORD_EVT_GREEN_START, COORD_APPROACH_EW, ix.trafficCountEW, totalSecs);
 
   // Countdown loop for EW green
   for (int remaining = totalSecs; remaining > 0; remaining--) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
+    // Hand over early if an upstream NS platoon is about to arrive
+    if (coordShouldEndEwGreen(ix, totalSecs - remaining)) break;
+
+    ix.phaseRemainingSec = remaining;
+    ix.page.clear();
+    ix.page.setCursor(0, 0);
     // Line 1: "EWG 10+20s"
-    lcd.print("EWG ");
-    lcd.print(baseSecs);
-    lcd.print("+");
-    lcd.print(extraSecs);
-    lcd.print("s");
+    ix.page.print("EWG ");
+    ix.page.print(baseSecs);
+    ix.page.print("+");
+    ix.page.print(extraSecs);
+    ix.page.print("s");
 
     // Line 2: "T=30 NS=7"
-    lcd.setCursor(0, 1);
-    lcd.print("T=");
-    lcd.print(remaining);
-    lcd.print(" NS=");
-    lcd.print(trafficCountNS);   // vehicles currently waiting on NS (red)
+    ix.page.setCursor(0, 1);
+    ix.page.print("T=");
+    ix.page.print(remaining);
+    ix.page.print(" NS=");
+    ix.page.print(ix.trafficCountNS);   // vehicles currently waiting on NS (red)
 
-    waitOneSecondWithButtons();
+    co_await countdownSecond(ix);
   }
 
-  trafficCountEW = 0;
+  endGreen(ix, PLAN_APPROACH_EW);
 }
 
-void phaseEwYellow() {
-  currentPhase = PHASE_EW_YELLOW;
+Task phaseEwYellow(Intersection& ix) {
+  setPhase(ix, PHASE_EW_YELLOW);
 
   // Yellow phase – show EWY + NS count
-  for (int remaining = YELLOW_TIME_SEC; remaining > 0; remaining--) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("EWY T=");
-    lcd.print(remaining);
-    lcd.print("s");
-
-    lcd.setCursor(0, 1);
-    lcd.print("NS=");
-    lcd.print(trafficCountNS);
-
-    setEwYellowState();
-    waitOneSecondWithButtons();
+  for (int remaining = ix.activePlan.yellowSec; remaining > 0; remaining--) {
+    ix.phaseRemainingSec = remaining;
+    ix.page.clear();
+    ix.page.setCursor(0, 0);
+    ix.page.print("EWY T=");
+    ix.page.print(remaining);
+    ix.page.print("s");
+
+    ix.page.setCursor(0, 1);
+    ix.page.print("NS=");
+    ix.page.print(ix.trafficCountNS);
+
+    setEwYellowState(ix);
+    co_await countdownSecond(ix);
   }
 }
 
-void phasePedestrianIfRequested() {
-  if (!pedRequest) return;   // No request → skip
+Task phasePedestrianIfRequested(Intersection& ix) {
+  if (!ix.pedRequest) co_return;   // No request → skip
 
-  currentPhase = PHASE_PED_GREEN;
+  setPhase(ix, PHASE_PED_GREEN);
 
-  setPedestrianGreenState();
+  setPedestrianGreenState(ix);
 
   // Pedestrian green with countdown
-  for (int remaining = PED_TIME_SEC; remaining > 0; remaining--) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("PEDESTRIAN");
-    lcd.setCursor(0, 1);
-    lcd.print("T=");
-    lcd.print(remaining);
-    lcd.print(" WALK");
-
-    waitOneSecondWithButtons();
+  for (int remaining = ix.activePlan.pedSec; remaining > 0; remaining--) {
+    ix.phaseRemainingSec = remaining;
+    ix.page.clear();
+    ix.page.setCursor(0, 0);
+    ix.page.print("PEDESTRIAN");
+    ix.page.setCursor(0, 1);
+    ix.page.print("T=");
+    ix.page.print(remaining);
+    ix.page.print(" WALK");
+
+    co_await countdownSecond(ix);
   }
 
   // End pedestrian phase: all roads red, ped to red
-  setAllVehicleRed();
-  digitalWrite(PIN_PED_RED, HIGH);
-  digitalWrite(PIN_PED_GREEN, LOW);
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_PED_RED, true);
+  headSet(ix, SIG_PED_GREEN, false);
+  sigCommit();
 
-  lcdShowTwoLines("PEDESTRIAN", "STOP");
-  delay(500);
+  lcdShowTwoLines(ix.page, "PEDESTRIAN", "STOP");
+  co_await milliseconds(ix.activePlan.pedStopDs * 100);
 
   // This request is now fully served
-  pedRequest = false;
+  ix.pedRequest = false;
+  ix.pedCallsServed++;
+}
+
+// Red clearance after a yellow, when the weather profile asks for one
+Task phaseAllRed(Intersection& ix) {
+  showAllRed(ix);
+  for (int remaining = ix.activePlan.allRedSec; remaining > 0; remaining--) {
+    ix.phaseRemainingSec = remaining;
+    co_await countdownSecond(ix);
+  }
+}
+
+// Also used by railPreempt(), which counts the interval down itself
+void showAllRed(Intersection& ix) {
+  setPhase(ix, PHASE_ALL_RED);
+  ix.phaseTotalSec = ix.activePlan.allRedSec;
+  setAllVehicleRed(ix);
+  sigCommit();
+
+  ix.page.clear();
+  ix.page.setCursor(0, 0);
+  ix.page.print("ALL RED ");
+  ix.page.print(WEATHER_PROFILES[ix.weatherApplied].name);
+  ix.page.setCursor(0, 1);
+  ix.page.print("NS=");
+  ix.page.print(ix.trafficCountNS);
+  ix.page.print(" EW=");
+  ix.page.print(ix.trafficCountEW);
+}
+
+void setPhase(Intersection& ix, Phase p) {
+  ix.phase = p;
+  // unit in the high byte, phase in the low
+  traceMark(TRACE_INSTANT, TRACE_ID_PHASE, (uint16_t)(ix.index << 8 | p));
+}
+
+// ============= RAILROAD PREEMPTION =============
+
+// Green / yellow of one approach, as the phase functions show them; a
+// green's phaseTotalSec is set first, for its coordination event
+void railShowApproach(Intersection& ix, int approach, bool green) {
+  bool ns = approach == PLAN_APPROACH_NS;
+  setPhase(ix, green ? (ns ? PHASE_NS_GREEN : PHASE_EW_GREEN) :
+                       (ns ? PHASE_NS_YELLOW : PHASE_EW_YELLOW));
+  if (green) {
+    ns ? setNsGreenState(ix) : setEwGreenState(ix);
+    coordSendEvent(ix, COORD_EVT_GREEN_START, ns ? COORD_APPROACH_NS : COORD_APPROACH_EW,
+                   ns ? ix.trafficCountNS : ix.trafficCountEW, ix.phaseTotalSec);
+  } else {
+    ns ? setNsYellowState(ix) : setEwYellowState(ix);
+  }
+}
+
+void railShowCount(Intersection& ix, const char* label, int value) {
+  ix.page.clear();
+  ix.page.setCursor(0, 0);
+  ix.page.print("RAIL PREEMPT");
+  ix.page.setCursor(0, 1);
+  ix.page.print(label);
+  ix.page.print(value);
+}
+
+// Called from the detector scan that saw the call. The phase script is
+// dropped mid-interval and the clearance of what it was showing starts
+// here, so the response does not wait for the next tick: a yellow
+// already showing runs out, a conflicting green is closed as served and
+// turns yellow, WALK goes to its all-red clearance. The respawned
+// script carries on with railPreempt().
+void railPreemptStart(Intersection& ix, const LatStamp& callAt, bool timed) {
+  if (failFlash) return;   // no script to preempt: the heads flash red
+  const int dwell = 1 - RAIL_TRACK_APPROACH;
+  uint32_t  seq   = timed ? latPress(LAT_IN_RAIL, callAt, latNow()) : 0;
+
+  coroCancel(ix.scriptSlot);
+  ix.rail           = RAIL_ENTRY;
+  ix.railEntryTicks = 0;
+  switch (ix.phase) {
+    case PHASE_NS_YELLOW:
+    case PHASE_EW_YELLOW:
+    case PHASE_ALL_RED:
+      ix.railEntryTicks = ix.phaseRemainingSec * CORO_TICKS_PER_SEC - pollInSecond(ix);
+      break;
+    case PHASE_PED_GREEN:
+      setPhase(ix, PHASE_ALL_RED);
+      setAllVehicleRed(ix);
+      headSet(ix, SIG_PED_RED, true);
+      headSet(ix, SIG_PED_GREEN, false);
+      sigCommit();
+      ix.phaseTotalSec     = (ix.activePlan.pedStopDs + 9) / 10;
+      ix.phaseRemainingSec = ix.phaseTotalSec;
+      ix.railEntryTicks    = ix.activePlan.pedStopDs * CORO_TICKS_PER_SEC / 10;
+      break;
+    default:
+      if (ix.phase == (dwell == PLAN_APPROACH_NS ? PHASE_NS_GREEN : PHASE_EW_GREEN)) {
+        endGreen(ix, dwell);
+        railShowApproach(ix, dwell, false);
+        ix.phaseRemainingSec = ix.activePlan.yellowSec;
+        ix.railEntryTicks    = ix.activePlan.yellowSec * CORO_TICKS_PER_SEC;
+      }
+      break;   // track approach green: its clearance green goes on
+  }
+
+  LatStamp now = latNow();
+  if (timed) latSignal(LAT_IN_RAIL, now);
+  ix.railResponseUs = latElapsedUs(callAt, now);
+  if (ix.railResponseUs > ix.railResponseMax) ix.railResponseMax = ix.railResponseUs;
+  if (ix.railResponseUs > RAIL_RESPONSE_LIMIT_US) ix.railLate++;
+  ix.railPreempts++;
+
+  ix.scriptSlot = coroSpawn(phaseScript(ix));
+  lcdShowTwoLines(ix.page, "RAIL PREEMPT", "Clearing");
+  if (timed) latStage(LAT_IN_RAIL, seq, callAt, LAT_STAGE_LCD, latNow());
+  Serial.printf("RAIL%s call response=%luus\n", ix.tag, (unsigned long)ix.railResponseUs);
+}
+
+// NC contact open or NO contact closed: either alone is a call
+bool railCallActive(Intersection& ix) {
+  const int in = ix.index * DET_HEAD_INPUTS;
+  return !detIsLow(detScan, in + DET_RAIL) || detIsLow(detScan, in + DET_RAIL_CHECK);
+}
+
+// A healthy relay has exactly one contact closed; both open for a
+// moment is the changeover
+void railSupervise(Intersection& ix) {
+  const int  in       = ix.index * DET_HEAD_INPUTS;
+  const bool ncClosed = detIsLow(detScan, in + DET_RAIL);
+  const bool noClosed = detIsLow(detScan, in + DET_RAIL_CHECK);
+  if (ncClosed != noClosed) {
+    ix.railDisagree = 0;
+    return;
+  }
+  if (ix.railDisagree < RAIL_DISAGREE_TICKS && ++ix.railDisagree == RAIL_DISAGREE_TICKS) {
+    ix.railFaults++;
+    Serial.printf("RAIL%s FAULT contacts disagree nc=%s no=%s\n", ix.tag,
+                  ncClosed ? "closed" : "open", noClosed ? "closed" : "open");
+  }
+  if (ix.railDisagree == RAIL_DISAGREE_TICKS) faultFlags |= FAULT_DETECTOR_IN;
+}
+
+// Entry clearance, track clearance green, then the hold for as long as
+// the call lasts (at least RAIL_MIN_DWELL_SEC); a call that comes back
+// during the exit yellow clears the tracks again. Every yellow gets
+// the weather all-red, counted here to keep to one nested frame; the
+// entry yellow gets at least RAIL_MIN_RED_SEC, as it may be the track
+// approach's own.
+Task railPreempt(Intersection& ix) {
+  const int track = RAIL_TRACK_APPROACH;
+  const int dwell = 1 - track;
+  co_await ticks(ix.railEntryTicks);
+  if (ix.phase == PHASE_NS_YELLOW || ix.phase == PHASE_EW_YELLOW) {
+    int redSec = railEntryRedSec(ix.activePlan);
+    showAllRed(ix);
+    ix.phaseTotalSec = redSec;
+    for (int remaining = redSec; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      co_await countdownSecond(ix);
+    }
+  }
+
+  do {
+    ix.rail          = RAIL_TRACK_CLEAR;
+    ix.phaseTotalSec = RAIL_TRACK_CLEAR_SEC;
+    if (ix.phase != (track == PLAN_APPROACH_NS ? PHASE_NS_GREEN : PHASE_EW_GREEN)) {
+      railShowApproach(ix, track, true);
+    }
+    for (int remaining = RAIL_TRACK_CLEAR_SEC; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      railShowCount(ix, "Track clr T=", remaining);
+      co_await countdownSecond(ix);
+    }
+    endGreen(ix, track);
+    railShowApproach(ix, track, false);
+    for (int remaining = ix.activePlan.yellowSec; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      co_await countdownSecond(ix);
+    }
+    if (ix.activePlan.allRedSec > 0) showAllRed(ix);
+    for (int remaining = ix.activePlan.allRedSec; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      co_await countdownSecond(ix);
+    }
+
+    ix.rail          = RAIL_HOLD;
+    ix.phaseTotalSec = RAIL_MIN_DWELL_SEC;
+    railShowApproach(ix, dwell, true);
+    for (int held = 0; held < RAIL_MIN_DWELL_SEC || railCallActive(ix); held++) {
+      ix.phaseRemainingSec = 1;
+      railShowCount(ix, "Hold s=", held);
+      co_await countdownSecond(ix);
+    }
+
+    ix.rail = RAIL_EXIT;
+    endGreen(ix, dwell);
+    railShowApproach(ix, dwell, false);
+    for (int remaining = ix.activePlan.yellowSec; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      co_await countdownSecond(ix);
+    }
+    if (ix.activePlan.allRedSec > 0) showAllRed(ix);
+    for (int remaining = ix.activePlan.allRedSec; remaining > 0; remaining--) {
+      ix.phaseRemainingSec = remaining;
+      co_await countdownSecond(ix);
+    }
+  } while (railCallActive(ix));
+
+  ix.rail = RAIL_IDLE;
+  Serial.printf("RAIL%s clear\n", ix.tag);
+}
+
+void printRailStatus() {
+  static const char* const STATES[] = {"idle", "entry", "track_clear", "hold", "exit"};
+  for (Intersection& ix : intersections) {
+    Serial.printf("RAIL%s %s call=%d preempts=%lu response=%luus max=%luus late=%lu "
+                  "fault=%d faults=%lu\n",
+                  ix.tag, STATES[ix.rail], railCallActive(ix) ? 1 : 0,
+                  (unsigned long)ix.railPreempts, (unsigned long)ix.railResponseUs,
+                  (unsigned long)ix.railResponseMax, (unsigned long)ix.railLate,
+                  ix.railDisagree == RAIL_DISAGREE_TICKS ? 1 : 0,
+                  (unsigned long)ix.railFaults);
+  }
 }
 
 // ============= RED-STATUS HELPERS =============
 
 // NS is considered "red period" when NS is not green or yellow
-bool isNsRed() {
-  return (currentPhase == PHASE_EW_GREEN ||
-          currentPhase == PHASE_EW_YELLOW ||
-          currentPhase == PHASE_PED_GREEN);
+bool isNsRed(Intersection& ix) {
+  return (ix.phase == PHASE_EW_GREEN ||
+          ix.phase == PHASE_EW_YELLOW ||
+          ix.phase == PHASE_PED_GREEN ||
+          ix.phase == PHASE_ALL_RED);
 }
 
 // EW is considered "red period" when EW is not green or yellow
-bool isEwRed() {
-  return (currentPhase == PHASE_NS_GREEN ||
-          currentPhase == PHASE_NS_YELLOW ||
-          currentPhase == PHASE_PED_GREEN);
+bool isEwRed(Intersection& ix) {
+  return (ix.phase == PHASE_NS_GREEN ||
+          ix.phase == PHASE_NS_YELLOW ||
+          ix.phase == PHASE_PED_GREEN ||
+          ix.phase == PHASE_ALL_RED);
 }
 
 // ============= LED STATE HELPERS =============
 
-void setAllVehicleRed() {
-  digitalWrite(PIN_NS_RED, HIGH);
-  digitalWrite(PIN_NS_YELLOW, LOW);
-  digitalWrite(PIN_NS_GREEN, LOW);
+// Output 'out' (SIG_*) of this intersection's heads
+void headSet(Intersection& ix, int out, bool on) {
+  sigSet(ix.index * SIG_HEAD_OUTPUTS + out, on);
+}
+
+// Helpers compose the frame; callers that change more than the
+// vehicle heads commit themselves
+void setAllVehicleRed(Intersection& ix) {
+  headSet(ix, SIG_NS_RED, true);
+  headSet(ix, SIG_NS_YELLOW, false);
+  headSet(ix, SIG_NS_GREEN, false);
 
-  digitalWrite(PIN_EW_RED, HIGH);
-  digitalWrite(PIN_EW_YELLOW, LOW);
-  digitalWrite(PIN_EW_GREEN, LOW);
+  headSet(ix, SIG_EW_RED, true);
+  headSet(ix, SIG_EW_YELLOW, false);
+  headSet(ix, SIG_EW_GREEN, false);
 }
 
-void setNsGreenState() {
-  setAllVehicleRed();
-  digitalWrite(PIN_NS_RED, LOW);
-  digitalWrite(PIN_NS_GREEN, HIGH);
+void setNsGreenState(Intersection& ix) {
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_NS_RED, false);
+  headSet(ix, SIG_NS_GREEN, true);
+  sigCommit();
+  if (ix.index == 0) latSignal(LAT_IN_NS, latNow());
 }
 
-void setNsYellowState() {
-  setAllVehicleRed();
-  digitalWrite(PIN_NS_RED, LOW);
-  digitalWrite(PIN_NS_YELLOW, HIGH);
+void setNsYellowState(Intersection& ix) {
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_NS_RED, false);
+  headSet(ix, SIG_NS_YELLOW, true);
+  sigCommit();
 }
 
-void setEwGreenState() {
-  setAllVehicleRed();
-  digitalWrite(PIN_EW_RED, LOW);
-  digitalWrite(PIN_EW_GREEN, HIGH);
+void setEwGreenState(Intersection& ix) {
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_EW_RED, false);
+  headSet(ix, SIG_EW_GREEN, true);
+  sigCommit();
+  if (ix.index == 0) latSignal(LAT_IN_EW, latNow());
 }
 
-void setEwYellowState() {
-  setAllVehicleRed();
-  digitalWrite(PIN_EW_RED, LOW);
-  digitalWrite(PIN_EW_YELLOW, HIGH);
+void setEwYellowState(Intersection& ix) {
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_EW_RED, false);
+  headSet(ix, SIG_EW_YELLOW, true);
+  sigCommit();
 }
 
-void setPedestrianGreenState() {
-  setAllVehicleRed();
-  digitalWrite(PIN_PED_RED, LOW);
-  digitalWrite(PIN_PED_GREEN, HIGH);
+void setPedestrianGreenState(Intersection& ix) {
+  setAllVehicleRed(ix);
+  headSet(ix, SIG_PED_RED, false);
+  headSet(ix, SIG_PED_GREEN, true);
+  sigCommit();
+  if (ix.index == 0) latSignal(LAT_IN_PED, latNow());
 }
 
-// ============= GREEN TIME COMPUTATION (NEW LOGIC) =============
+// ============= SIGNAL OUTPUT BACKENDS =============
+
+// VSPI carries the 74HC595 outputs and the 74HC165 inputs. Both
+// chains see every clock; each only acts on its own latch / load pin.
+bool spiBusBegin() {
+  if (spiBusReady) return true;
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num     = SIGNAL_OUTPUT == 1 ? PIN_SR_DATA : -1;
+  bus.miso_io_num     = DETECTOR_INPUT == 1 ? PIN_DET_DATA : -1;
+  bus.sclk_io_num     = PIN_SR_CLOCK;
+  bus.quadwp_io_num   = -1;
+  bus.quadhd_io_num   = -1;
+  bus.max_transfer_sz = SIG_MAX_HC595 > DET_MAX_HC165 ? SIG_MAX_HC595 : DET_MAX_HC165;
+  spiBusReady = spi_bus_initialize(SPI3_HOST, &bus, SPI_DMA_CH_AUTO) == ESP_OK;
+  return spiBusReady;
+}
 
-int computeNsGreenSeconds() {
-  // New logic:
-  // count < 5   -> 10
-  // 5–9         -> 20
-  // 10–14       -> 30
-  // >= 15       -> 40
-  int extra = 0;
-  if (trafficCountNS >= 15) {
-    extra = 30;
-  } else if (trafficCountNS >= 10) {
-    extra = 20;
-  } else if (trafficCountNS >= 5) {
-    extra = 10;
-  } else {
-    extra = 0;
+void sigBegin() {
+#if SIGNAL_OUTPUT == 1
+  pinMode(PIN_SR_LATCH, OUTPUT);
+  digitalWrite(PIN_SR_LATCH, LOW);
+
+  spi_device_interface_config_t dev = {};
+  dev.mode           = 0;
+  dev.clock_speed_hz = SIG_SPI_HZ;
+  dev.spics_io_num   = -1;            // RCLK is pulsed by sigLatchIsr instead
+  dev.queue_size     = 1;
+  dev.post_cb        = sigLatchIsr;
+
+  if (!spiBusBegin() || spi_bus_add_device(SPI3_HOST, &dev, &sigSpi) != ESP_OK) {
+    sigSpi = nullptr;
+    faultFlags |= FAULT_SIGNAL_OUT;
+  }
+#elif SIGNAL_OUTPUT == 2
+  // Latches power up cleared (all off); then make both ports outputs
+  for (int c = 0; c < SIG_MCP_CHIPS; c++) {
+    Wire.beginTransmission(SIG_MCP_ADDR + c);
+    Wire.write(MCP23017_IODIRA);
+    Wire.write(0x00);
+    Wire.write(0x00);
+    if (Wire.endTransmission() != 0) faultFlags |= FAULT_SIGNAL_OUT;
+  }
+#elif SIGNAL_OUTPUT == 3
+  if (!cabBusBegin()) faultFlags |= FAULT_SIGNAL_OUT;
+#else
+  for (int i = 0; i < SIG_OUTPUT_COUNT; i++) pinMode(SIG_GPIO_PINS[i], OUTPUT);
+#endif
+}
+
+void sigSet(int out, bool on) {
+  sigFrame = sigWith(sigFrame, out, on);
+}
+
+// Send the whole frame; every output changes in the same update
+void sigCommit() {
+  if (sigFrame == sigCommitted && !sigDirty) return;
+  bool ok = true;
+
+#if SIGNAL_OUTPUT == 1
+  // One frame in flight; the previous one (a few us) is long done
+  if (sigTransQueued) {
+    spi_transaction_t* done;
+    spi_device_get_trans_result(sigSpi, &done, portMAX_DELAY);
+    sigTransQueued = false;
+  }
+  if (sigSpi) {
+    sigPackHc595(sigFrame, SIG_HC595_CHIPS, sigTxBuf);
+    sigTrans           = {};
+    sigTrans.length    = SIG_HC595_CHIPS * 8;   // bits
+    sigTrans.tx_buffer = sigTxBuf;
+    sigTransQueued = spi_device_queue_trans(sigSpi, &sigTrans, 0) == ESP_OK;
   }
-  return BASE_GREEN_SEC + extra;
+  ok = sigTransQueued;
+#elif SIGNAL_OUTPUT == 2
+  // OLATA and OLATB in one sequential write: an expander's 16
+  // outputs change within one I2C byte of each other
+  for (int c = 0; c < SIG_MCP_CHIPS; c++) {
+    Wire.beginTransmission(SIG_MCP_ADDR + c);
+    Wire.write(MCP23017_OLATA);
+    Wire.write(sigMcpPort(sigFrame, c, 0));
+    Wire.write(sigMcpPort(sigFrame, c, 1));
+    if (Wire.endTransmission() != 0) ok = false;
+  }
+#elif SIGNAL_OUTPUT == 3
+  ok = cabBusReady;   // sent by cabSend() once every task of this tick has run
+#else
+  SigFrame changed = sigDirty ? ~(SigFrame)0 : sigFrame ^ sigCommitted;
+  for (int i = 0; i < SIG_OUTPUT_COUNT; i++) {
+    if (sigIsOn(changed, i)) digitalWrite(SIG_GPIO_PINS[i], sigIsOn(sigFrame, i) ? HIGH : LOW);
+  }
+#endif
+
+  sigCommits++;
+  if (!ok) {
+    sigFailures++;
+    sigDirty = true;
+    faultFlags |= FAULT_SIGNAL_OUT;
+    return;
+  }
+  sigCommitted = sigFrame;
+  sigDirty     = false;
+  rlrTrackHeads();
+}
+
+// End of the SPI DMA transfer: the whole chain is shifted in, one
+// RCLK pulse moves it to the outputs
+void IRAM_ATTR sigLatchIsr(spi_transaction_t* t) {
+  (void)t;
+  gpio_set_level((gpio_num_t)PIN_SR_LATCH, 1);
+  gpio_set_level((gpio_num_t)PIN_SR_LATCH, 0);
+}
+
+void printSignalStatus() {
+  static const char* const BACKENDS[] = {"gpio", "74hc595", "mcp23017", "bus"};
+  Serial.printf("SIG %s outputs=%d frame=%08lX%08lX commits=%lu failures=%lu\n",
+                BACKENDS[SIGNAL_OUTPUT], SIG_OUTPUT_COUNT, (unsigned long)(sigCommitted >> 32),
+                (unsigned long)(uint32_t)sigCommitted, (unsigned long)sigCommits,
+                (unsigned long)sigFailures);
 }
 
-int computeEwGreenSeconds() {
-  int extra = 0;
-  if (trafficCountEW >= 15) {
-    extra = 30;
-  } else if (trafficCountEW >= 10) {
-    extra = 20;
-  } else if (trafficCountEW >= 5) {
-    extra = 10;
+// ============= DETECTOR INPUT BACKENDS =============
+
+void detBegin() {
+#if DETECTOR_INPUT == 1
+  pinMode(PIN_DET_LOAD, OUTPUT);
+  digitalWrite(PIN_DET_LOAD, HIGH);   // shift mode between scans
+
+  spi_device_interface_config_t dev = {};
+  dev.mode           = 0;             // QH is valid before the first clock
+  dev.clock_speed_hz = DET_SPI_HZ;
+  dev.spics_io_num   = -1;
+  dev.queue_size     = 1;
+  dev.pre_cb         = detLoadIsr;
+
+  if (!spiBusBegin() || spi_bus_add_device(SPI3_HOST, &dev, &detSpi) != ESP_OK) {
+    detSpi = nullptr;
+    faultFlags |= FAULT_DETECTOR_IN;
+  }
+#elif DETECTOR_INPUT == 2
+  // Ports are inputs from power-up: add pull-ups and interrupt on
+  // any change, both ports on one open-drain INT line
+  for (int c = 0; c < DET_MCP_CHIPS; c++) {
+    uint8_t addr = DET_MCP_ADDR + c;
+    Wire.beginTransmission(addr);
+    Wire.write(MCP23017_IOCON);
+    Wire.write(MCP23017_IOCON_MIRROR | MCP23017_IOCON_ODR);
+    uint8_t err = Wire.endTransmission();
+
+    Wire.beginTransmission(addr);
+    Wire.write(MCP23017_GPINTENA);
+    Wire.write(0xFF);
+    Wire.write(0xFF);
+    err |= Wire.endTransmission();
+
+    Wire.beginTransmission(addr);
+    Wire.write(MCP23017_GPPUA);
+    Wire.write(0xFF);
+    Wire.write(0xFF);
+    err |= Wire.endTransmission();
+    if (err != 0) faultFlags |= FAULT_DETECTOR_IN;
+  }
+  pinMode(PIN_DET_INT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_DET_INT), onDetInt, FALLING);
+#elif DETECTOR_INPUT == 3
+  if (!cabBusBegin()) faultFlags |= FAULT_DETECTOR_IN;
+  // One exchange before the first scan: until the cabinet answers, its
+  // rail NC contacts read open and every unit would be preempted
+  cabSend();
+  for (int i = 0; i < CAB_TIMEOUT_TICKS && cabBusReady && !cabOnline; i++) {
+    delay(POLL_PERIOD_US / 1000);
+    cabReceive();
+  }
+#else
+  for (int i = 0; i < DET_INPUT_COUNT; i++) pinMode(DET_GPIO_PINS[i], INPUT_PULLUP);
+#endif
+}
+
+// One bulk read of every input into detScan; returns when it was taken.
+// An input that cannot be read keeps its last level.
+LatStamp detScanInputs() {
+  LatStamp at    = latNow();
+  DetFrame level = detScan.level;
+  detScans++;
+#if DETECTOR_INPUT != 0
+  LatStamp edgeAt = at;   // when new presses happened, as far as known
+#endif
+
+#if DETECTOR_INPUT == 1
+  if (detSpi) {
+    spi_transaction_t t = {};
+    t.length    = DET_HC165_CHIPS * 8;   // bits
+    t.rx_buffer = detRxBuf;
+    if (spi_device_transmit(detSpi, &t) == ESP_OK) {
+      level = detUnpackHc165(detRxBuf, DET_HC165_CHIPS);
+      detReads++;
+    } else {
+      faultFlags |= FAULT_DETECTOR_IN;
+    }
+  }
+#elif DETECTOR_INPUT == 2
+  // Read only when an expander interrupted (or for the periodic resync)
+  if (detIntPending || coroTicks() - detReadTick >= (uint32_t)DET_RESYNC_TICKS) {
+    if (detIntPending) edgeAt = LatStamp{detIntCycles, detIntUs};
+    detIntPending = false;   // an interrupt from here on triggers the next read
+    detReadTick   = coroTicks();
+    detReads++;
+    for (int c = 0; c < DET_MCP_CHIPS; c++) {
+      uint8_t addr = DET_MCP_ADDR + c;
+      uint8_t regs[DET_MCP_INT_REGS];
+      Wire.beginTransmission(addr);
+      Wire.write(MCP23017_INTFA);
+      if (Wire.endTransmission(false) != 0 ||
+          Wire.requestFrom(addr, (uint8_t)DET_MCP_INT_REGS) != DET_MCP_INT_REGS) {
+        faultFlags |= FAULT_DETECTOR_IN;
+        continue;
+      }
+      for (int i = 0; i < DET_MCP_INT_REGS; i++) regs[i] = (uint8_t)Wire.read();
+      level = detWithMcp(level, c, detMcpPorts(regs));   // reading GPIO clears INT
+    }
+  }
+#elif DETECTOR_INPUT == 3
+  level = cabReceive();
+#else
+  for (int i = 0; i < DET_INPUT_COUNT; i++) {
+    DetFrame bit = (DetFrame)1 << i;
+    level = digitalRead(DET_GPIO_PINS[i]) == HIGH ? (level | bit) : (level & ~bit);
+  }
+  detReads++;
+#endif
+
+#if DETECTOR_INPUT != 0
+  // No per-button interrupts: stamp presses at the expander interrupt,
+  // or at the scan for the 74HC165 / bus (latency then excludes the
+  // tick wait)
+  DetFrame fell = detUpdate(detScan, level);
+  for (int i = 0; i < LAT_PIN_INPUTS; i++) {
+    if ((fell >> i) & 1) latMarkEdge(i, edgeAt);
+  }
+#else
+  detUpdate(detScan, level);
+#endif
+  return at;
+}
+
+// Start of the SPI transfer: SH/LD low loads every register at once
+void IRAM_ATTR detLoadIsr(spi_transaction_t* t) {
+  (void)t;
+  gpio_set_level((gpio_num_t)PIN_DET_LOAD, 0);
+  gpio_set_level((gpio_num_t)PIN_DET_LOAD, 1);
+}
+
+void IRAM_ATTR onDetInt() {
+  if (detIntPending) return;
+  detIntCycles  = esp_cpu_get_cycle_count();
+  detIntUs      = esp_timer_get_time();
+  detIntPending = true;
+}
+
+void printDetectorStatus() {
+  static const char* const BACKENDS[] = {"gpio", "74hc165", "mcp23017", "bus"};
+  Serial.printf("DET %s inputs=%d level=%08lX%08lX scans=%lu reads=%lu\n",
+                BACKENDS[DETECTOR_INPUT], DET_INPUT_COUNT, (unsigned long)(detScan.level >> 32),
+                (unsigned long)(uint32_t)detScan.level, (unsigned long)detScans,
+                (unsigned long)detReads);
+}
+
+// ============= CABINET BUS =============
+
+// UART2 through the IDF driver: frames are copied into its ring
+// buffers and moved by the UART interrupt, so an exchange costs the
+// loop two short copies, never a byte-by-byte wait
+bool cabBusBegin() {
+  if (cabBusReady) return true;
+  cabDecoderReset(cabRx);
+
+  uart_config_t cfg = {};
+  cfg.baud_rate  = CAB_BAUD;
+  cfg.data_bits  = UART_DATA_8_BITS;
+  cfg.parity     = UART_PARITY_DISABLE;
+  cfg.stop_bits  = UART_STOP_BITS_1;
+  cfg.flow_ctrl  = UART_HW_FLOWCTRL_DISABLE;
+  cfg.source_clk = UART_SCLK_DEFAULT;
+
+  bool ok = uart_driver_install(CAB_UART, CAB_UART_BUF, CAB_UART_BUF, 0, nullptr, 0) == ESP_OK;
+  ok = ok && uart_param_config(CAB_UART, &cfg) == ESP_OK;
+  ok = ok && uart_set_pin(CAB_UART, PIN_BUS_TX, PIN_BUS_RX, PIN_BUS_DE,
+                          UART_PIN_NO_CHANGE) == ESP_OK;
+  ok = ok && uart_set_mode(CAB_UART, UART_MODE_RS485_HALF_DUPLEX) == ESP_OK;
+  cabBusReady = ok;
+  cabRxTick = coroTicks();
+  return cabBusReady;
+}
+
+// Take the cabinet's answers. Returns the newest input frame; all
+// released while the cabinet is silent, so a dead bus cannot hold a
+// detector call (and the rail NC contacts read open: it preempts).
+DetFrame cabReceive() {
+  if (!cabBusReady) return cabInputs;
+
+  uint8_t  rx[64];
+  int      n;
+  CabFrame f;
+  while ((n = uart_read_bytes(CAB_UART, rx, sizeof(rx), 0)) > 0) {
+    for (int i = 0; i < n; i++) {
+      if (!cabDecodeByte(cabRx, rx[i], f)) continue;
+      if (f.addr != CAB_ADDR_CABINET || f.type != CAB_TYPE_INPUTS) continue;
+      cabInputs = f.data;
+      cabRxTick = coroTicks();
+      cabOnline = true;
+      detReads++;
+    }
+  }
+  if (coroTicks() - cabRxTick > (uint32_t)CAB_TIMEOUT_TICKS) {
+    if (cabOnline) cabTimeouts++;
+    cabOnline = false;
+    cabInputs = ~(DetFrame)0;
+    faultFlags |= FAULT_DETECTOR_IN;
+  }
+  return cabInputs;
+}
+
+// Called by loop() after every task of the tick, so the frame carries
+// what all units' scripts committed this tick. Fixed rate: one frame
+// per tick, also when nothing changed (the cabinet flashes the
+// intersection when frames stop).
+void cabSend() {
+  if (!cabBusReady) return;
+  CabFrame out = {CAB_ADDR_CABINET, CAB_TYPE_OUTPUTS, cabTxSeq++, sigCommitted};
+  uint8_t  wire[CAB_MAX_WIRE];
+  size_t   len = cabEncode(out, wire, sizeof(wire));
+  if (uart_write_bytes(CAB_UART, wire, len) == (int)len) {
+    cabFramesTx++;
   } else {
-    extra = 0;
+    sigFailures++;
+    faultFlags |= FAULT_SIGNAL_OUT;
   }
-  return BASE_GREEN_SEC + extra;
+}
+
+void printCabinetStatus() {
+  Serial.printf("BUS %s tx=%lu rx=%lu bad=%lu timeouts=%lu inputs=%08lX%08lX\n",
+                !cabBusReady ? "off" : cabOnline ? "online" : "silent",
+                (unsigned long)cabFramesTx, (unsigned long)cabRx.good,
+                (unsigned long)cabRx.bad, (unsigned long)cabTimeouts,
+                (unsigned long)(cabInputs >> 32), (unsigned long)(uint32_t)cabInputs);
+}
+
+// ============= GREEN TIME COMPUTATION =============
+
+// Green for the queue's PCE demand, from the active plan's step policy
+int computeNsGreenSeconds(Intersection& ix) {
+  return planGreenSeconds(ix.activePlan, PLAN_APPROACH_NS,
+                          vehPceCount(ix.trafficPce[PLAN_APPROACH_NS]));
+}
+
+int computeEwGreenSeconds(Intersection& ix) {
+  return planGreenSeconds(ix.activePlan, PLAN_APPROACH_EW,
+                          vehPceCount(ix.trafficPce[PLAN_APPROACH_EW]));
 }
 
 // ============= LCD HELPER =============
 
-void lcdShowTwoLines(const char* line1, const char* line2) {
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print(line1);
-  lcd.setCursor(0, 1);
-  lcd.print(line2);
+void lcdShowTwoLines(LcdPage& page, const char* line1, const char* line2) {
+  page.clear();
+  page.setCursor(0, 0);
+  page.print(line1);
+  page.setCursor(0, 1);
+  page.print(line2);
+}
+
+// Rotate the display to the next intersection's page
+void lcdNextPage() {
+  intersections[lcdPageShown].page.visible = false;
+  lcdPageShown = (lcdPageShown + 1) % INTERSECTIONS;
+  intersections[lcdPageShown].page.show();
+}
+
+// ============= INTERSECTIONS =============
+
+void intersectionsBegin() {
+  for (int k = 0; k < INTERSECTIONS; k++) {
+    Intersection& ix = intersections[k];
+    ix.index      = k;
+    ix.id         = intersectionId + k;
+    ix.upstreamId = k == 0 ? coordUpstreamId : intersections[k - 1].id;
+    if (k > 0) snprintf(ix.tag, sizeof(ix.tag), "%d", k);
+    ix.page.visible = k == lcdPageShown;
+  }
+}
+
+// ============= SERIAL COMMANDS =============
+
+// Collect newline-terminated commands without blocking
+void serialPoll() {
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      serialLine[serialLineLen] = '\0';
+      if (serialLineLen > 0) handleSerialLine(serialLine);
+      serialLineLen = 0;
+    } else if (serialLineLen < (int)sizeof(serialLine) - 1) {
+      serialLine[serialLineLen++] = c;
+    }
+  }
+}
+
+void handleSerialLine(const char* line) {
+  traceMark(TRACE_INSTANT, TRACE_ID_SERIAL);
+
+  Intersection* ix   = nullptr;
+  const char*   rest = nullptr;
+
+  // "ACK[n] <seq>" from the uplink gateway
+  if (unitCommand(line, "ACK", ix, rest) && *rest == ' ') {
+    uplinkHandleAck(*ix, (uint8_t)atoi(rest + 1));
+  } else if (strcmp(line, "CLK") == 0) {
+    printClockStatus();
+  } else if (strcmp(line, "TASKS") == 0) {
+    printTaskStatus();
+  } else if (unitCommand(line, "PLAN", ix, rest) && *rest == ' ') {
+    planUpload(*ix, rest + 1);
+  } else if (strcmp(line, "PLAN") == 0) {
+    printPlanStatus();
+  } else if (strcmp(line, "TRACE ON") == 0) {
+    traceClear();
+    traceEnabled = true;
+  } else if (strcmp(line, "TRACE OFF") == 0) {
+    traceEnabled = false;
+  } else if (strcmp(line, "TRACE") == 0 && !traceDumping) {
+    traceEnabled = false;   // freeze the snapshot while it is sent
+    traceDumping = true;
+    traceDumpPos = 0;
+  } else if (strcmp(line, "LAT") == 0) {
+    printLatency();
+  } else if (strcmp(line, "LAT EV") == 0) {
+    printLatencyEvents();
+  } else if (strcmp(line, "LAT RESET") == 0) {
+    latReset();
+  } else if (strcmp(line, "RAM") == 0) {
+    printRamStatus();
+  } else if (strcmp(line, "SIG") == 0) {
+    printSignalStatus();
+  } else if (strcmp(line, "DET") == 0) {
+    printDetectorStatus();
+  } else if (strcmp(line, "BUS") == 0) {
+    printCabinetStatus();
+  } else if (strcmp(line, "SNMP") == 0) {
+    printSnmpStatus();
+  } else if (strcmp(line, "RAIL") == 0) {
+    printRailStatus();
+  } else if (strcmp(line, "CLASS") == 0) {
+    printClassStatus();
+  } else if (strcmp(line, "RLR") == 0) {
+    printRlrStatus();
+  } else if (strncmp(line, "REIDKEY ", 8) == 0) {
+    reidKeyCommand(line + 8);
+  } else if (strcmp(line, "REID") == 0) {
+    printReidStatus();
+  } else if (strncmp(line, "WEATHER ", 8) == 0) {
+    weatherCommand(line + 8);
+  } else if (strcmp(line, "WEATHER") == 0) {
+    printWeatherStatus();
+  } else if (strcmp(line, "PROF ON") == 0 && !profDumping) {
+    profStart();
+  } else if (strcmp(line, "PROF OFF") == 0) {
+    profStop();
+  } else if (strcmp(line, "PROF") == 0 && !profDumping) {
+    profStop();   // the dump reads the buffer the ISR writes
+    profDumping = true;
+    profDumpPos = 0;
+  }
+}
+
+// "<kw>" or "<kw><n>" at the start of line: intersection n (0 if
+// no digit); rest points after it
+bool unitCommand(const char* line, const char* kw, Intersection*& ix, const char*& rest) {
+  size_t n = strlen(kw);
+  if (strncmp(line, kw, n) != 0) return false;
+  int unit = 0;
+  rest = line + n;
+  if (*rest >= '0' && *rest <= '9') unit = *rest++ - '0';
+  if (unit >= INTERSECTIONS) return false;
+  ix = &intersections[unit];
+  return true;
+}
+
+// ============= LPWAN UPLINK =============
+
+// Called once per second from housekeepingTask()
+void uplinkTick() {
+  uplinkSecCount++;
+  if (uplinkSecCount < UPLINK_PERIOD_SEC) return;
+  uplinkSecCount = 0;
+  for (Intersection& ix : intersections) uplinkSend(ix);
+}
+
+void uplinkSend(Intersection& ix) {
+  UplinkStatus st;
+  st.phase      = (uint8_t)ix.phase;
+  st.nsGreenSec = (uint8_t)computeNsGreenSeconds(ix);
+  st.ewGreenSec = (uint8_t)computeEwGreenSeconds(ix);
+  st.pedPending = ix.pedRequest ? 1 : 0;
+  st.volNS      = ix.volumeNS;
+  st.volEW      = ix.volumeEW;
+  st.pedCalls   = ix.pedCallsServed;
+  st.faults     = faultFlags | ix.faults;
+
+  // An ACK this old may refer to a seq the gateway has since reused
+  if (ix.uplink.sinceAck >= UPLINK_SEQ_MOD / 2) ix.uplink.haveAck = false;
+
+  // DELTA against the acknowledged state, FULL when there is none
+  // or periodically so a restarted gateway can resynchronise
+  bool full = !ix.uplink.haveAck || ix.uplink.sinceFull >= UPLINK_FULL_EVERY - 1;
+
+  uint8_t frame[UPLINK_MAX_FRAME];
+  size_t  len = uplinkEncode(st, full ? nullptr : &ix.uplink.acked,
+                             ix.uplink.seq, ix.uplink.ackedSeq, frame, sizeof(frame));
+  if (len == 0) return;
+
+  int slot = ix.uplink.seq % UPLINK_HISTORY;
+  ix.uplink.sent[slot]      = st;
+  ix.uplink.sentSeq[slot]   = ix.uplink.seq;
+  ix.uplink.sentValid[slot] = true;
+  ix.uplink.sinceFull = full ? 0 : ix.uplink.sinceFull + 1;
+  ix.uplink.sinceAck++;
+  ix.uplink.seq = (ix.uplink.seq + 1) % UPLINK_SEQ_MOD;
+
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  Serial.printf("UL%s ", ix.tag);
+  for (size_t i = 0; i < len; i++) {
+    Serial.print(HEX_DIGITS[frame[i] >> 4]);
+    Serial.print(HEX_DIGITS[frame[i] & 0x0F]);
+  }
+  Serial.println();
+}
+
+// Gateway confirmed it holds the state sent with 'seq'
+void uplinkHandleAck(Intersection& ix, uint8_t seq) {
+  int slot = seq % UPLINK_HISTORY;
+  if (!ix.uplink.sentValid[slot] || ix.uplink.sentSeq[slot] != seq) return;
+
+  ix.uplink.acked    = ix.uplink.sent[slot];
+  ix.uplink.ackedSeq = seq;
+  ix.uplink.haveAck  = true;
+  ix.uplink.sinceAck = 0;
+}
+
+// ============= SPaT BROADCAST =============
+
+// Called at 10 Hz from networkTask(); one datagram per intersection
+void spatBroadcast() {
+  if (WiFi.status() != WL_CONNECTED) return;
+  traceMark(TRACE_BEGIN, TRACE_ID_SPAT);
+  for (Intersection& ix : intersections) spatSend(ix);
+  traceMark(TRACE_END, TRACE_ID_SPAT);
+}
+
+void spatSend(Intersection& ix) {
+  TtcEstimate est[3];
+  predictTimeToChange(ix, est);
+
+  SpatMessage m;
+  m.msgCount       = ix.spatMsgCount;
+  m.intersectionId = (uint16_t)ix.id;
+  m.timestampDs    = (uint16_t)((clockNowUs() / 100000) % 36000);
+  m.movementCount  = 3;
+
+  spatFillMovement(m.movements[0], SG_NS_VEHICLE,
+                   ix.phase == PHASE_NS_GREEN,
+                   ix.phase == PHASE_NS_YELLOW, est[TTC_NS]);
+  spatFillMovement(m.movements[1], SG_EW_VEHICLE,
+                   ix.phase == PHASE_EW_GREEN,
+                   ix.phase == PHASE_EW_YELLOW, est[TTC_EW]);
+  spatFillMovement(m.movements[2], SG_PEDESTRIAN,
+                   ix.phase == PHASE_PED_GREEN, false, est[TTC_PED]);
+
+  uint8_t frame[SPAT_MAX_FRAME];
+  size_t  len = spatEncode(m, frame, sizeof(frame));
+  if (len > 0) {
+    spatUdp.beginPacket(IPAddress(255, 255, 255, 255), SPAT_UDP_PORT);
+    spatUdp.write(frame, len);
+    spatUdp.endPacket();
+    ix.spatMsgCount = (ix.spatMsgCount + 1) % 128;
+  }
+}
+
+void spatFillMovement(SpatMovement& mv, uint8_t signalGroup,
+                      bool green, bool yellow, const TtcEstimate& est) {
+  mv.signalGroup = signalGroup;
+  mv.state       = green  ? MPS_PROTECTED_ALLOWED :
+                   yellow ? MPS_PROTECTED_CLEARANCE : MPS_STOP_AND_REMAIN;
+  mv.minEndDs    = spatClampDs(est.minDs);
+  mv.maxEndDs    = spatClampDs(est.maxDs);
+  mv.likelyDs    = spatClampDs(est.likelyDs);
+}
+
+// ============= SNMP AGENT =============
+
+// Bound in setup(), before WiFi associates: lwIP allocates the socket
+// here rather than on the loop task once the heap guard is armed
+void snmpBegin() {
+  snmpAgent.community = snmpCommunity;
+  snmpAgent.get       = ntcipGet;
+  if (snmpPort == 0) return;
+
+  snmpSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  sockaddr_in a = {};
+  a.sin_family      = AF_INET;
+  a.sin_port        = htons((uint16_t)snmpPort);
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (snmpSock >= 0 && bind(snmpSock, (sockaddr*)&a, sizeof(a)) != 0) {
+    close(snmpSock);
+    snmpSock = -1;
+  }
+  if (snmpSock < 0) Serial.printf("SNMP port %d unavailable\n", snmpPort);
+}
+
+// Called every tick from networkTask(); each request is parsed where
+// it was received and answered to its sender
+void snmpPoll() {
+  if (snmpSock < 0) return;
+  for (int i = 0; i < SNMP_PACKETS_PER_TICK; i++) {
+    sockaddr_in from;
+    socklen_t   fromLen = sizeof(from);
+    int n = recvfrom(snmpSock, snmpRxBuf, sizeof(snmpRxBuf), MSG_DONTWAIT,
+                     (sockaddr*)&from, &fromLen);
+    if (n <= 0) return;
+    size_t len = snmpHandle(snmpAgent, snmpRxBuf, (size_t)n, snmpTxBuf, sizeof(snmpTxBuf));
+    if (len > 0) sendto(snmpSock, snmpTxBuf, len, 0, (sockaddr*)&from, fromLen);
+  }
+}
+
+// "public" -> unit 0, "public1" -> unit 1, ...; anything else is dropped
+void* snmpCommunity(const uint8_t* name, size_t len) {
+  size_t base = strlen(SNMP_COMMUNITY);
+  if (len < base || memcmp(name, SNMP_COMMUNITY, base) != 0) return nullptr;
+  for (Intersection& ix : intersections) {
+    size_t tagLen = strlen(ix.tag);
+    if (len == base + tagLen && memcmp(name + base, ix.tag, tagLen) == 0) return &ix;
+  }
+  return nullptr;
+}
+
+// Value of one NTCIP_OBJECTS row for the unit the community chose
+bool ntcipGet(void* ctx, const SnmpObject& obj, SnmpValue& v) {
+  Intersection&    ix   = *(Intersection*)ctx;
+  const PhasePlan& plan = ix.activePlan;
+  const int        p    = obj.index;             // phase or detector number
+  const bool       veh  = p != NTCIP_PHASE_PED;  // phase 1 / 2: approach p - 1
+  const int        in   = ix.index * DET_HEAD_INPUTS;
+
+  // Phase status bitmaps, phase n = bit n - 1
+  uint8_t greens  = ix.phase == PHASE_NS_GREEN  ? 1 :
+                    ix.phase == PHASE_EW_GREEN  ? 2 :
+                    ix.phase == PHASE_PED_GREEN ? 4 : 0;
+  uint8_t yellows = ix.phase == PHASE_NS_YELLOW ? 1 :
+                    ix.phase == PHASE_EW_YELLOW ? 2 : 0;
+  uint8_t walks   = ix.phase == PHASE_PED_GREEN ? 4 : 0;
+
+  v.type = BER_INTEGER;
+  v.str  = nullptr;
+  switch (obj.item) {
+    case NTCIP_SYS_DESCR:
+      v.type = BER_OCTET_STRING;
+      v.str  = "ESP32 traffic signal controller";
+      break;
+    case NTCIP_SYS_UPTIME:
+      v.type = SNMP_TIMETICKS;   // hundredths of a second
+      v.num  = (uint32_t)(coroTicks() * (100 / CORO_TICKS_PER_SEC));
+      break;
+    case NTCIP_SYS_NAME:
+      v.type = BER_OCTET_STRING;
+      snprintf(v.text, sizeof(v.text), "intersection %d", ix.id);
+      v.str = v.text;
+      break;
+    case NTCIP_MAX_PHASES:         v.num = NTCIP_PHASES; break;
+    case NTCIP_PHASE_NUMBER:       v.num = p; break;
+    case NTCIP_PHASE_WALK:         v.num = veh ? 0 : plan.pedSec; break;
+    case NTCIP_PHASE_PED_CLEAR:    v.num = veh ? 0 : (plan.pedStopDs + 9) / 10; break;
+    case NTCIP_PHASE_MIN_GREEN:
+      v.num = veh ? plan.approaches[p - 1].baseSec : plan.pedSec;
+      break;
+    case NTCIP_PHASE_MAX1:
+      v.num = veh ? planMaxGreenSeconds(plan, p - 1) : plan.pedSec;
+      break;
+    case NTCIP_PHASE_YELLOW:       v.num = veh ? plan.yellowSec * 10 : 0; break;
+    case NTCIP_PHASE_RED_CLEAR:    v.num = veh ? plan.allRedSec * 10 : 0; break;
+    case NTCIP_MAX_PHASE_GROUPS:   v.num = 1; break;
+    case NTCIP_GROUP_NUMBER:       v.num = 1; break;
+    case NTCIP_GROUP_REDS:         v.num = 7 & ~(greens | yellows); break;
+    case NTCIP_GROUP_YELLOWS:      v.num = yellows; break;
+    case NTCIP_GROUP_GREENS:       v.num = greens; break;
+    case NTCIP_GROUP_DONT_WALKS:   v.num = 4 & ~walks; break;
+    case NTCIP_GROUP_WALKS:        v.num = walks; break;
+    case NTCIP_GROUP_VEH_CALLS:
+      v.num = (ix.trafficCountNS > 0 ? 1 : 0) | (ix.trafficCountEW > 0 ? 2 : 0);
+      break;
+    case NTCIP_GROUP_PED_CALLS:    v.num = ix.pedRequest ? 4 : 0; break;
+    case NTCIP_MAX_VEH_DETECTORS:  v.num = NTCIP_VEH_DETECTORS; break;
+    case NTCIP_VEH_DET_NUMBER:     v.num = p; break;
+    case NTCIP_VEH_DET_CALL_PHASE: v.num = p; break;
+    case NTCIP_MAX_DET_GROUPS:     v.num = 1; break;
+    case NTCIP_DET_GROUP_NUMBER:   v.num = 1; break;
+    case NTCIP_DET_GROUP_ACTIVE:
+      v.num = (detIsLow(detScan, in + DET_NS) ? 1 : 0) |
+              (detIsLow(detScan, in + DET_EW) ? 2 : 0);
+      break;
+    case NTCIP_VOLUME_SEQUENCE:    v.num = ix.volumeSeq; break;
+    case NTCIP_VOLUME_PERIOD:      v.num = NTCIP_VOLUME_PERIOD_SEC; break;
+    case NTCIP_VOLUME_DETECTORS:   v.num = NTCIP_VEH_DETECTORS; break;
+    case NTCIP_DET_VOLUME:
+      v.num = ix.detVolumeLast[p - 1] < 255 ? ix.detVolumeLast[p - 1] : 255;
+      break;
+    case NTCIP_MAX_PED_DETECTORS:  v.num = NTCIP_PED_DETECTORS; break;
+    case NTCIP_PED_DET_NUMBER:     v.num = p; break;
+    case NTCIP_PED_DET_CALL_PHASE: v.num = NTCIP_PHASE_PED; break;
+    default:                       return false;
+  }
+  return true;
+}
+
+// Every NTCIP_VOLUME_PERIOD_SEC: the period's counts become the reported ones
+void ntcipVolumeTick() {
+  for (Intersection& ix : intersections) {
+    for (int d = 0; d < NTCIP_VEH_DETECTORS; d++) {
+      ix.detVolumeLast[d] = ix.detVolume[d];
+      ix.detVolume[d]     = 0;
+    }
+    ix.volumeSeq++;
+  }
+}
+
+void printSnmpStatus() {
+  Serial.printf("SNMP port=%d %s in=%lu out=%lu badcommunity=%lu errors=%lu\n", snmpPort,
+                snmpSock >= 0 ? "open" : "off", (unsigned long)snmpAgent.inPkts,
+                (unsigned long)snmpAgent.outPkts, (unsigned long)snmpAgent.badCommunity,
+                (unsigned long)snmpAgent.parseErrors);
+}
+
+// ============= TIME-TO-CHANGE =============
+
+// Time left in the current interval, in tenths of a second. The
+// countdown value covers the 1-second tick now in progress.
+long currentRemainingDs(Intersection& ix) {
+  return (long)(ix.phaseRemainingSec - 1) * 10 + (50 - pollInSecond(ix)) / 5;
+}
+
+void predictTimeToChange(Intersection& ix, TtcEstimate out[3]) {
+  if (ix.rail != RAIL_IDLE) {   // preempted: held for as long as the train
+    for (int mv = 0; mv < 3; mv++) ttcSet(out[mv], TTC_UNKNOWN, TTC_UNKNOWN, TTC_UNKNOWN);
+    return;
+  }
+  TtcInput in;
+  in.plan          = &ix.activePlan;
+  in.pc            = ix.planPc;
+  in.remainingDs   = currentRemainingDs(ix);
+  in.allRed        = ix.phase == PHASE_ALL_RED;
+  in.activeMinDs   = ix.phase == PHASE_EW_GREEN ? coordEarliestEwEndDs(ix)
+                                                 : in.remainingDs;
+  in.greenNowSec[TTC_NS] = computeNsGreenSeconds(ix);
+  in.greenNowSec[TTC_EW] = computeEwGreenSeconds(ix);
+  in.greenMinSec[TTC_NS] = in.greenNowSec[TTC_NS];
+  in.greenMinSec[TTC_EW] = ix.upstreamId != 0   // a platoon may cut it after base
+                         ? ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec
+                         : in.greenNowSec[TTC_EW];
+  in.pedLatched    = ix.pedRequest;
+  ttcPredict(in, out);
+}
+
+// ============= PEER COORDINATION =============
+
+void coordBegin() {
+  if (esp_now_init() != ESP_OK) return;
+  esp_now_register_recv_cb(coordOnReceive);
+
+  esp_now_peer_info_t peer = {};
+  memset(peer.peer_addr, 0xFF, ESP_NOW_ETH_ALEN);   // broadcast
+  peer.channel = 0;                                 // current channel
+  peer.ifidx   = WIFI_IF_STA;
+  peer.encrypt = false;
+  esp_now_add_peer(&peer);
+}
+
+// Runs in the WiFi task: only queue the frame
+void coordOnReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  (void)info;
+  if (len > 0 && len <= REID_MAX_FRAME && data[0] >> 4 == REID_MAGIC) {
+    uint8_t next = (reidRxHead + 1) % REID_RX_SLOTS;
+    if (next == reidRxTail) return;   // full: drop
+    memcpy(reidRxBuf[reidRxHead], data, len);
+    reidRxLen[reidRxHead] = (uint8_t)len;
+    reidRxUs[reidRxHead]  = esp_timer_get_time();
+    reidRxHead = next;
+    return;
+  }
+  if (len != COORD_FRAME_LEN) return;
+  uint8_t next = (coordRxHead + 1) % COORD_RX_SLOTS;
+  if (next == coordRxTail) return;   // full: drop
+  memcpy(coordRxBuf[coordRxHead], data, COORD_FRAME_LEN);
+  coordRxUs[coordRxHead] = esp_timer_get_time();
+  coordRxHead = next;
+}
+
+// Called every tick from networkTask() and mid-tick from loop()
+void coordPoll() {
+  while (coordRxTail != coordRxHead) {
+    CoordEvent e;
+    bool    ok   = coordDecode(coordRxBuf[coordRxTail], COORD_FRAME_LEN, e);
+    int64_t rxUs = coordRxUs[coordRxTail];
+    coordRxTail = (coordRxTail + 1) % COORD_RX_SLOTS;
+    if (!ok || (e.srcId >= intersectionId && e.srcId < intersectionId + INTERSECTIONS)) {
+      continue;   // our own units' frames were delivered when sent
+    }
+
+    Serial.printf("CO rx src=%u type=%u app=%u count=%u green=%u\n",
+                  e.srcId, e.type, e.approach, e.count, e.greenSec);
+    coordDeliver(e);
+
+    // The callback ran on the other core: its cycle count is not ours,
+    // so place the receipt on this core's counter from the esp_timer
+    LatStamp now = latNow();
+    LatStamp rx  = {now.cycles - (uint32_t)((now.us - rxUs) * latCpuMhz), rxUs};
+    latApplied(LAT_IN_COORD, rx, now);
+  }
+}
+
+// Platoon tracking for every local unit whose upstream sent 'e'
+void coordDeliver(const CoordEvent& e) {
+  if (e.type != COORD_EVT_GREEN_START || e.approach != COORD_APPROACH_NS) return;
+  for (Intersection& ix : intersections) {
+    if (ix.upstreamId != 0 && e.srcId == ix.upstreamId) {
+      coordPlatoonDeparted(ix.coordPlatoon, e.count, COORD_TRAVEL_SEC);
+    }
+  }
+}
+
+void coordSendEvent(Intersection& ix, uint8_t type, uint8_t approach, int count, int greenSec) {
+  CoordEvent e;
+  e.type     = type;
+  e.approach = approach;
+  e.srcId    = (uint8_t)ix.id;
+  e.seq      = coordTxSeq++;
+  e.count    = (uint8_t)(count > 255 ? 255 : count);
+  e.greenSec = (uint8_t)greenSec;
+
+  uint8_t frame[COORD_FRAME_LEN];
+  if (coordEncode(e, frame, sizeof(frame)) != COORD_FRAME_LEN) return;
+
+  static const uint8_t BROADCAST[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  esp_now_send(BROADCAST, frame, sizeof(frame));
+  if (INTERSECTIONS > 1) coordDeliver(e);   // a unit downstream on this board
+}
+
+// Lead time from ending EW green to NS green start
+int coordLeadSec(Intersection& ix) {
+  return ix.activePlan.yellowSec + (ix.pedRequest ? ix.activePlan.pedSec + 1 : 0);
+}
+
+// Checked at the top of each EW green second
+bool coordShouldEndEwGreen(Intersection& ix, int elapsedSec) {
+  if (ix.upstreamId == 0 || !ix.coordPlatoon.active) return false;
+  if (elapsedSec < ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec) return false;
+  return ix.coordPlatoon.etaSec <= coordLeadSec(ix);
+}
+
+// Earliest moment EW green can still end, in tenths of a second from
+// now (for the time-to-change bounds); the cut happens only at the
+// start of a second, after base green, once the platoon is close
+long coordEarliestEwEndDs(Intersection& ix) {
+  long remainingDs = currentRemainingDs(ix);
+  if (ix.upstreamId == 0) return remainingDs;
+
+  int elapsedNow = ix.phaseTotalSec - ix.phaseRemainingSec;
+  int eta        = ix.coordPlatoon.active ? ix.coordPlatoon.etaSec : COORD_TRAVEL_SEC;
+  int base       = ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec;
+  int k          = base - elapsedNow;   // until a cut check passes
+  if (eta - coordLeadSec(ix) > k) k = eta - coordLeadSec(ix);
+  if (k < 1) k = 1;
+
+  long cutDs = (long)(k - 1) * 10 + (50 - pollInSecond(ix)) / 5;
+  return cutDs < remainingDs ? cutDs : remainingDs;
+}
+
+// ============= RE-IDENTIFICATION =============
+
+// Controller and host stack stay on core 0 (sdkconfig default), so
+// scanning and hashing never run on the loop's core. The corridor key
+// is provisioned per deployment ("reid"/"key" in NVS), the same on
+// every controller of the corridor.
+void reidBegin() {
+  reidStore.begin("reid", false);
+  uint8_t key[REID_KEY_BYTES];
+  if (reidStore.getBytes("key", key, sizeof(key)) == sizeof(key)) {
+    reidKey   = reidKeyFromBytes(key);
+    reidKeyed = true;
+  } else {
+    Serial.println("REID no corridor key (REIDKEY <32 hex>): not scanning");
+  }
+#if REID_SCAN
+  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+  if (!btStart()) return;
+  if (esp_bluedroid_init() != ESP_OK || esp_bluedroid_enable() != ESP_OK) return;
+  esp_ble_gap_register_callback(reidOnGap);
+  reidBtUp = true;
+#endif
+}
+
+// "REIDKEY <32 hex>" at commissioning: k0 then k1, little-endian. The
+// key is not echoed; "REID" only tells whether one is set.
+void reidKeyCommand(const char* hex) {
+  uint8_t key[REID_KEY_BYTES];
+  size_t  len = 0;
+  while (hex[0] && hex[1] && len < sizeof(key)) {
+    char byteStr[3] = {hex[0], hex[1], '\0'};
+    char* end;
+    key[len++] = (uint8_t)strtoul(byteStr, &end, 16);
+    if (*end != '\0') break;
+    hex += 2;
+  }
+  if (len != sizeof(key) || *hex != '\0') {
+    Serial.println("REID ERR key must be 32 hex digits");
+    return;
+  }
+
+  reidKey       = reidKeyFromBytes(key);
+  reidKeyed     = true;
+  reidSaltReady = false;   // next reidRotateSalt() derives from the new key
+  portENTER_CRITICAL(&nvsSaveMux);
+  memcpy(reidKeySave, key, sizeof(key));
+  reidKeySavePending = true;
+  portEXIT_CRITICAL(&nvsSaveMux);
+  if (nvsSaveWake) xTaskNotifyGive(nvsSaveWake);
+  Serial.println("REID key set");
+}
+
+#if REID_SCAN
+// From reidPoll() once there is a salt. Passive, ~30 % duty: WiFi
+// shares the radio.
+void reidStartScan() {
+  static esp_ble_scan_params_t params = {};
+  params.scan_type          = BLE_SCAN_TYPE_PASSIVE;
+  params.own_addr_type      = BLE_ADDR_TYPE_PUBLIC;
+  params.scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL;
+  params.scan_interval      = 0xA0;   // 100 ms
+  params.scan_window        = 0x30;   // 30 ms
+  params.scan_duplicate     = BLE_SCAN_DUPLICATE_ENABLE;
+  esp_ble_gap_set_scan_params(&params);
+}
+
+// Runs in the BT task: hash and queue only. The address goes no
+// further than this function.
+void reidOnGap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  switch (event) {
+    case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+      esp_ble_gap_start_scanning(REID_SCAN_SEC);
+      break;
+    case ESP_GAP_BLE_SCAN_RESULT_EVT: {
+      if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_CMPL_EVT) {
+        esp_ble_gap_start_scanning(REID_SCAN_SEC);   // and the duplicate filter restarts
+        break;
+      }
+      if (param->scan_rst.search_evt != ESP_GAP_SEARCH_INQ_RES_EVT || !reidSaltReady) break;
+      reidAdverts++;
+      if (param->scan_rst.rssi < REID_MIN_RSSI) {
+        reidWeak++;
+        break;
+      }
+      uint8_t next = (reidHeardHead + 1) % REID_HEARD_SLOTS;
+      if (next == reidHeardTail) {
+        reidOverrun++;
+        break;
+      }
+      uint8_t slot = reidSaltSlot;
+      reidHeard[reidHeardHead] = ReidHeard{reidHash(reidSalts[slot], param->scan_rst.bda),
+                                           esp_timer_get_time(), slot};
+      reidHeardHead = next;
+      break;
+    }
+    default:
+      break;
+  }
+}
+#endif
+
+int32_t reidNowDs() {
+  return (int32_t)(esp_timer_get_time() / 100000);
+}
+
+// New epoch: the next salt goes into the slot the callback is not
+// using, then the callback is switched to it. Sightings under the
+// old salt can no longer match anything. Before NTP the clock counts
+// from boot, so every unit would sit in epoch 0 with one salt that
+// never rotates: no salt until then.
+void reidRotateSalt() {
+  if (!reidKeyed || !clockTimeSet) return;
+  uint32_t epoch = (uint32_t)(clockNowUs() / 1000000 / REID_EPOCH_SEC);
+  if (reidSaltReady && epoch == reidEpoch) return;
+  uint8_t slot = reidSaltSlot ^ 1;
+  reidSalts[slot] = reidSaltFor(reidKey, epoch);
+  reidSaltSlot  = slot;
+  reidSaltReady = true;
+  reidEpoch     = epoch;
+  reidTableClear(reidLocal);
+  reidTableClear(reidRemote);
+  reidTx.count = 0;
+}
+
+// Called every tick from networkTask()
+void reidPoll() {
+  reidRotateSalt();
+#if REID_SCAN
+  if (reidSaltReady && reidBtUp && !reidScanning) {
+    reidScanning = true;
+    reidStartScan();
+  }
+#endif
+  int32_t nowDs = reidNowDs();
+
+  for (int i = 0; i < REID_SIGHTINGS_PER_TICK && reidHeardTail != reidHeardHead; i++) {
+    ReidHeard h = reidHeard[reidHeardTail];
+    reidHeardTail = (reidHeardTail + 1) % REID_HEARD_SLOTS;
+    if (h.slot != reidSaltSlot) continue;   // hashed under the previous salt
+    reidSighting(h.hash, (int32_t)(h.atUs / 100000));
+  }
+
+  while (reidRxTail != reidRxHead) {
+    reidReceive(reidRxBuf[reidRxTail], reidRxLen[reidRxTail],
+                (int32_t)(reidRxUs[reidRxTail] / 100000));
+    reidRxTail = (reidRxTail + 1) % REID_RX_SLOTS;
+  }
+
+  if (reidTx.count == REID_FRAME_MAX ||
+      (reidTx.count > 0 && nowDs - reidTxLastDs >= REID_REPORT_SEC * 10)) {
+    reidSend(nowDs);
+  }
+}
+
+// A device heard here: a new visit unless it was heard recently. A
+// new visit ends a trip from the neighbour that reported it, and is
+// reported to the neighbours.
+void reidSighting(uint32_t hash, int32_t atDs) {
+  ReidSighting* seen = reidTableFind(reidLocal, hash);
+  if (seen) {
+    if (atDs - seen->atDs < REID_DEDUPE_DS) return;
+    seen->atDs = atDs;
+  } else {
+    reidTableAdd(reidLocal, hash, atDs, 0);
+  }
+  reidVisits++;
+
+  ReidSighting* there = reidTableFind(reidRemote, hash);
+  if (there) {
+    int32_t travelDs = atDs - there->atDs;
+    ReidLink* link   = reidLinkFor(reidLinks, there->peer);
+    if (link && travelDs > 0 && travelDs <= REID_MAX_TRAVEL_DS) reidLinkAdd(*link, travelDs);
+    there->hash = 0;   // one trip per sighting there
+  }
+
+  if (reidTx.count == REID_FRAME_MAX) return;   // frame goes out this tick
+  reidTx.reports[reidTx.count].hash = hash;
+  reidTxAtDs[reidTx.count] = atDs;
+  reidTx.count++;
+}
+
+// Neighbour sightings, back on our time base by their age. One we
+// have already seen here completes a trip at once (the frame came
+// after our sighting); the rest wait in the remote table.
+void reidReceive(const uint8_t* data, size_t len, int32_t rxDs) {
+  ReidFrame f;
+  if (!reidDecode(data, len, f)) return;
+  if (f.srcId >= intersectionId && f.srcId < intersectionId + INTERSECTIONS) return;
+  if (!reidSaltReady || f.epoch != (uint8_t)reidEpoch) return;   // other salt: no match
+  reidFramesRx++;
+
+  for (int i = 0; i < f.count; i++) {
+    int32_t thereDs = rxDs - f.reports[i].ageDs;
+    ReidSighting* here = reidTableFind(reidLocal, f.reports[i].hash);
+    int32_t travelDs   = here ? here->atDs - thereDs : 0;
+    if (travelDs > 0 && travelDs <= REID_MAX_TRAVEL_DS) {
+      ReidLink* link = reidLinkFor(reidLinks, f.srcId);
+      if (link) reidLinkAdd(*link, travelDs);
+      continue;
+    }
+    reidTableAdd(reidRemote, f.reports[i].hash, thereDs, f.srcId);
+  }
+}
+
+void reidSend(int32_t nowDs) {
+  reidTx.srcId = (uint8_t)intersectionId;
+  reidTx.epoch = (uint8_t)reidEpoch;
+  for (int i = 0; i < reidTx.count; i++) {
+    int32_t age = nowDs - reidTxAtDs[i];
+    reidTx.reports[i].ageDs = (uint16_t)(age < 0 ? 0 : age > 0xFFFF ? 0xFFFF : age);
+  }
+
+  uint8_t frame[REID_MAX_FRAME];
+  size_t  n = reidEncode(reidTx, frame, sizeof(frame));
+  reidTx.count = 0;
+  reidTxLastDs = nowDs;
+  if (n == 0) return;
+
+  static const uint8_t BROADCAST[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  if (esp_now_send(BROADCAST, frame, n) == ESP_OK) reidFramesTx++;
+}
+
+void printReidStatus() {
+  Serial.printf("REID scan=%d key=%d synced=%d epoch=%lu adverts=%lu weak=%lu overrun=%lu "
+                "visits=%lu tx=%lu rx=%lu\n", reidScanning ? 1 : 0, reidKeyed ? 1 : 0,
+                clockTimeSet ? 1 : 0, (unsigned long)reidEpoch,
+                (unsigned long)reidAdverts, (unsigned long)reidWeak,
+                (unsigned long)reidOverrun, (unsigned long)reidVisits,
+                (unsigned long)reidFramesTx, (unsigned long)reidFramesRx);
+  for (const ReidLink& l : reidLinks) {
+    if (l.peer == 0 || l.count == 0) continue;
+    int32_t median, fastest;
+    reidLinkStats(l, median, fastest);
+    Serial.printf("REID from=%u trips=%lu median=%ld.%lds fastest=%ld.%lds delay=%ld.%lds\n",
+                  l.peer, (unsigned long)l.trips, (long)(median / 10), (long)(median % 10),
+                  (long)(fastest / 10), (long)(fastest % 10), (long)((median - fastest) / 10),
+                  (long)((median - fastest) % 10));
+  }
+}
+
+// ============= CLOCK DISCIPLINE =============
+
+void clockBegin() {
+  clockInit(sysClock, esp_timer_get_time());
+
+  pinMode(PIN_GPS_PPS, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_GPS_PPS), onPpsEdge, RISING);
+
+  // SNTP runs in the background once WiFi is up
+  sntp_set_time_sync_notification_cb(onNtpSync);
+  configTime(0, 0, NTP_SERVER);
+}
+
+void IRAM_ATTR onPpsEdge() {
+  ppsLocalUs = esp_timer_get_time();
+  ppsPending = true;
+}
+
+void onNtpSync(struct timeval* tv) {
+  ntpLocalUs = esp_timer_get_time();
+  ntpRefUs   = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+  ntpPending = true;
+}
+
+// Called every 20 ms poll
+void clockPoll() {
+  if (ppsPending) {
+    int64_t local = ppsLocalUs;
+    ppsPending = false;
+
+    // The edge marks a whole second: label it with the nearest one
+    int64_t predicted = clockAt(sysClock, local);
+    int64_t label     = (predicted + 500000) / 1000000 * 1000000;
+    clockSample(sysClock, local, label);
+    lastPpsLocalUs = local;
+  }
+
+  if (ntpPending) {
+    int64_t local = ntpLocalUs;
+    int64_t ref   = ntpRefUs;
+    ntpPending = false;
+
+    // With a fresh PPS, NTP only fixes the seconds label when far off
+    bool ppsFresh = lastPpsLocalUs != 0 && local - lastPpsLocalUs < PPS_FRESH_US;
+    int64_t off   = ref - clockAt(sysClock, local);
+    if (!ppsFresh || off > NTP_OVERRIDE_US || off < -NTP_OVERRIDE_US) {
+      clockSample(sysClock, local, ref);
+    }
+    clockTimeSet = true;
+  }
+}
+
+int64_t clockNowUs() {
+  return clockAt(sysClock, esp_timer_get_time());
+}
+
+// Sleep until the local timer reaches deadlineUs
+void waitUntilUs(int64_t deadlineUs) {
+  int64_t waitUs = deadlineUs - esp_timer_get_time();
+  if (waitUs <= 0) return;
+  delay((uint32_t)(waitUs / 1000));
+  delayMicroseconds((uint32_t)(waitUs % 1000));
+}
+
+void printClockStatus() {
+  Serial.printf("CLK locked=%d offset=%lldus jitter=%luus drift=%.2fppm samples=%lu steps=%lu\n",
+                sysClock.locked ? 1 : 0, (long long)sysClock.lastOffsetUs,
+                (unsigned long)sysClock.jitterUs, sysClock.driftPpm,
+                (unsigned long)sysClock.samples, (unsigned long)sysClock.steps);
+}
+
+// Frame pool usage, for sizing CORO_FRAME_SLOTS / CORO_FRAME_BYTES
+void printTaskStatus() {
+  Serial.printf("TASKS frames=%d/%d peak=%d largest=%uB slot=%uB failures=%lu spawn=%lu "
+                "flash=%d\n",
+                coroFramesInUse, CORO_FRAME_SLOTS, coroFramesPeak,
+                (unsigned)coroLargestFrame, (unsigned)CORO_FRAME_BYTES,
+                (unsigned long)coroAllocFailures, (unsigned long)coroSpawnFailures,
+                failFlash ? 1 : 0);
+}
+
+// ============= TIMING PLAN =============
+
+// Per unit: stored plan ("image", "image1", ...) if it still
+// verifies, else the built-in default
+void planBegin() {
+  planStore.begin("plan", false);
+  for (Intersection& ix : intersections) {
+    uint8_t image[PLAN_MAX_BYTES];
+    char    key[12];
+    snprintf(key, sizeof(key), "image%.3s", ix.tag);
+    size_t len = planStore.getBytes(key, image, sizeof(image));
+    if (len == 0 || planLoad(image, len, ix.basePlan) != PLAN_OK) {
+      planLoad(DEFAULT_PLAN, sizeof(DEFAULT_PLAN), ix.basePlan);
+    }
+    ix.activePlan = ix.basePlan;   // dry until the first phase boundary
+  }
+  xTaskCreatePinnedToCore(nvsSaveTask, "plansave", NVS_SAVE_STACK, nullptr,
+                          tskIDLE_PRIORITY + 1, &nvsSaveWake, 0);
+}
+
+// NVS writes for planUpload() and reidKeyCommand(), off the tick: a
+// write that has to erase a page takes tens of ms
+void nvsSaveTask(void* arg) {
+  (void)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (Intersection& ix : intersections) {
+      uint8_t image[PLAN_MAX_BYTES];
+      portENTER_CRITICAL(&nvsSaveMux);
+      size_t len = planSaveLen[ix.index];
+      memcpy(image, planSaveImage[ix.index], len);
+      planSaveLen[ix.index] = 0;
+      portEXIT_CRITICAL(&nvsSaveMux);
+      if (len == 0) continue;
+
+      char key[12];
+      snprintf(key, sizeof(key), "image%.3s", ix.tag);
+      if (planStore.putBytes(key, image, len) != len) {
+        Serial.printf("PLAN%s ERR not saved\n", ix.tag);
+      }
+    }
+
+    uint8_t key[REID_KEY_BYTES];
+    portENTER_CRITICAL(&nvsSaveMux);
+    bool keyPending = reidKeySavePending;
+    memcpy(key, reidKeySave, sizeof(key));
+    reidKeySavePending = false;
+    portEXIT_CRITICAL(&nvsSaveMux);
+    if (keyPending && reidStore.putBytes("key", key, sizeof(key)) != sizeof(key)) {
+      Serial.println("REID ERR key not saved");
+    }
+  }
+}
+
+// "PLAN[n] <hex>": verify, run from the next cycle wrap, persist later
+void planUpload(Intersection& ix, const char* hex) {
+  uint8_t image[PLAN_MAX_BYTES];
+  size_t  len = 0;
+  while (hex[0] && hex[1] && len < sizeof(image)) {
+    char byteStr[3] = {hex[0], hex[1], '\0'};
+    char* end;
+    image[len++] = (uint8_t)strtoul(byteStr, &end, 16);
+    if (*end != '\0') {
+      Serial.printf("PLAN%s ERR bad hex\n", ix.tag);
+      return;
+    }
+    hex += 2;
+  }
+  if (*hex != '\0') {
+    Serial.printf("PLAN%s ERR bad hex\n", ix.tag);
+    return;
+  }
+
+  PhasePlan plan;
+  int err = planLoad(image, len, plan);
+  if (err != PLAN_OK) {
+    Serial.printf("PLAN%s ERR %s\n", ix.tag, planErrorName(err));
+    return;
+  }
+  portENTER_CRITICAL(&nvsSaveMux);
+  memcpy(planSaveImage[ix.index], image, len);
+  planSaveLen[ix.index] = len;
+  portEXIT_CRITICAL(&nvsSaveMux);
+  if (nvsSaveWake) xTaskNotifyGive(nvsSaveWake);
+  ix.pendingPlan = plan;
+  ix.planPending = true;
+  Serial.printf("PLAN%s OK\n", ix.tag);
+}
+
+// At a cycle wrap: the uploaded plan takes over, timed for the weather
+void planTakePending(Intersection& ix) {
+  ix.basePlan    = ix.pendingPlan;
+  ix.planPending = false;
+  weatherScalePlan(ix.basePlan, ix.weatherApplied, ix.activePlan);
+  Serial.printf("PLAN%s active\n", ix.tag);
+}
+
+void printPlanStatus() {
+  for (Intersection& ix : intersections) {
+    Serial.printf("PLAN%s pc=%d/%d yellow=%ds allred=%ds ped=%ds ns=%d..%ds ew=%d..%ds "
+                  "pending=%d\n",
+                  ix.tag, ix.planPc, ix.activePlan.opCount, ix.activePlan.yellowSec,
+                  ix.activePlan.allRedSec, ix.activePlan.pedSec,
+                  ix.activePlan.approaches[PLAN_APPROACH_NS].baseSec,
+                  planMaxGreenSeconds(ix.activePlan, PLAN_APPROACH_NS),
+                  ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec,
+                  planMaxGreenSeconds(ix.activePlan, PLAN_APPROACH_EW),
+                  ix.planPending ? 1 : 0);
+  }
+}
+
+// ============= WEATHER =============
+
+// Sensor contacts are external (GPIO35/36 have no pull resistors)
+void weatherBegin() {
+  pinMode(PIN_WEATHER_WET, INPUT);
+  pinMode(PIN_WEATHER_ICE, INPUT);
+}
+
+// Called once per second from housekeepingTask()
+void weatherTick() {
+  WeatherLevel read = digitalRead(PIN_WEATHER_ICE) == HIGH ? WEATHER_ICE :
+                      digitalRead(PIN_WEATHER_WET) == HIGH ? WEATHER_WET : WEATHER_DRY;
+  if (read != weatherCandidate) {
+    weatherCandidate = read;
+    weatherSettleSec = 0;
+  }
+  if (read == weatherSensed) return;
+  weatherSettleSec++;
+  if (weatherSettleSec < (read > weatherSensed ? WEATHER_WORSEN_SEC : WEATHER_EASE_SEC)) return;
+  weatherSensed = read;
+  Serial.printf("WEATHER sensor %s\n", WEATHER_PROFILES[read].name);
+}
+
+WeatherLevel weatherLevel() {
+  return weatherOverride >= 0 ? (WeatherLevel)weatherOverride : weatherSensed;
+}
+
+// Phase boundaries only: the interval being shown keeps its timing
+void weatherApply(Intersection& ix) {
+  WeatherLevel level = weatherLevel();
+  if (level == ix.weatherApplied) return;
+  ix.weatherApplied = level;
+  weatherScalePlan(ix.basePlan, level, ix.activePlan);
+  Serial.printf("WEATHER%s %s yellow=%ds allred=%ds\n", ix.tag, WEATHER_PROFILES[level].name,
+                ix.activePlan.yellowSec, ix.activePlan.allRedSec);
+}
+
+// "WEATHER <dry|wet|ice>" stands in for the sensor, "WEATHER auto"
+// hands back to it
+void weatherCommand(const char* arg) {
+  if (strcmp(arg, "auto") == 0) {
+    weatherOverride = -1;
+  } else {
+    int level = 0;
+    while (level < WEATHER_LEVELS && strcmp(arg, WEATHER_PROFILES[level].name) != 0) level++;
+    if (level == WEATHER_LEVELS) {
+      Serial.printf("WEATHER ERR %s\n", arg);
+      return;
+    }
+    weatherOverride = level;
+  }
+  printWeatherStatus();
+}
+
+void printWeatherStatus() {
+  Serial.printf("WEATHER %s sensor=%s source=%s\n", WEATHER_PROFILES[weatherLevel()].name,
+                WEATHER_PROFILES[weatherSensed].name, weatherOverride >= 0 ? "serial" : "sensor");
+  for (Intersection& ix : intersections) {
+    Serial.printf("WEATHER%s applied=%s yellow=%ds allred=%ds ns=%d..%ds ew=%d..%ds\n", ix.tag,
+                  WEATHER_PROFILES[ix.weatherApplied].name, ix.activePlan.yellowSec,
+                  ix.activePlan.allRedSec, ix.activePlan.approaches[PLAN_APPROACH_NS].baseSec,
+                  planMaxGreenSeconds(ix.activePlan, PLAN_APPROACH_NS),
+                  ix.activePlan.approaches[PLAN_APPROACH_EW].baseSec,
+                  planMaxGreenSeconds(ix.activePlan, PLAN_APPROACH_EW));
+  }
+}
+
+// ============= EVENT TRACE =============
+
+void traceMark(uint8_t kind, uint8_t id, uint16_t arg) {
+  traceRecord((uint32_t)esp_timer_get_time(), kind, id, arg);
+}
+
+void traceResume(int slot, bool begin) {
+  traceMark(begin ? TRACE_BEGIN : TRACE_END, TRACE_ID_TASK, (uint16_t)slot);
+}
+
+// One "TR <hex>" line per call; "TR END <n>" when done
+void traceDumpLine() {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  uint32_t total = traceCount();
+  if (traceDumpPos >= total) {
+    Serial.printf("TR END %lu\n", (unsigned long)total);
+    traceDumping = false;
+    return;
+  }
+
+  Serial.print("TR ");
+  for (int i = 0; i < TRACE_DUMP_PER_LINE && traceDumpPos < total; i++, traceDumpPos++) {
+    uint8_t rec[TRACE_RECORD_LEN];
+    traceEncode(traceAt(traceDumpPos), rec);
+    for (size_t b = 0; b < TRACE_RECORD_LEN; b++) {
+      Serial.print(HEX_DIGITS[rec[b] >> 4]);
+      Serial.print(HEX_DIGITS[rec[b] & 0x0F]);
+    }
+  }
+  Serial.println();
+}
+
+// ============= SAMPLING PROFILER =============
+
+void profBegin() {
+  profTimer = timerBegin(1000000);   // 1 MHz: alarm counts are microseconds
+  timerAttachInterrupt(profTimer, profSample);
+  timerAlarm(profTimer, PROF_PERIOD_US, true, 0);
+  timerStop(profTimer);
+}
+
+// At interrupt entry the FreeRTOS port saves the interrupted context
+// as an exception frame on the task stack and stores its address in
+// pxTopOfStack, the first word of the running task's TCB. Samples
+// taken while another ISR was already running show that task's PC.
+void IRAM_ATTR profSample() {
+  const uint32_t* frame = *(const uint32_t* const*)xTaskGetCurrentTaskHandle();
+  profRecord(frame[PROF_FRAME_PC_WORD]);
+}
+
+void profStart() {
+  timerStop(profTimer);
+  profClear();
+  timerStart(profTimer);
+}
+
+void profStop() {
+  timerStop(profTimer);
+}
+
+// One "PF <hex>" line per call; "PF END <n> <dropped>" when done
+void profDumpLine() {
+  uint32_t total = profCount;
+  if (profDumpPos >= total) {
+    Serial.printf("PF END %lu %lu\n", (unsigned long)total, (unsigned long)profDropped);
+    profDumping = false;
+    return;
+  }
+
+  Serial.print("PF");
+  for (int i = 0; i < PROF_DUMP_PER_LINE && profDumpPos < total; i++, profDumpPos++) {
+    Serial.printf(" %08lX", (unsigned long)profSamples[profDumpPos]);
+  }
+  Serial.println();
+}
+
+// ============= ZERO-HEAP GUARD =============
+
+// From here on the loop task is expected to run allocation-free
+void heapGuardArm() {
+  heapGuardTask  = xTaskGetCurrentTaskHandle();
+  heapGuardArmed = HEAP_GUARD > 0;
+}
+
+// IRAM_ATTR with all it calls (FreeRTOS and abort() are in IRAM): the
+// IDF hook below runs it from malloc()
+void IRAM_ATTR heapGuardCheck(uintptr_t pc, size_t bytes) {
+  if (!heapGuardArmed || xTaskGetCurrentTaskHandle() != heapGuardTask) return;
+  heapGuardRecord(pc, bytes);
+  if (HEAP_GUARD >= 2) abort();
+}
+
+#if HEAP_GUARD
+// Global new catches String, Print and library allocations made in C++
+void* operator new(size_t n) {
+  heapGuardCheck(heapCallerPc(__builtin_return_address(0)), n);
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t n) {
+  heapGuardCheck(heapCallerPc(__builtin_return_address(0)), n);
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t n) noexcept { (void)n; free(p); }
+void operator delete[](void* p, size_t n) noexcept { (void)n; free(p); }
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+// Plain malloc() (C code, IDF components) when the IDF heap hooks are built in
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  (void)ptr;
+  (void)caps;
+  heapGuardCheck(0, size);
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void* ptr) {
+  (void)ptr;
+}
+#endif
+#endif
+
+void printRamStatus() {
+  Serial.printf("RAM static data=%uB bss=%uB coro_pool=%uB frames=%d/%d peak=%d\n",
+                (unsigned)(_data_end - _data_start), (unsigned)(_bss_end - _bss_start),
+                (unsigned)sizeof(coroFramePool), coroFramesInUse, CORO_FRAME_SLOTS,
+                coroFramesPeak);
+  Serial.printf("RAM heap free=%uB min=%uB largest=%uB\n",
+                (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  for (const char* name : RAM_TASK_NAMES) {
+    TaskHandle_t t = xTaskGetHandle(name);
+    if (t) Serial.printf("RAM stack %s free=%uB\n", name, (unsigned)uxTaskGetStackHighWaterMark(t));
+  }
+  Serial.printf("RAM allocs=%lu bytes=%lu sites=%d lost=%lu guard=%d\n",
+                (unsigned long)heapAllocCount, (unsigned long)heapAllocBytes, heapSiteCount,
+                (unsigned long)heapSitesLost, HEAP_GUARD);
+  for (int i = 0; i < heapSiteCount; i++) {
+    Serial.printf("RAM site 0x%08lX n=%lu last=%luB\n", (unsigned long)heapSites[i].pc,
+                  (unsigned long)heapSites[i].count, (unsigned long)heapSites[i].lastBytes);
+  }
+}
+
+// ============= INPUT LATENCY =============
+
+void latBegin() {
+  latCpuMhz = getCpuFrequencyMhz();
+#if DETECTOR_INPUT == 0
+  attachInterrupt(digitalPinToInterrupt(PIN_BTN_NS_TRAFFIC), onNsEdge, FALLING);
+  attachInterrupt(digitalPinToInterrupt(PIN_BTN_EW_TRAFFIC), onEwEdge, FALLING);
+  attachInterrupt(digitalPinToInterrupt(PIN_BTN_PED_REQUEST), onPedEdge, FALLING);
+  // Either rail contact: the NC one opening, or the NO one closing
+  attachInterrupt(digitalPinToInterrupt(PIN_RAIL_PREEMPT), onRailEdge, RISING);
+  attachInterrupt(digitalPinToInterrupt(PIN_RAIL_CHECK), onRailEdge, FALLING);
+#endif
+}
+
+LatStamp latNow() {
+  return LatStamp{esp_cpu_get_cycle_count(), esp_timer_get_time()};
+}
+
+// Keep the first edge only: contact bounce must not move it later
+void IRAM_ATTR latEdgeIsr(int input) {
+  if (latEdgePending[input]) return;
+  latEdgeCycles[input]  = esp_cpu_get_cycle_count();
+  latEdgeUs[input]      = esp_timer_get_time();
+  latEdgePending[input] = true;
+}
+
+void IRAM_ATTR onNsEdge()   { latEdgeIsr(LAT_IN_NS); }
+void IRAM_ATTR onEwEdge()   { latEdgeIsr(LAT_IN_EW); }
+void IRAM_ATTR onPedEdge()  { latEdgeIsr(LAT_IN_PED); }
+void IRAM_ATTR onRailEdge() { latEdgeIsr(LAT_IN_RAIL); }
+
+// Edge known from a detector scan instead of a pin interrupt
+void latMarkEdge(int input, const LatStamp& at) {
+  if (latEdgePending[input]) return;
+  latEdgeCycles[input]  = at.cycles;
+  latEdgeUs[input]      = at.us;
+  latEdgePending[input] = true;
+}
+
+bool latTakeEdge(int input, LatStamp& edge) {
+  if (!latEdgePending[input]) return false;
+  edge.cycles = latEdgeCycles[input];
+  edge.us     = latEdgeUs[input];
+  latEdgePending[input] = false;
+  return true;
+}
+
+// Button read released: an edge from before that read was bounce
+// (or a press too short for the poll), not the start of a press
+void latDropStaleEdge(int input, const LatStamp& readAt) {
+  if (latEdgePending[input] && (int32_t)(latEdgeCycles[input] - readAt.cycles) < 0) {
+    latEdgePending[input] = false;
+  }
+}
+
+void printLatency() {
+  static const char* INPUT_NAMES[LAT_INPUTS] = {"ns", "ew", "ped", "rail", "coord"};
+  static const char* STAGE_NAMES[LAT_STAGES] = {"count", "lcd", "signal"};
+  for (int i = 0; i < LAT_INPUTS; i++) {
+    for (int st = 0; st < LAT_STAGES; st++) {
+      const LatHistogram& h = latHist[i][st];
+      if (h.n == 0) continue;
+      Serial.printf("LAT %s %s n=%lu min=%lu p50<=%lu p90<=%lu max=%lu mean=%lu us |",
+                    INPUT_NAMES[i], STAGE_NAMES[st], (unsigned long)h.n,
+                    (unsigned long)h.minUs, (unsigned long)latPercentileUs(h, 50),
+                    (unsigned long)latPercentileUs(h, 90), (unsigned long)h.maxUs,
+                    (unsigned long)(h.sumUs / h.n));
+      for (int b = 0; b < LAT_BUCKETS; b++) {
+        if (h.buckets[b]) Serial.printf(" %d:%lu", b, (unsigned long)h.buckets[b]);
+      }
+      Serial.println();
+    }
+  }
+  Serial.printf("LAT events=%lu open=%d/%d/%d/%d dropped=%lu\n", (unsigned long)latLogHead,
+                latOpenCount[LAT_IN_NS], latOpenCount[LAT_IN_EW], latOpenCount[LAT_IN_PED],
+                latOpenCount[LAT_IN_RAIL], (unsigned long)latOpenDropped);
+}
+
+// "LAT ev <seq> <input> <count> <lcd> <signal>" in us, oldest first;
+// "-" = stage not reached yet
+void printLatencyEvents() {
+  static const char* INPUT_NAMES[LAT_INPUTS] = {"ns", "ew", "ped", "rail", "coord"};
+  uint32_t first = latLogHead > (uint32_t)LAT_LOG_SIZE ? latLogHead - LAT_LOG_SIZE : 0;
+  for (uint32_t seq = first; seq < latLogHead; seq++) {
+    const LatEvent& e = latLog[seq % LAT_LOG_SIZE];
+    Serial.printf("LAT ev %lu %s", (unsigned long)seq, INPUT_NAMES[e.input]);
+    for (int st = 0; st < LAT_STAGES; st++) {
+      if (e.stageUs[st] == LAT_NONE) Serial.print(" -");
+      else                           Serial.printf(" %lu", (unsigned long)e.stageUs[st]);
+    }
+    Serial.println();
+  }
 }
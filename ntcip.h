@@ -0,0 +1,148 @@
+/****************************************************
+ * NTCIP 1202 OBJECT TREE (subset, read-only)
+ * - What the SNMP agent (snmp.h) serves, at the NTCIP
+ *   1202 asc node 1.3.6.1.4.1.1206.4.2.1, plus the
+ *   MIB-II system group
+ * - Phases: 1 = NS vehicle, 2 = EW vehicle,
+ *   3 = pedestrian. Vehicle detector 1 calls phase 1,
+ *   detector 2 phase 2; pedestrian detector 1 calls 3
+ * - Phase status groups are bitmaps, phase n = bit n-1
+ * - Times as in 1202: seconds, phaseYellowChange and
+ *   phaseRedClear (the weather all-red) in tenths;
+ *   detectorVolume counts every actuation in the last
+ *   volumeOccupancyPeriod
+ * - The table is sorted by OID (checked at compile
+ *   time); main.cpp supplies the values
+ ****************************************************/
+
+#ifndef NTCIP_H
+#define NTCIP_H
+
+#include "snmp.h"
+
+// ============= NUMBERING =============
+
+const int NTCIP_PHASES            = 3;
+const int NTCIP_PHASE_NS          = 1;
+const int NTCIP_PHASE_EW          = 2;
+const int NTCIP_PHASE_PED         = 3;
+const int NTCIP_VEH_DETECTORS     = 2;
+const int NTCIP_PED_DETECTORS     = 1;
+const int NTCIP_VOLUME_PERIOD_SEC = 60;   // detectorVolume period
+
+// ============= ITEMS =============
+
+enum NtcipItem : uint8_t {
+  NTCIP_SYS_DESCR,
+  NTCIP_SYS_UPTIME,
+  NTCIP_SYS_NAME,
+  NTCIP_MAX_PHASES,
+  NTCIP_PHASE_NUMBER,
+  NTCIP_PHASE_WALK,
+  NTCIP_PHASE_PED_CLEAR,
+  NTCIP_PHASE_MIN_GREEN,
+  NTCIP_PHASE_MAX1,
+  NTCIP_PHASE_YELLOW,
+  NTCIP_PHASE_RED_CLEAR,
+  NTCIP_MAX_PHASE_GROUPS,
+  NTCIP_GROUP_NUMBER,
+  NTCIP_GROUP_REDS,
+  NTCIP_GROUP_YELLOWS,
+  NTCIP_GROUP_GREENS,
+  NTCIP_GROUP_DONT_WALKS,
+  NTCIP_GROUP_WALKS,
+  NTCIP_GROUP_VEH_CALLS,
+  NTCIP_GROUP_PED_CALLS,
+  NTCIP_MAX_VEH_DETECTORS,
+  NTCIP_VEH_DET_NUMBER,
+  NTCIP_VEH_DET_CALL_PHASE,
+  NTCIP_MAX_DET_GROUPS,
+  NTCIP_DET_GROUP_NUMBER,
+  NTCIP_DET_GROUP_ACTIVE,
+  NTCIP_VOLUME_SEQUENCE,
+  NTCIP_VOLUME_PERIOD,
+  NTCIP_VOLUME_DETECTORS,
+  NTCIP_DET_VOLUME,
+  NTCIP_MAX_PED_DETECTORS,
+  NTCIP_PED_DET_NUMBER,
+  NTCIP_PED_DET_CALL_PHASE
+};
+
+// ============= OBJECTS =============
+
+#define NTCIP_SYSTEM 1, 3, 6, 1, 2, 1, 1
+#define NTCIP_ASC    1, 3, 6, 1, 4, 1, 1206, 4, 2, 1
+
+constexpr SnmpObject NTCIP_OBJECTS[] = {
+  snmpObject(NTCIP_SYS_DESCR,  0, "sysDescr.0",  NTCIP_SYSTEM, 1, 0),
+  snmpObject(NTCIP_SYS_UPTIME, 0, "sysUpTime.0", NTCIP_SYSTEM, 3, 0),
+  snmpObject(NTCIP_SYS_NAME,   0, "sysName.0",   NTCIP_SYSTEM, 5, 0),
+
+  // phase: maxPhases, phaseTable (phaseEntry columns by phase)
+  snmpObject(NTCIP_MAX_PHASES,      0, "maxPhases.0",            NTCIP_ASC, 1, 1, 0),
+  snmpObject(NTCIP_PHASE_NUMBER,    1, "phaseNumber.1",          NTCIP_ASC, 1, 2, 1, 1, 1),
+  snmpObject(NTCIP_PHASE_NUMBER,    2, "phaseNumber.2",          NTCIP_ASC, 1, 2, 1, 1, 2),
+  snmpObject(NTCIP_PHASE_NUMBER,    3, "phaseNumber.3",          NTCIP_ASC, 1, 2, 1, 1, 3),
+  snmpObject(NTCIP_PHASE_WALK,      1, "phaseWalk.1",            NTCIP_ASC, 1, 2, 1, 2, 1),
+  snmpObject(NTCIP_PHASE_WALK,      2, "phaseWalk.2",            NTCIP_ASC, 1, 2, 1, 2, 2),
+  snmpObject(NTCIP_PHASE_WALK,      3, "phaseWalk.3",            NTCIP_ASC, 1, 2, 1, 2, 3),
+  snmpObject(NTCIP_PHASE_PED_CLEAR, 1, "phasePedestrianClear.1", NTCIP_ASC, 1, 2, 1, 3, 1),
+  snmpObject(NTCIP_PHASE_PED_CLEAR, 2, "phasePedestrianClear.2", NTCIP_ASC, 1, 2, 1, 3, 2),
+  snmpObject(NTCIP_PHASE_PED_CLEAR, 3, "phasePedestrianClear.3", NTCIP_ASC, 1, 2, 1, 3, 3),
+  snmpObject(NTCIP_PHASE_MIN_GREEN, 1, "phaseMinimumGreen.1",    NTCIP_ASC, 1, 2, 1, 4, 1),
+  snmpObject(NTCIP_PHASE_MIN_GREEN, 2, "phaseMinimumGreen.2",    NTCIP_ASC, 1, 2, 1, 4, 2),
+  snmpObject(NTCIP_PHASE_MIN_GREEN, 3, "phaseMinimumGreen.3",    NTCIP_ASC, 1, 2, 1, 4, 3),
+  snmpObject(NTCIP_PHASE_MAX1,      1, "phaseMaximum1.1",        NTCIP_ASC, 1, 2, 1, 6, 1),
+  snmpObject(NTCIP_PHASE_MAX1,      2, "phaseMaximum1.2",        NTCIP_ASC, 1, 2, 1, 6, 2),
+  snmpObject(NTCIP_PHASE_MAX1,      3, "phaseMaximum1.3",        NTCIP_ASC, 1, 2, 1, 6, 3),
+  snmpObject(NTCIP_PHASE_YELLOW,    1, "phaseYellowChange.1",    NTCIP_ASC, 1, 2, 1, 8, 1),
+  snmpObject(NTCIP_PHASE_YELLOW,    2, "phaseYellowChange.2",    NTCIP_ASC, 1, 2, 1, 8, 2),
+  snmpObject(NTCIP_PHASE_YELLOW,    3, "phaseYellowChange.3",    NTCIP_ASC, 1, 2, 1, 8, 3),
+  snmpObject(NTCIP_PHASE_RED_CLEAR, 1, "phaseRedClear.1",        NTCIP_ASC, 1, 2, 1, 9, 1),
+  snmpObject(NTCIP_PHASE_RED_CLEAR, 2, "phaseRedClear.2",        NTCIP_ASC, 1, 2, 1, 9, 2),
+  snmpObject(NTCIP_PHASE_RED_CLEAR, 3, "phaseRedClear.3",        NTCIP_ASC, 1, 2, 1, 9, 3),
+
+  // maxPhaseGroups, phaseStatusGroupTable (one group: phases 1-8)
+  snmpObject(NTCIP_MAX_PHASE_GROUPS, 0, "maxPhaseGroups.0",             NTCIP_ASC, 1, 3, 0),
+  snmpObject(NTCIP_GROUP_NUMBER,     1, "phaseStatusGroupNumber.1",     NTCIP_ASC, 1, 4, 1, 1, 1),
+  snmpObject(NTCIP_GROUP_REDS,       1, "phaseStatusGroupReds.1",       NTCIP_ASC, 1, 4, 1, 2, 1),
+  snmpObject(NTCIP_GROUP_YELLOWS,    1, "phaseStatusGroupYellows.1",    NTCIP_ASC, 1, 4, 1, 3, 1),
+  snmpObject(NTCIP_GROUP_GREENS,     1, "phaseStatusGroupGreens.1",     NTCIP_ASC, 1, 4, 1, 4, 1),
+  snmpObject(NTCIP_GROUP_DONT_WALKS, 1, "phaseStatusGroupDontWalks.1",  NTCIP_ASC, 1, 4, 1, 5, 1),
+  snmpObject(NTCIP_GROUP_WALKS,      1, "phaseStatusGroupWalks.1",      NTCIP_ASC, 1, 4, 1, 7, 1),
+  snmpObject(NTCIP_GROUP_VEH_CALLS,  1, "phaseStatusGroupVehCalls.1",   NTCIP_ASC, 1, 4, 1, 8, 1),
+  snmpObject(NTCIP_GROUP_PED_CALLS,  1, "phaseStatusGroupPedCalls.1",   NTCIP_ASC, 1, 4, 1, 9, 1),
+
+  // detector: vehicle detectors, their status group, volumes
+  snmpObject(NTCIP_MAX_VEH_DETECTORS,  0, "maxVehicleDetectors.0",      NTCIP_ASC, 2, 1, 0),
+  snmpObject(NTCIP_VEH_DET_NUMBER,     1, "vehicleDetectorNumber.1",    NTCIP_ASC, 2, 2, 1, 1, 1),
+  snmpObject(NTCIP_VEH_DET_NUMBER,     2, "vehicleDetectorNumber.2",    NTCIP_ASC, 2, 2, 1, 1, 2),
+  snmpObject(NTCIP_VEH_DET_CALL_PHASE, 1, "vehicleDetectorCallPhase.1", NTCIP_ASC, 2, 2, 1, 4, 1),
+  snmpObject(NTCIP_VEH_DET_CALL_PHASE, 2, "vehicleDetectorCallPhase.2", NTCIP_ASC, 2, 2, 1, 4, 2),
+  snmpObject(NTCIP_MAX_DET_GROUPS,     0, "maxVehicleDetectorStatusGroups.0", NTCIP_ASC, 2, 3, 0),
+  snmpObject(NTCIP_DET_GROUP_NUMBER,   1, "vehicleDetectorStatusGroupNumber.1",
+             NTCIP_ASC, 2, 4, 1, 1, 1),
+  snmpObject(NTCIP_DET_GROUP_ACTIVE,   1, "vehicleDetectorStatusGroupActive.1",
+             NTCIP_ASC, 2, 4, 1, 2, 1),
+  snmpObject(NTCIP_VOLUME_SEQUENCE,    0, "volumeOccupancySequence.0",  NTCIP_ASC, 2, 5, 1, 0),
+  snmpObject(NTCIP_VOLUME_PERIOD,      0, "volumeOccupancyPeriod.0",    NTCIP_ASC, 2, 5, 2, 0),
+  snmpObject(NTCIP_VOLUME_DETECTORS,   0, "activeVolumeOccupancyDetectors.0",
+             NTCIP_ASC, 2, 5, 3, 0),
+  snmpObject(NTCIP_DET_VOLUME,         1, "detectorVolume.1",     NTCIP_ASC, 2, 5, 4, 1, 1, 1),
+  snmpObject(NTCIP_DET_VOLUME,         2, "detectorVolume.2",     NTCIP_ASC, 2, 5, 4, 1, 1, 2),
+
+  // pedestrian detectors
+  snmpObject(NTCIP_MAX_PED_DETECTORS,  0, "maxPedestrianDetectors.0",     NTCIP_ASC, 2, 6, 0),
+  snmpObject(NTCIP_PED_DET_NUMBER,     1, "pedestrianDetectorNumber.1",   NTCIP_ASC, 2, 7, 1, 1, 1),
+  snmpObject(NTCIP_PED_DET_CALL_PHASE, 1, "pedestrianDetectorCallPhase.1",
+             NTCIP_ASC, 2, 7, 1, 2, 1),
+};
+
+const int NTCIP_OBJECT_COUNT = sizeof(NTCIP_OBJECTS) / sizeof(NTCIP_OBJECTS[0]);
+
+static_assert(snmpTableSorted(NTCIP_OBJECTS, NTCIP_OBJECT_COUNT), "NTCIP_OBJECTS out of OID order");
+
+#undef NTCIP_SYSTEM
+#undef NTCIP_ASC
+
+#endif
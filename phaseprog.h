@@ -0,0 +1,318 @@
+/****************************************************
+ * PHASE PROGRAM (COMPILED TIMING PLAN)
+ * - Binary image produced on the host by
+ *   tools/plan_compiler from a .plan text file
+ * - planLoad() parses AND verifies an image; the
+ *   firmware only ever runs a plan that passed it
+ * - The interpreter in main.cpp executes one op per
+ *   interval, so its per-tick cost is nil
+ * - tools/plan_model exports a plan (and a hand-over
+ *   from the running one) as a TLA+ model for TLC
+ *
+ * Image layout (multi-byte values little-endian):
+ *   [0..1] 'T' 'P'   [2] version   [3] reserved (0)
+ *   [4..5] total length           [6..7] CRC-16 of [8..len)
+ *   [8] yellowSec  [9] pedSec  [10] pedStopDs
+ *   [11] approach count (2: NS, EW), then per approach:
+ *        baseSec, stepCount, stepCount x (minCount, extraSec)
+ *   then opCount, opCount x (opcode, arg)
+ *
+ * Ops:
+ *   GREEN a    green for approach a, length from its policy
+ *   YELLOW a   yellow for approach a
+ *   PED        pedestrian walk if a request is latched
+ *   JUMP t     continue at op t (must be the last op)
+ *
+ * Verification (anything else is rejected):
+ *   - header, length and CRC
+ *   - timings within safe ranges (yellow >= 3 s)
+ *   - policy steps strictly increasing, greens <= 63 s
+ *   - every GREEN a is immediately followed by YELLOW a,
+ *     and every YELLOW a immediately follows GREEN a
+ *   - a YELLOW a is never followed by GREEN a (the
+ *     approach must see red first), also across the JUMP
+ *     and past PED ops (those are skipped without a call)
+ *   - exactly one JUMP, as the last op, backwards
+ *   - the repeating part serves both approaches and
+ *     has a PED op (the ped button is always wired)
+ ****************************************************/
+
+#ifndef PHASEPROG_H
+#define PHASEPROG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bitpack.h"
+
+// ============= CONSTANTS =============
+
+const uint8_t PLAN_VERSION    = 1;
+const int     PLAN_MAX_BYTES  = 128;
+const int     PLAN_HEADER     = 8;
+const int     PLAN_APPROACHES = 2;
+const int     PLAN_MAX_STEPS  = 8;
+const int     PLAN_MAX_OPS    = 24;
+
+const uint8_t PLAN_APPROACH_NS = 0;
+const uint8_t PLAN_APPROACH_EW = 1;
+
+const uint8_t OP_GREEN  = 1;
+const uint8_t OP_YELLOW = 2;
+const uint8_t OP_PED    = 3;
+const uint8_t OP_JUMP   = 4;
+
+// Safe ranges
+const int PLAN_MIN_YELLOW_SEC = 3;
+const int PLAN_MAX_YELLOW_SEC = 10;
+const int PLAN_MIN_PED_SEC    = 4;
+const int PLAN_MAX_PED_SEC    = 60;
+const int PLAN_MAX_STOP_DS    = 50;
+const int PLAN_MIN_GREEN_SEC  = 5;
+const int PLAN_MAX_GREEN_SEC  = 63;   // 6-bit field in uplink / coordination
+
+// planLoad() results
+const int PLAN_OK           = 0;
+const int PLAN_ERR_HEADER   = 1;
+const int PLAN_ERR_LENGTH   = 2;
+const int PLAN_ERR_CRC      = 3;
+const int PLAN_ERR_TIMING   = 4;
+const int PLAN_ERR_POLICY   = 5;
+const int PLAN_ERR_OPCODE   = 6;
+const int PLAN_ERR_SEQUENCE = 7;
+
+// ============= PLAN =============
+
+struct PlanStep {
+  uint8_t minCount;   // applies when count >= minCount
+  uint8_t extraSec;   // added to baseSec
+};
+
+struct PlanApproach {
+  uint8_t  baseSec;
+  uint8_t  stepCount;
+  PlanStep steps[PLAN_MAX_STEPS];
+};
+
+struct PlanOp {
+  uint8_t code;
+  uint8_t arg;
+};
+
+struct PhasePlan {
+  uint8_t      yellowSec;
+  uint8_t      allRedSec;   // not in the image: set by weather scaling (weather.h)
+  uint8_t      pedSec;
+  uint8_t      pedStopDs;
+  PlanApproach approaches[PLAN_APPROACHES];
+  uint8_t      opCount;
+  PlanOp       ops[PLAN_MAX_OPS];
+};
+
+inline const char* planErrorName(int err) {
+  switch (err) {
+    case PLAN_OK:           return "ok";
+    case PLAN_ERR_HEADER:   return "bad header";
+    case PLAN_ERR_LENGTH:   return "bad length";
+    case PLAN_ERR_CRC:      return "bad CRC";
+    case PLAN_ERR_TIMING:   return "timing out of range";
+    case PLAN_ERR_POLICY:   return "bad green policy";
+    case PLAN_ERR_OPCODE:   return "bad opcode";
+    case PLAN_ERR_SEQUENCE: return "unsafe sequence";
+    default:                return "?";
+  }
+}
+
+// ============= POLICY =============
+
+inline int planGreenSeconds(const PhasePlan& p, int approach, int count) {
+  const PlanApproach& a = p.approaches[approach];
+  int extra = 0;
+  for (int i = 0; i < a.stepCount; i++) {
+    if (count >= a.steps[i].minCount) extra = a.steps[i].extraSec;
+  }
+  return a.baseSec + extra;
+}
+
+inline int planMaxGreenSeconds(const PhasePlan& p, int approach) {
+  const PlanApproach& a = p.approaches[approach];
+  return a.baseSec + (a.stepCount > 0 ? a.steps[a.stepCount - 1].extraSec : 0);
+}
+
+// Op index of the cycle start (the JUMP target)
+inline int planLoopStart(const PhasePlan& p) {
+  return p.ops[p.opCount - 1].arg;
+}
+
+// Op executed after 'pc' (follows the closing JUMP)
+inline int planNextPc(const PhasePlan& p, int pc) {
+  int next = pc + 1;
+  if (next >= p.opCount - 1) next = planLoopStart(p);
+  return next;
+}
+
+// First op of a plan taken over at a cycle wrap. Skips GREEN/YELLOW
+// pairs of 'lastYellow' (the approach whose yellow just ended, -1 if
+// none) so it is not re-greened without red clearance.
+inline int planSwitchStart(const PhasePlan& p, int lastYellow) {
+  int pc = 0;
+  for (int k = 0; k < p.opCount; k++) {
+    if (p.ops[pc].code != OP_GREEN || p.ops[pc].arg != lastYellow) break;
+    pc = planNextPc(p, planNextPc(p, pc));
+  }
+  return pc;
+}
+
+// ============= VERIFIER / LOADER =============
+
+inline int planVerifySequence(const PhasePlan& p) {
+  if (p.opCount < 2 || p.opCount > PLAN_MAX_OPS) return PLAN_ERR_SEQUENCE;
+
+  const PlanOp& last = p.ops[p.opCount - 1];
+  if (last.code != OP_JUMP || last.arg >= p.opCount - 1) return PLAN_ERR_SEQUENCE;
+
+  for (int i = 0; i < p.opCount; i++) {
+    const PlanOp& op = p.ops[i];
+    switch (op.code) {
+      case OP_GREEN:
+      case OP_YELLOW:
+        if (op.arg >= PLAN_APPROACHES) return PLAN_ERR_OPCODE;
+        break;
+      case OP_PED:
+        if (op.arg != 0) return PLAN_ERR_OPCODE;
+        break;
+      case OP_JUMP:
+        if (i != p.opCount - 1) return PLAN_ERR_SEQUENCE;
+        break;
+      default:
+        return PLAN_ERR_OPCODE;
+    }
+  }
+
+  // Greens and yellows come in adjacent pairs for the same approach
+  for (int i = 0; i < p.opCount - 1; i++) {
+    const PlanOp& op = p.ops[i];
+    if (op.code == OP_GREEN) {
+      const PlanOp& nx = p.ops[i + 1];
+      if (nx.code != OP_YELLOW || nx.arg != op.arg) return PLAN_ERR_SEQUENCE;
+    }
+    if (op.code == OP_YELLOW) {
+      if (i == 0) return PLAN_ERR_SEQUENCE;
+      const PlanOp& pv = p.ops[i - 1];
+      if (pv.code != OP_GREEN || pv.arg != op.arg) return PLAN_ERR_SEQUENCE;
+
+      // PED ops may be skipped, so look past them
+      int next = planNextPc(p, i);
+      for (int k = 0; k < p.opCount && p.ops[next].code == OP_PED; k++) {
+        next = planNextPc(p, next);
+      }
+      const PlanOp& nx = p.ops[next];
+      if (nx.code == OP_GREEN && nx.arg == op.arg) return PLAN_ERR_SEQUENCE;
+    }
+  }
+
+  // The repeating part must serve every approach (no starvation), and
+  // the ped button, which is always wired: a latched request waits for
+  // a PED op
+  bool served[PLAN_APPROACHES] = {false, false};
+  bool pedServed = false;
+  for (int i = planLoopStart(p); i < p.opCount - 1; i++) {
+    if (p.ops[i].code == OP_GREEN) served[p.ops[i].arg] = true;
+    if (p.ops[i].code == OP_PED) pedServed = true;
+  }
+  if (!served[PLAN_APPROACH_NS] || !served[PLAN_APPROACH_EW]) return PLAN_ERR_SEQUENCE;
+  if (!pedServed) return PLAN_ERR_SEQUENCE;
+  return PLAN_OK;
+}
+
+inline int planLoad(const uint8_t* img, size_t len, PhasePlan& p) {
+  if (len < PLAN_HEADER + 4) return PLAN_ERR_LENGTH;
+  if (img[0] != 'T' || img[1] != 'P' || img[2] != PLAN_VERSION || img[3] != 0) {
+    return PLAN_ERR_HEADER;
+  }
+  size_t total = img[4] | (img[5] << 8);
+  if (total != len || total > (size_t)PLAN_MAX_BYTES) return PLAN_ERR_LENGTH;
+  uint16_t crc = (uint16_t)(img[6] | (img[7] << 8));
+  if (crc16(img + PLAN_HEADER, len - PLAN_HEADER) != crc) return PLAN_ERR_CRC;
+
+  size_t pos = PLAN_HEADER;
+  p.yellowSec = img[pos++];
+  p.allRedSec = 0;
+  p.pedSec    = img[pos++];
+  p.pedStopDs = img[pos++];
+  if (p.yellowSec < PLAN_MIN_YELLOW_SEC || p.yellowSec > PLAN_MAX_YELLOW_SEC ||
+      p.pedSec < PLAN_MIN_PED_SEC || p.pedSec > PLAN_MAX_PED_SEC ||
+      p.pedStopDs > PLAN_MAX_STOP_DS) {
+    return PLAN_ERR_TIMING;
+  }
+
+  if (img[pos++] != PLAN_APPROACHES) return PLAN_ERR_POLICY;
+  for (int a = 0; a < PLAN_APPROACHES; a++) {
+    if (pos + 2 > len) return PLAN_ERR_LENGTH;
+    PlanApproach& ap = p.approaches[a];
+    ap.baseSec   = img[pos++];
+    ap.stepCount = img[pos++];
+    if (ap.baseSec < PLAN_MIN_GREEN_SEC || ap.stepCount > PLAN_MAX_STEPS) return PLAN_ERR_POLICY;
+    if (pos + 2 * ap.stepCount > len) return PLAN_ERR_LENGTH;
+    for (int i = 0; i < ap.stepCount; i++) {
+      ap.steps[i].minCount = img[pos++];
+      ap.steps[i].extraSec = img[pos++];
+      if (i > 0 && (ap.steps[i].minCount <= ap.steps[i - 1].minCount ||
+                    ap.steps[i].extraSec <= ap.steps[i - 1].extraSec)) {
+        return PLAN_ERR_POLICY;
+      }
+    }
+    if (planMaxGreenSeconds(p, a) > PLAN_MAX_GREEN_SEC) return PLAN_ERR_POLICY;
+  }
+
+  if (pos + 1 > len) return PLAN_ERR_LENGTH;
+  p.opCount = img[pos++];
+  if (p.opCount > PLAN_MAX_OPS) return PLAN_ERR_SEQUENCE;
+  if (pos + 2 * p.opCount != len) return PLAN_ERR_LENGTH;
+  for (int i = 0; i < p.opCount; i++) {
+    p.ops[i].code = img[pos++];
+    p.ops[i].arg  = img[pos++];
+  }
+
+  return planVerifySequence(p);
+}
+
+// Inverse of planLoad(), used by the host compiler. Returns bytes or 0.
+inline size_t planSerialize(const PhasePlan& p, uint8_t* out, size_t cap) {
+  size_t need = PLAN_HEADER + 4 + 2 * p.opCount;
+  for (int a = 0; a < PLAN_APPROACHES; a++) need += 2 + 2 * p.approaches[a].stepCount;
+  if (need > cap || need > (size_t)PLAN_MAX_BYTES) return 0;
+
+  size_t pos = PLAN_HEADER;
+  out[pos++] = p.yellowSec;
+  out[pos++] = p.pedSec;
+  out[pos++] = p.pedStopDs;
+  out[pos++] = PLAN_APPROACHES;
+  for (int a = 0; a < PLAN_APPROACHES; a++) {
+    const PlanApproach& ap = p.approaches[a];
+    out[pos++] = ap.baseSec;
+    out[pos++] = ap.stepCount;
+    for (int i = 0; i < ap.stepCount; i++) {
+      out[pos++] = ap.steps[i].minCount;
+      out[pos++] = ap.steps[i].extraSec;
+    }
+  }
+  out[pos++] = p.opCount;
+  for (int i = 0; i < p.opCount; i++) {
+    out[pos++] = p.ops[i].code;
+    out[pos++] = p.ops[i].arg;
+  }
+
+  uint16_t crc = crc16(out + PLAN_HEADER, pos - PLAN_HEADER);
+  out[0] = 'T';
+  out[1] = 'P';
+  out[2] = PLAN_VERSION;
+  out[3] = 0;
+  out[4] = (uint8_t)(pos & 0xFF);
+  out[5] = (uint8_t)(pos >> 8);
+  out[6] = (uint8_t)(crc & 0xFF);
+  out[7] = (uint8_t)(crc >> 8);
+  return pos;
+}
+
+#endif
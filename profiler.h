@@ -0,0 +1,45 @@
+/****************************************************
+ * SAMPLING PROFILER BUFFER
+ * - A timer interrupt stores the interrupted program
+ *   counter here at a fixed rate; the buffer fills once
+ *   and then counts the samples it had to drop
+ * - Off by default: the timer is stopped, so a disabled
+ *   profiler costs nothing at all
+ * - Dumped as "PF <hex>" lines (8 hex digits per PC);
+ *   tools/prof_symbolize maps them to functions with
+ *   addr2line against the firmware ELF
+ ****************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// ============= CONSTANTS =============
+
+const int      PROF_CAPACITY  = 2048;   // samples (8 KB), ~2 s at 1 kHz
+const uint32_t PROF_PERIOD_US = 1009;   // prime, so it never locks to the 20 ms tick
+
+// ============= BUFFER =============
+
+// Written only from the timer ISR while sampling
+inline volatile uint32_t profSamples[PROF_CAPACITY];
+inline volatile uint32_t profCount   = 0;
+inline volatile uint32_t profDropped = 0;
+
+inline void profRecord(uint32_t pc) {
+  uint32_t n = profCount;
+  if (n >= (uint32_t)PROF_CAPACITY) {
+    profDropped = profDropped + 1;
+    return;
+  }
+  profSamples[n] = pc;
+  profCount      = n + 1;
+}
+
+inline void profClear() {
+  profCount   = 0;
+  profDropped = 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+/****************************************************
+ * RAILROAD PREEMPTION TIMING
+ * - The sequence railPreempt() in main.cpp runs and
+ *   tools/plan_model exports to TLA+: entry clearance,
+ *   track clearance green, hold, exit
+ * - Values are the same under every weather profile;
+ *   the yellows and all-reds around them come from the
+ *   scaled plan
+ ****************************************************/
+
+#ifndef RAIL_H
+#define RAIL_H
+
+#include "phaseprog.h"
+
+// ============= CONSTANTS =============
+
+// The approach whose queue reaches over the tracks; the other dwells
+const int RAIL_TRACK_APPROACH  = PLAN_APPROACH_NS;
+const int RAIL_TRACK_CLEAR_SEC = 15;   // track clearance green
+const int RAIL_MIN_DWELL_SEC   = 5;    // hold at least this long
+const int RAIL_MIN_RED_SEC     = 1;    // entry red clearance with no all-red
+
+// ============= TIMING =============
+
+// Red after an entry yellow: the weather all-red, at least
+// RAIL_MIN_RED_SEC, as the yellow may be the track approach's own
+inline int railEntryRedSec(const PhasePlan& p) {
+  return p.allRedSec > 0 ? p.allRedSec : RAIL_MIN_RED_SEC;
+}
+
+#endif
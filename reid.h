@@ -0,0 +1,251 @@
+/****************************************************
+ * RE-IDENTIFICATION TRAVEL TIMES
+ * - A roadside BLE advertiser is reduced, where it is
+ *   received, to a 32-bit keyed hash (SipHash-2-4) of
+ *   its address under the current salt; addresses are
+ *   never stored or sent
+ * - The salt changes every REID_EPOCH_SEC. It is
+ *   derived from the corridor key and the epoch number,
+ *   so neighbours with synchronised clocks agree on it
+ *   without exchanging it; hashes from an old epoch are
+ *   dropped with it. The key is provisioned per
+ *   deployment, and there is no salt before the clock
+ *   has true time
+ * - Every controller broadcasts its new sightings as
+ *   (hash, age); a hash seen at a neighbour and later
+ *   here is one trip, travel time = local sighting -
+ *   neighbour's sighting. Ages, not timestamps, so the
+ *   two clocks only need to agree on the epoch
+ * - Per neighbour: the last REID_SAMPLES trips; median
+ *   travel time, and delay = median - fastest of them
+ *
+ * Frame layout (MSB first):
+ *   magic(4) count(4) srcId(8) epoch(8)
+ *   count x (hash(32) ageDs(16))   + crc8
+ ****************************************************/
+
+#ifndef REID_H
+#define REID_H
+
+#include <string.h>
+
+#include "bitpack.h"
+
+// ============= CONSTANTS =============
+
+const int REID_MAGIC        = 0xB;   // COORD_MAGIC is 0xA
+const int REID_FRAME_MAX    = 8;     // sightings per frame
+const int REID_FRAME_HEADER = 3;
+const int REID_MAX_FRAME    = REID_FRAME_HEADER + 6 * REID_FRAME_MAX + 1;
+
+const int     REID_EPOCH_SEC     = 900;
+const int     REID_TABLE_SLOTS   = 128;    // local and neighbour sightings, each
+const int32_t REID_DEDUPE_DS     = 1200;   // same device again within 2 min: same visit
+const int32_t REID_MAX_TRAVEL_DS = 6000;   // longer: stopped or detoured, no trip
+const int     REID_SAMPLES       = 16;     // trips kept per neighbour
+const int     REID_LINKS         = 4;      // neighbours tracked
+
+// ============= HASH =============
+
+struct ReidSalt {
+  uint64_t k0;
+  uint64_t k1;
+};
+
+inline uint64_t reidRotl(uint64_t x, int b) {
+  return (x << b) | (x >> (64 - b));
+}
+
+inline void reidSipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+  v0 += v1; v1 = reidRotl(v1, 13); v1 ^= v0; v0 = reidRotl(v0, 32);
+  v2 += v3; v3 = reidRotl(v3, 16); v3 ^= v2;
+  v0 += v3; v3 = reidRotl(v3, 21); v3 ^= v0;
+  v2 += v1; v1 = reidRotl(v1, 17); v1 ^= v2; v2 = reidRotl(v2, 32);
+}
+
+// SipHash-2-4 of len bytes under (k0, k1)
+inline uint64_t reidSipHash(const ReidSalt& k, const uint8_t* in, size_t len) {
+  uint64_t v0 = k.k0 ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = k.k1 ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = k.k0 ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = k.k1 ^ 0x7465646279746573ULL;
+  size_t   i  = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t m = 0;
+    for (int b = 0; b < 8; b++) m |= (uint64_t)in[i + b] << (8 * b);
+    v3 ^= m;
+    reidSipRound(v0, v1, v2, v3);
+    reidSipRound(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+  uint64_t m = (uint64_t)len << 56;
+  for (int b = 0; i + b < len; b++) m |= (uint64_t)in[i + b] << (8 * b);
+  v3 ^= m;
+  reidSipRound(v0, v1, v2, v3);
+  reidSipRound(v0, v1, v2, v3);
+  v0 ^= m;
+  v2 ^= 0xFF;
+  for (int r = 0; r < 4; r++) reidSipRound(v0, v1, v2, v3);
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Corridor key as provisioned: k0 then k1, little-endian
+const int REID_KEY_BYTES = 16;
+
+inline ReidSalt reidKeyFromBytes(const uint8_t* b) {
+  ReidSalt k = {0, 0};
+  for (int i = 0; i < 8; i++) {
+    k.k0 |= (uint64_t)b[i] << (8 * i);
+    k.k1 |= (uint64_t)b[8 + i] << (8 * i);
+  }
+  return k;
+}
+
+// Salt of one epoch, from the corridor key
+inline ReidSalt reidSaltFor(const ReidSalt& key, uint32_t epoch) {
+  uint8_t in[5] = {(uint8_t)epoch, (uint8_t)(epoch >> 8), (uint8_t)(epoch >> 16),
+                   (uint8_t)(epoch >> 24), 0};
+  ReidSalt s;
+  s.k0  = reidSipHash(key, in, sizeof(in));
+  in[4] = 1;
+  s.k1  = reidSipHash(key, in, sizeof(in));
+  return s;
+}
+
+// 0 marks a free table slot, so no device hashes to it
+inline uint32_t reidHash(const ReidSalt& salt, const uint8_t addr[6]) {
+  uint32_t h = (uint32_t)reidSipHash(salt, addr, 6);
+  return h ? h : 1;
+}
+
+// ============= FRAME =============
+
+struct ReidReport {
+  uint32_t hash;
+  uint16_t ageDs;   // seen this long before the frame was sent
+};
+
+struct ReidFrame {
+  uint8_t    count;
+  uint8_t    srcId;
+  uint8_t    epoch;   // low byte of the sender's epoch number
+  ReidReport reports[REID_FRAME_MAX];
+};
+
+inline size_t reidEncode(const ReidFrame& f, uint8_t* out, size_t cap) {
+  BitWriter w;
+  bitsBegin(w, out, cap);
+  bitsPut(w, REID_MAGIC, 4);
+  bitsPut(w, f.count, 4);
+  bitsPut(w, f.srcId, 8);
+  bitsPut(w, f.epoch, 8);
+  for (int i = 0; i < f.count; i++) {
+    bitsPut(w, f.reports[i].hash, 32);
+    bitsPut(w, f.reports[i].ageDs, 16);
+  }
+  size_t n = bitsBytes(w);
+  if (w.overflow || n + 1 > cap) return 0;
+  out[n] = crc8(out, n);
+  return n + 1;
+}
+
+inline bool reidDecode(const uint8_t* in, size_t len, ReidFrame& f) {
+  if (len < (size_t)REID_FRAME_HEADER + 1 || crc8(in, len - 1) != in[len - 1]) return false;
+
+  BitReader r;
+  bitsBeginRead(r, in, len - 1);
+  if (bitsGet(r, 4) != (uint32_t)REID_MAGIC) return false;
+  f.count = (uint8_t)bitsGet(r, 4);
+  f.srcId = (uint8_t)bitsGet(r, 8);
+  f.epoch = (uint8_t)bitsGet(r, 8);
+  if (f.count > REID_FRAME_MAX || len != (size_t)REID_FRAME_HEADER + 6 * f.count + 1) {
+    return false;
+  }
+  for (int i = 0; i < f.count; i++) {
+    f.reports[i].hash  = bitsGet(r, 32);
+    f.reports[i].ageDs = (uint16_t)bitsGet(r, 16);
+  }
+  return !r.underflow;
+}
+
+// ============= SIGHTING TABLES =============
+
+struct ReidSighting {
+  uint32_t hash;   // 0 = free / used up
+  int32_t  atDs;   // local time base
+  uint8_t  peer;   // neighbour id (neighbour table only)
+};
+
+// An advert as hashed by the scan callback, queued for matching
+struct ReidHeard {
+  uint32_t hash;
+  int64_t  atUs;   // esp_timer time it was heard
+  uint8_t  slot;   // salt slot it was hashed under
+};
+
+// Ring of the most recent sightings; the oldest is overwritten
+struct ReidTable {
+  ReidSighting slots[REID_TABLE_SLOTS];
+  int          next;
+};
+
+inline void reidTableClear(ReidTable& t) {
+  memset(&t, 0, sizeof(t));
+}
+
+inline ReidSighting* reidTableFind(ReidTable& t, uint32_t hash) {
+  for (ReidSighting& s : t.slots) {
+    if (s.hash == hash) return &s;
+  }
+  return nullptr;
+}
+
+inline void reidTableAdd(ReidTable& t, uint32_t hash, int32_t atDs, uint8_t peer) {
+  t.slots[t.next] = ReidSighting{hash, atDs, peer};
+  t.next = (t.next + 1) % REID_TABLE_SLOTS;
+}
+
+// ============= TRAVEL TIMES =============
+
+struct ReidLink {
+  uint8_t  peer;   // 0 = unused
+  uint32_t trips;
+  int      count;
+  int      next;
+  int32_t  samplesDs[REID_SAMPLES];
+};
+
+inline ReidLink* reidLinkFor(ReidLink* links, uint8_t peer) {
+  for (int i = 0; i < REID_LINKS; i++) {
+    if (links[i].peer == peer) return &links[i];
+  }
+  for (int i = 0; i < REID_LINKS; i++) {
+    if (links[i].peer == 0) {
+      links[i].peer = peer;
+      return &links[i];
+    }
+  }
+  return nullptr;   // more neighbours than tracked
+}
+
+inline void reidLinkAdd(ReidLink& l, int32_t travelDs) {
+  l.samplesDs[l.next] = travelDs;
+  l.next = (l.next + 1) % REID_SAMPLES;
+  if (l.count < REID_SAMPLES) l.count++;
+  l.trips++;
+}
+
+// Median and minimum of the kept trips (count > 0)
+inline void reidLinkStats(const ReidLink& l, int32_t& medianDs, int32_t& fastestDs) {
+  int32_t sorted[REID_SAMPLES];
+  for (int i = 0; i < l.count; i++) {
+    int32_t v = l.samplesDs[i];
+    int     j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+  medianDs  = sorted[l.count / 2];
+  fastestDs = sorted[0];
+}
+
+#endif
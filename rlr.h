@@ -0,0 +1,108 @@
+/****************************************************
+ * RED-LIGHT RUNNING
+ * - A stop-line loop just past each stop bar: a vehicle
+ *   arriving on it while its approach shows red has
+ *   entered on red (the count loop cannot tell: queued
+ *   vehicles stop on it)
+ * - Each head change is stamped (ms) when the frame that
+ *   made it is committed, the loop edge in its interrupt;
+ *   time into red is the difference of the two stamps,
+ *   not of two polls
+ * - Entries within RLR_GRACE_MS of the red onset are
+ *   counted apart, not as violations: the lamps' own
+ *   switching time, and the tolerance enforcement
+ *   practice allows
+ * - An edge within RLR_HOLDOFF_MS of the previous one on
+ *   the same loop is the same vehicle (loop chatter)
+ * - Violations go to a ring of the last RLR_LOG_SIZE
+ ****************************************************/
+
+#ifndef RLR_H
+#define RLR_H
+
+#include <stdint.h>
+
+// ============= CONSTANTS =============
+
+const uint32_t RLR_GRACE_MS   = 100;
+const uint32_t RLR_HOLDOFF_MS = 500;
+const int      RLR_LOG_SIZE   = 16;
+
+// Head and loop updates run in the stop loops' IRAM interrupt: always
+// inlined into it, never called in flash
+#define RLR_INLINE inline __attribute__((always_inline))
+
+enum RlrAspect : uint8_t {
+  RLR_GREEN,
+  RLR_YELLOW,
+  RLR_RED
+};
+
+enum RlrVerdict : uint8_t {
+  RLR_CHATTER,     // same vehicle as the last edge
+  RLR_ALLOWED,     // green or yellow
+  RLR_IN_GRACE,
+  RLR_VIOLATION
+};
+
+// ============= TYPES =============
+
+// One approach's head as committed, and its stop-line loop. The
+// head fields are written by the loop and read by the loop's
+// interrupt: the aspect is written last.
+struct RlrHead {
+  volatile uint8_t  aspect       = RLR_RED;
+  volatile uint32_t redMs        = 0;   // red onset
+  volatile uint32_t yellowMs     = 0;   // yellow onset
+  volatile uint32_t yellowLenMs  = 0;   // yellow before this red, 0 = none
+  uint32_t          lastEdgeMs   = 0;
+  bool              seenEdge     = false;
+  uint32_t          entries      = 0;   // vehicles on the stop-line loop
+  uint32_t          graceEntries = 0;
+  uint32_t          violations   = 0;
+};
+
+struct RlrEvent {
+  uint8_t  unit;
+  uint8_t  approach;      // PLAN_APPROACH_*
+  bool     camera;        // trigger pulsed
+  int64_t  atUs;          // loop edge, esp_timer
+  uint32_t intoRedMs;
+  uint32_t yellowLenMs;
+};
+
+// ============= DETECTION =============
+
+inline RlrAspect rlrAspectOf(bool green, bool yellow) {
+  return green ? RLR_GREEN : yellow ? RLR_YELLOW : RLR_RED;
+}
+
+RLR_INLINE void rlrShow(RlrHead& h, RlrAspect aspect, uint32_t ms) {
+  if (aspect == h.aspect) return;
+  if (aspect == RLR_YELLOW) h.yellowMs = ms;
+  if (aspect == RLR_RED) {
+    h.yellowLenMs = h.aspect == RLR_YELLOW ? ms - h.yellowMs : 0;
+    h.redMs       = ms;
+  }
+  h.aspect = aspect;
+}
+
+// A vehicle reached the stop-line loop at 'ms'
+RLR_INLINE RlrVerdict rlrEntry(RlrHead& h, uint32_t ms, uint32_t& intoRedMs) {
+  bool chatter = h.seenEdge && ms - h.lastEdgeMs < RLR_HOLDOFF_MS;
+  h.seenEdge   = true;
+  h.lastEdgeMs = ms;
+  if (chatter) return RLR_CHATTER;
+
+  h.entries++;
+  if (h.aspect != RLR_RED) return RLR_ALLOWED;
+  intoRedMs = ms - h.redMs;
+  if (intoRedMs < RLR_GRACE_MS) {
+    h.graceEntries++;
+    return RLR_IN_GRACE;
+  }
+  h.violations++;
+  return RLR_VIOLATION;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/****************************************************
+ * SIGNAL OUTPUT FRAME
+ * - Every lamp driver is one bit of a frame. The state
+ *   helpers edit a shadow frame and commit it once, so
+ *   all heads change together (no red-off / green-on
+ *   gap between two pin writes)
+ * - Output n is bit n: on a 74HC595 chain it is output
+ *   Q(n % 8) of register n / 8 (register 0 nearest the
+ *   MCU); on MCP23017 expanders it is GPA(n % 8) or
+ *   GPB(n % 8) of expander n / 16
+ * - The backends themselves live in main.cpp
+ *   (SIGNAL_OUTPUT); this file is only the frame layout
+ ****************************************************/
+
+#ifndef SIGOUT_H
+#define SIGOUT_H
+
+#include <stdint.h>
+
+// ============= OUTPUTS =============
+
+const int SIG_NS_RED     = 0;
+const int SIG_NS_YELLOW  = 1;
+const int SIG_NS_GREEN   = 2;
+const int SIG_EW_RED     = 3;
+const int SIG_EW_YELLOW  = 4;
+const int SIG_EW_GREEN   = 5;
+const int SIG_PED_RED    = 6;
+const int SIG_PED_GREEN  = 7;
+const int SIG_HEAD_OUTPUTS = 8;    // outputs of one intersection
+
+const int SIG_MAX_OUTPUTS  = 64;   // frame width
+const int SIG_MAX_HC595    = SIG_MAX_OUTPUTS / 8;
+
+// MCP23017 registers (IOCON.BANK = 0, sequential addressing)
+const uint8_t MCP23017_IODIRA = 0x00;   // IODIRA, IODIRB follows
+const uint8_t MCP23017_OLATA  = 0x14;   // OLATA, OLATB follows
+
+typedef uint64_t SigFrame;
+
+// ============= FRAME =============
+
+inline SigFrame sigWith(SigFrame f, int out, bool on) {
+  SigFrame bit = (SigFrame)1 << out;
+  return on ? (f | bit) : (f & ~bit);
+}
+
+inline bool sigIsOn(SigFrame f, int out) {
+  return (f >> out) & 1;
+}
+
+// Bytes for a chain of 'chips' 74HC595, in shift order: the first
+// byte clocked in ends up in the register furthest from the MCU
+inline void sigPackHc595(SigFrame f, int chips, uint8_t* out) {
+  for (int i = 0; i < chips; i++) {
+    out[i] = (uint8_t)(f >> (8 * (chips - 1 - i)));
+  }
+}
+
+// Port latch of one MCP23017 (port 0 = GPA, 1 = GPB)
+inline uint8_t sigMcpPort(SigFrame f, int chip, int port) {
+  return (uint8_t)(f >> (16 * chip + 8 * port));
+}
+
+#endif
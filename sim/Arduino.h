@@ -0,0 +1,168 @@
+/****************************************************
+ * ARDUINO API SHIM FOR THE LINUX SIMULATION BUILD
+ * - Just enough of the ESP32 Arduino core for main.cpp
+ * - Pins are plain arrays, delay() advances a virtual
+ *   clock (optionally paced to wall-clock time)
+ * - Serial is stdout / stdin
+ * See sim/sim.h for the simulator-side controls.
+ ****************************************************/
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define IRAM_ATTR
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+// ============= PINS AND TIME =============
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+// Interrupts fire on the level changes made by sim commands
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+unsigned long millis();
+unsigned long micros();
+
+inline void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                       const char* server2 = nullptr, const char* server3 = nullptr) {
+  (void)gmtOffsetSec; (void)daylightOffsetSec; (void)server1; (void)server2; (void)server3;
+}
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+// ============= HW TIMER / FREERTOS =============
+
+// Timer API of Arduino-ESP32 3.x. The simulator has no timer
+// interrupts, so alarms never fire (the profiler stays empty).
+struct hw_timer_t {
+  void (*isr)();
+  bool running;
+};
+
+inline hw_timer_t* timerBegin(uint32_t frequency) {
+  (void)frequency;
+  static hw_timer_t t = {nullptr, false};
+  return &t;
+}
+inline void timerAttachInterrupt(hw_timer_t* t, void (*isr)()) { t->isr = isr; }
+inline void timerAlarm(hw_timer_t* t, uint64_t alarm, bool autoreload, uint64_t count) {
+  (void)t; (void)alarm; (void)autoreload; (void)count;
+}
+inline void timerStart(hw_timer_t* t) { t->running = true; }
+inline void timerStop(hw_timer_t* t)  { t->running = false; }
+
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE        1
+#define pdPASS        1
+#define tskIDLE_PRIORITY 0
+
+// The current "task" is a fake TCB whose saved frame has pc = 0
+typedef void* TaskHandle_t;
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetHandle(const char* name);
+uint32_t     uxTaskGetStackHighWaterMark(TaskHandle_t t);
+
+// Single-threaded: a created task never runs (nothing it does is
+// visible here, e.g. a plan upload is not saved), and nothing
+// preempts the loop, so critical sections are empty
+inline int xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stack,
+                                   void* arg, unsigned prio, TaskHandle_t* out, int core) {
+  (void)fn; (void)name; (void)stack; (void)arg; (void)prio; (void)core;
+  static int tcb;
+  if (out) *out = &tcb;
+  return pdPASS;
+}
+inline void     xTaskNotifyGive(TaskHandle_t t) { (void)t; }
+inline uint32_t ulTaskNotifyTake(int clear, uint32_t wait) { (void)clear; (void)wait; return 0; }
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+// ESP32 linker-script section bounds -> GNU ld / crt1 symbols
+#define _data_start __data_start
+#define _data_end   _edata
+#define _bss_start  __bss_start
+#define _bss_end    _end
+
+// ============= PRINT / STREAM =============
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    for (size_t i = 0; i < len; i++) write(buf[i]);
+    return len;
+  }
+
+  size_t print(const char* s)   { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(char c)          { return write((uint8_t)c); }
+  size_t print(int v)           { return printf_("%d", v); }
+  size_t print(unsigned v)      { return printf_("%u", v); }
+  size_t print(long v)          { return printf_("%ld", v); }
+  size_t print(unsigned long v) { return printf_("%lu", v); }
+  size_t print(double v, int digits = 2) { return printf_("%.*f", digits, v); }
+
+  size_t println()              { return print("\r\n"); }
+  template <typename T>
+  size_t println(T v)           { size_t n = print(v); return n + println(); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+ private:
+  size_t printf_(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void   begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int    available() override;
+  int    read() override;
+};
+
+extern HardwareSerial Serial;
+
+// Sketch entry points
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,31 @@
+/****************************************************
+ * 16x2 I2C LCD SHIM
+ * - Keeps the visible text in a buffer the simulator
+ *   can print or trace (simLcdLine())
+ ****************************************************/
+
+#ifndef SIM_LIQUIDCRYSTAL_I2C_H
+#define SIM_LIQUIDCRYSTAL_I2C_H
+
+#include "Arduino.h"
+
+class LiquidCrystal_I2C : public Print {
+ public:
+  LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows);
+
+  void init();
+  void backlight() {}
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  const char* line(int row) const { return text_[row]; }
+
+ private:
+  uint8_t cols_, rows_, col_, row_;
+  char    text_[2][17];
+};
+
+#endif
@@ -0,0 +1,51 @@
+/****************************************************
+ * Preferences (NVS) SHIM - byte blobs kept in memory
+ * for the lifetime of the process
+ ****************************************************/
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false) {
+    ns_ = name;
+    (void)readOnly;
+    return true;
+  }
+  void end() {}
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    const uint8_t* p = (const uint8_t*)value;
+    store()[ns_ + "/" + key].assign(p, p + len);
+    return len;
+  }
+
+  size_t getBytesLength(const char* key) {
+    auto it = store().find(ns_ + "/" + key);
+    return it == store().end() ? 0 : it->second.size();
+  }
+
+  size_t getBytes(const char* key, void* buf, size_t maxLen) {
+    auto it = store().find(ns_ + "/" + key);
+    if (it == store().end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+ private:
+  static std::map<std::string, std::vector<uint8_t>>& store() {
+    static std::map<std::string, std::vector<uint8_t>> s;
+    return s;
+  }
+
+  std::string ns_;
+};
+
+#endif
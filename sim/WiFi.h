@@ -0,0 +1,34 @@
+/****************************************************
+ * WiFi SHIM - always "connected"; UDP goes to loopback
+ ****************************************************/
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+#define WIFI_STA     1
+#define WIFI_IF_STA  0
+
+class IPAddress {
+ public:
+  IPAddress() : addr_(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : addr_(((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d) {}
+  uint32_t value() const { return addr_; }
+
+ private:
+  uint32_t addr_;
+};
+
+class WiFiClass {
+ public:
+  bool mode(int m) { (void)m; return true; }
+  int  begin(const char* ssid, const char* pass = nullptr) { (void)ssid; (void)pass; return WL_CONNECTED; }
+  int  status() { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,34 @@
+/****************************************************
+ * WiFiUDP SHIM
+ * - Real UDP sockets; broadcast (255.255.255.255) and
+ *   every other destination are mapped to 127.0.0.1
+ ****************************************************/
+
+#ifndef SIM_WIFIUDP_H
+#define SIM_WIFIUDP_H
+
+#include "WiFi.h"
+
+class WiFiUDP {
+ public:
+  WiFiUDP() : fd_(-1), port_(0), txLen_(0), rxLen_(0), rxPos_(0) {}
+
+  uint8_t begin(uint16_t port);
+  int     beginPacket(IPAddress ip, uint16_t port);
+  size_t  write(const uint8_t* buf, size_t len);
+  int     endPacket();
+  int     parsePacket();
+  int     read(uint8_t* buf, size_t len);
+  int     read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+  int     available() { return (int)(rxLen_ - rxPos_); }
+
+ private:
+  int      fd_;
+  uint16_t port_;
+  uint8_t  tx_[512];
+  size_t   txLen_;
+  uint8_t  rx_[512];
+  size_t   rxLen_, rxPos_;
+};
+
+#endif
@@ -0,0 +1,27 @@
+/****************************************************
+ * Wire (I2C) SHIM - every device ACKs, reads return
+ * 0xFF (idle bus)
+ ****************************************************/
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+ public:
+  bool    begin(int sda, int scl) { (void)sda; (void)scl; return true; }
+  void    beginTransmission(uint8_t addr) { (void)addr; }
+  uint8_t endTransmission(bool stop = true) { (void)stop; return 0; }
+  size_t  write(uint8_t c) { (void)c; return 1; }
+  uint8_t requestFrom(uint8_t addr, uint8_t len) { (void)addr; rxLeft = len; return len; }
+  int     available() { return rxLeft; }
+  int     read() { return rxLeft > 0 ? (rxLeft--, 0xFF) : -1; }
+
+ private:
+  int rxLeft = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,19 @@
+/****************************************************
+ * driver/gpio SHIM - IDF pin calls on top of the
+ * simulator's Arduino pins
+ ****************************************************/
+
+#ifndef SIM_DRIVER_GPIO_H
+#define SIM_DRIVER_GPIO_H
+
+#include "../Arduino.h"
+#include "../esp_err.h"
+
+typedef int gpio_num_t;
+
+inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+  digitalWrite((uint8_t)pin, level ? HIGH : LOW);
+  return ESP_OK;
+}
+
+#endif
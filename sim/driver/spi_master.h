@@ -0,0 +1,109 @@
+/****************************************************
+ * driver/spi_master SHIM
+ * - A queued transaction completes at once: post_cb
+ *   runs inside spi_device_queue_trans(), where the
+ *   board would run it from the end-of-DMA interrupt
+ * - The data goes nowhere; reads return 0xFF (inputs
+ *   released)
+ ****************************************************/
+
+#ifndef SIM_DRIVER_SPI_MASTER_H
+#define SIM_DRIVER_SPI_MASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Arduino.h"
+#include "../esp_err.h"
+
+#define SPI2_HOST 1
+#define SPI3_HOST 2
+
+#define SPI_DMA_CH_AUTO 3
+
+typedef int spi_host_device_t;
+
+struct spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t* trans);
+
+struct spi_bus_config_t {
+  int mosi_io_num;
+  int miso_io_num;
+  int sclk_io_num;
+  int quadwp_io_num;
+  int quadhd_io_num;
+  int max_transfer_sz;
+};
+
+struct spi_device_interface_config_t {
+  uint8_t          mode;
+  int              clock_speed_hz;
+  int              spics_io_num;
+  int              queue_size;
+  transaction_cb_t pre_cb;
+  transaction_cb_t post_cb;
+};
+
+struct spi_transaction_t {
+  size_t      length;     // bits
+  size_t      rxlength;   // bits, 0 = length
+  const void* tx_buffer;
+  void*       rx_buffer;
+  void*       user;
+};
+
+struct spi_device_t {
+  spi_device_interface_config_t cfg;
+  spi_transaction_t*            done;
+};
+typedef spi_device_t* spi_device_handle_t;
+
+inline esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus,
+                                    int dmaChan) {
+  (void)host; (void)bus; (void)dmaChan;
+  return ESP_OK;
+}
+
+inline esp_err_t spi_bus_add_device(spi_host_device_t host,
+                                    const spi_device_interface_config_t* cfg,
+                                    spi_device_handle_t* handle) {
+  (void)host;
+  static spi_device_t devs[3];
+  static int          used = 0;
+  if (used == 3) return ESP_FAIL;
+  spi_device_t& dev = devs[used++];
+  dev.cfg  = *cfg;
+  dev.done = nullptr;
+  *handle  = &dev;
+  return ESP_OK;
+}
+
+inline esp_err_t spi_device_queue_trans(spi_device_handle_t h, spi_transaction_t* t,
+                                        uint32_t ticksToWait) {
+  (void)ticksToWait;
+  if (h->done) return ESP_FAIL;   // queue_size 1, result not collected
+  if (h->cfg.pre_cb) h->cfg.pre_cb(t);
+  if (t->rx_buffer) memset(t->rx_buffer, 0xFF, ((t->rxlength ? t->rxlength : t->length) + 7) / 8);
+  if (h->cfg.post_cb) h->cfg.post_cb(t);
+  h->done = t;
+  return ESP_OK;
+}
+
+inline esp_err_t spi_device_get_trans_result(spi_device_handle_t h, spi_transaction_t** t,
+                                             uint32_t ticksToWait) {
+  (void)ticksToWait;
+  if (!h->done) return ESP_FAIL;
+  *t      = h->done;
+  h->done = nullptr;
+  return ESP_OK;
+}
+
+// Queue and wait
+inline esp_err_t spi_device_transmit(spi_device_handle_t h, spi_transaction_t* t) {
+  spi_transaction_t* done;
+  esp_err_t          err = spi_device_queue_trans(h, t, portMAX_DELAY);
+  return err == ESP_OK ? spi_device_get_trans_result(h, &done, portMAX_DELAY) : err;
+}
+
+#endif
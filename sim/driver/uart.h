@@ -0,0 +1,58 @@
+/****************************************************
+ * driver/uart SHIM (Linux pty stand-in)
+ * - uart_driver_install() opens a pseudo-terminal and
+ *   prints its slave path; whatever opens that path
+ *   (tools/cabinet_sim) is the far end of the bus
+ * - --uart-link PATH (sim_main) also symlinks it
+ * - Writes go out at once, reads never block; baud
+ *   rate, pins and RS-485 mode are accepted and
+ *   ignored. Offline (scenario) runs drop writes
+ ****************************************************/
+
+#ifndef SIM_DRIVER_UART_H
+#define SIM_DRIVER_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../Arduino.h"
+#include "../esp_err.h"
+
+typedef int uart_port_t;
+
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+#define UART_NUM_MAX 3
+
+#define UART_PIN_NO_CHANGE (-1)
+
+enum uart_word_length_t { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS };
+enum uart_parity_t { UART_PARITY_DISABLE, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 };
+enum uart_stop_bits_t { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5, UART_STOP_BITS_2 };
+enum uart_hw_flowcontrol_t { UART_HW_FLOWCTRL_DISABLE };
+enum uart_sclk_t { UART_SCLK_DEFAULT };
+enum uart_mode_t { UART_MODE_UART, UART_MODE_RS485_HALF_DUPLEX };
+
+struct uart_config_t {
+  int                   baud_rate;
+  uart_word_length_t    data_bits;
+  uart_parity_t         parity;
+  uart_stop_bits_t      stop_bits;
+  uart_hw_flowcontrol_t flow_ctrl;
+  uint8_t               rx_flow_ctrl_thresh;
+  uart_sclk_t           source_clk;
+};
+
+typedef void* QueueHandle_t;
+typedef uint32_t TickType_t;
+
+esp_err_t uart_driver_install(uart_port_t port, int rxBufSize, int txBufSize, int queueSize,
+                              QueueHandle_t* queue, int intrFlags);
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* cfg);
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts);
+esp_err_t uart_set_mode(uart_port_t port, uart_mode_t mode);
+int       uart_write_bytes(uart_port_t port, const void* src, size_t size);
+int       uart_read_bytes(uart_port_t port, void* buf, uint32_t length, TickType_t ticksToWait);
+
+#endif
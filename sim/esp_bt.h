@@ -0,0 +1,27 @@
+/****************************************************
+ * BT CONTROLLER SHIM - nothing to bring up on Linux
+ * - btStart() is Arduino's (esp32-hal-bt.h on the
+ *   board); it starts the controller and keeps the core
+ *   from releasing its memory at boot
+ ****************************************************/
+
+#ifndef SIM_ESP_BT_H
+#define SIM_ESP_BT_H
+
+#include "esp_err.h"
+
+typedef enum {
+  ESP_BT_MODE_IDLE,
+  ESP_BT_MODE_BLE,
+  ESP_BT_MODE_CLASSIC_BT,
+  ESP_BT_MODE_BTDM
+} esp_bt_mode_t;
+
+inline esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode) {
+  (void)mode;
+  return ESP_OK;
+}
+
+inline bool btStart() { return true; }
+
+#endif
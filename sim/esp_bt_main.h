@@ -0,0 +1,13 @@
+/****************************************************
+ * BLUEDROID SHIM - host stack bring-up, a no-op here
+ ****************************************************/
+
+#ifndef SIM_ESP_BT_MAIN_H
+#define SIM_ESP_BT_MAIN_H
+
+#include "esp_err.h"
+
+inline esp_err_t esp_bluedroid_init() { return ESP_OK; }
+inline esp_err_t esp_bluedroid_enable() { return ESP_OK; }
+
+#endif
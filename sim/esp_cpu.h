@@ -0,0 +1,13 @@
+/****************************************************
+ * esp_cpu SHIM - a 240 MHz cycle counter derived from
+ * the simulator's virtual microseconds
+ ****************************************************/
+
+#ifndef SIM_ESP_CPU_H
+#define SIM_ESP_CPU_H
+
+#include <stdint.h>
+
+uint32_t esp_cpu_get_cycle_count();
+
+#endif
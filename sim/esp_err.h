@@ -0,0 +1,13 @@
+/****************************************************
+ * esp_err SHIM - IDF status codes
+ ****************************************************/
+
+#ifndef SIM_ESP_ERR_H
+#define SIM_ESP_ERR_H
+
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+typedef int esp_err_t;
+
+#endif
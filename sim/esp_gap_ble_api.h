@@ -0,0 +1,70 @@
+/****************************************************
+ * BLE GAP SHIM (scanning only)
+ * - Advertisements are injected with "!ble <addr>
+ *   [rssi]" on stdin and delivered to the registered
+ *   callback from inside delay(), as one scan result
+ * - Scan parameters complete at once; a scan never
+ *   times out
+ * Mirrors the subset of the ESP-IDF 5 API main.cpp uses.
+ ****************************************************/
+
+#ifndef SIM_ESP_GAP_BLE_API_H
+#define SIM_ESP_GAP_BLE_API_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+typedef enum {
+  ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT = 2,
+  ESP_GAP_BLE_SCAN_RESULT_EVT             = 3,
+  ESP_GAP_BLE_SCAN_START_COMPLETE_EVT     = 7,
+} esp_gap_ble_cb_event_t;
+
+typedef enum {
+  ESP_GAP_SEARCH_INQ_RES_EVT  = 0,
+  ESP_GAP_SEARCH_INQ_CMPL_EVT = 1,
+} esp_gap_search_evt_t;
+
+typedef enum { BLE_SCAN_TYPE_PASSIVE = 0, BLE_SCAN_TYPE_ACTIVE = 1 } esp_ble_scan_type_t;
+typedef enum { BLE_ADDR_TYPE_PUBLIC = 0, BLE_ADDR_TYPE_RANDOM = 1 } esp_ble_addr_type_t;
+typedef enum { BLE_SCAN_FILTER_ALLOW_ALL = 0 } esp_ble_scan_filter_t;
+typedef enum {
+  BLE_SCAN_DUPLICATE_DISABLE = 0,
+  BLE_SCAN_DUPLICATE_ENABLE  = 1
+} esp_ble_scan_duplicate_t;
+
+struct esp_ble_scan_params_t {
+  esp_ble_scan_type_t      scan_type;
+  esp_ble_addr_type_t      own_addr_type;
+  esp_ble_scan_filter_t    scan_filter_policy;
+  uint16_t                 scan_interval;   // 0.625 ms units
+  uint16_t                 scan_window;
+  esp_ble_scan_duplicate_t scan_duplicate;
+};
+
+typedef union {
+  struct {
+    esp_err_t status;
+  } scan_param_cmpl;
+  struct {
+    esp_err_t status;
+  } scan_start_cmpl;
+  struct {
+    esp_gap_search_evt_t search_evt;
+    esp_bd_addr_t        bda;
+    esp_ble_addr_type_t  ble_addr_type;
+    int                  rssi;
+  } scan_rst;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t cb);
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t* params);
+esp_err_t esp_ble_gap_start_scanning(uint32_t durationSec);
+
+#endif
@@ -0,0 +1,44 @@
+/****************************************************
+ * ESP-NOW SHIM (Linux UDP stand-in transport)
+ * - Node N listens on 127.0.0.1:(SIM_ESPNOW_PORT + N)
+ * - A broadcast send goes to every other node port
+ * - Receive callbacks run from inside delay(), like the
+ *   WiFi task delivering frames on the real board
+ * Mirrors the ESP-IDF 5 API used by Arduino-ESP32 3.x.
+ ****************************************************/
+
+#ifndef SIM_ESP_NOW_H
+#define SIM_ESP_NOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_NOW_ETH_ALEN  6
+
+struct esp_now_peer_info_t {
+  uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+  uint8_t channel;
+  int     ifidx;
+  bool    encrypt;
+};
+
+struct esp_now_recv_info_t {
+  uint8_t* src_addr;
+  uint8_t* des_addr;
+  void*    rx_ctrl;
+};
+
+typedef void (*esp_now_recv_cb_t)(const esp_now_recv_info_t* info,
+                                  const uint8_t* data, int len);
+
+const int SIM_ESPNOW_PORT      = 7500;
+const int SIM_ESPNOW_MAX_NODES = 16;
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len);
+
+#endif
@@ -0,0 +1,16 @@
+/****************************************************
+ * SNTP SHIM - no network time in the simulator; the
+ * clock stays on its free-running virtual timer until
+ * a "!ntp" command (sim.h) delivers a sync
+ ****************************************************/
+
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb);
+
+#endif
@@ -0,0 +1,12 @@
+/****************************************************
+ * esp_timer SHIM - the simulator's virtual microseconds
+ ****************************************************/
+
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
+
+#endif
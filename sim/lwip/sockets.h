@@ -0,0 +1,15 @@
+/****************************************************
+ * lwip/sockets SHIM
+ * - lwIP's BSD socket API is the host's own; bound
+ *   ports are real (scenario runs open none)
+ ****************************************************/
+
+#ifndef SIM_LWIP_SOCKETS_H
+#define SIM_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif
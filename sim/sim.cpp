@@ -0,0 +1,645 @@
+/****************************************************
+ * LINUX SIMULATION RUNTIME
+ * - Implements the Arduino / Wire / LCD / WiFi /
+ *   ESP-NOW / BLE / UART shims declared next to this file
+ * - Everything "asynchronous" on the board (button
+ *   edges, network receive) is serviced inside delay()
+ ****************************************************/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "LiquidCrystal_I2C.h"
+#include "WiFi.h"
+#include "WiFiUdp.h"
+#include "Wire.h"
+#include "driver/uart.h"
+#include "esp_now.h"
+#include "esp_cpu.h"
+#include "esp_gap_ble_api.h"
+#include "esp_heap_caps.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+SimConfig      simConfig = {1, true, false, false, 0, false, nullptr, nullptr};
+HardwareSerial Serial;
+TwoWire        Wire;
+WiFiClass      WiFi;
+
+// ============= STATE =============
+
+const int SIM_PINS = 40;
+
+static uint8_t  pinModes[SIM_PINS];
+static uint8_t  pinLevels[SIM_PINS];
+static uint64_t pinReleaseUs[SIM_PINS];   // end of a !press, 0 = none
+static void   (*pinIsr[SIM_PINS])();
+static int      pinIsrMode[SIM_PINS];
+
+static uint64_t virtualUs   = 0;
+static uint64_t wallStartUs = 0;
+
+static char serialRx[256];
+static int  serialRxHead = 0, serialRxTail = 0;
+static char stdinLine[128];
+static int  stdinLen = 0;
+
+static LiquidCrystal_I2C* simLcd = nullptr;
+static char lastLcd[2][17];
+
+static int               espNowFd = -1;
+static esp_now_recv_cb_t espNowCb = nullptr;
+
+static esp_gap_ble_cb_t bleGapCb = nullptr;
+static bool             bleScanning = false;
+
+static sntp_sync_time_cb_t ntpSyncCb = nullptr;
+
+static int uartMasterFd[UART_NUM_MAX] = {-1, -1, -1};
+static int uartSlaveFd[UART_NUM_MAX]  = {-1, -1, -1};   // held open: no EIO while unattached
+
+// Scenario inputs, kept in time order
+const int SIM_MAX_EVENTS = 4096;
+
+struct SimEvent {
+  uint64_t atUs;
+  int      pin;        // -1: serial line
+  uint32_t holdMs;
+  char     text[128];   // fits a scenario line, e.g. a "PLAN <hex>" upload
+};
+
+static SimEvent simEvents[SIM_MAX_EVENTS];
+static int      simEventCount = 0;
+static int      simEventNext  = 0;
+static bool     simEventsSorted = true;
+
+static char serialTx[256];   // trace mode: Serial output of the current line
+static int  serialTxLen = 0;
+
+static uint64_t wallUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// ============= PINS AND TIME =============
+
+// Level of a pulled-up input with nothing operated; the crossing
+// relay's normally-closed contact (GPIO26) holds its input low
+static uint8_t simRestLevel(int pin) {
+  return pin == 26 ? LOW : HIGH;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= SIM_PINS) return;
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) pinLevels[pin] = simRestLevel(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= SIM_PINS) return;
+  if (simConfig.trace && pinLevels[pin] != val) {
+    fprintf(simConfig.trace, "%llu P %u %u\n",
+            (unsigned long long)(virtualUs / 1000), pin, val);
+  }
+  if (simConfig.showPins && pinLevels[pin] != val) {
+    fprintf(stderr, "[%8.3f] PIN %2u=%u\n", virtualUs / 1e6, pin, val);
+  }
+  pinLevels[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SIM_PINS ? pinLevels[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin >= SIM_PINS) return;
+  pinIsr[pin]     = isr;
+  pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < SIM_PINS) pinIsr[pin] = nullptr;
+}
+
+// Drive an input from the simulator side, firing any attached ISR
+static void simSetInput(int pin, uint8_t level) {
+  uint8_t old = pinLevels[pin];
+  pinLevels[pin] = level;
+  if (pinIsr[pin] == nullptr || old == level) return;
+  int mode = pinIsrMode[pin];
+  if (mode == CHANGE || (mode == RISING && level == HIGH) ||
+      (mode == FALLING && level == LOW)) {
+    pinIsr[pin]();
+  }
+}
+
+static void simHandleCommand(const char* cmd) {
+  int pin, arg;
+  int n = sscanf(cmd, "!press %d %d", &pin, &arg);
+  if (n >= 1 && pin >= 0 && pin < SIM_PINS) {
+    simSetInput(pin, LOW);
+    pinReleaseUs[pin] = virtualUs + (uint64_t)(n == 2 ? arg : 100) * 1000;
+    return;
+  }
+  if (sscanf(cmd, "!pin %d %d", &pin, &arg) == 2 && pin >= 0 && pin < SIM_PINS) {
+    simSetInput(pin, arg ? HIGH : LOW);
+    pinReleaseUs[pin] = 0;
+    return;
+  }
+  long long sec;
+  if (sscanf(cmd, "!ntp %lld", &sec) == 1) {
+    timeval tv = {(time_t)sec, 0};
+    if (ntpSyncCb) ntpSyncCb(&tv);
+    return;
+  }
+  unsigned a[ESP_BD_ADDR_LEN];
+  int rssi = -60;
+  n = sscanf(cmd, "!ble %x:%x:%x:%x:%x:%x %d", &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &rssi);
+  if (n >= ESP_BD_ADDR_LEN) {
+    if (!bleGapCb || !bleScanning) return;   // not scanning
+    esp_ble_gap_cb_param_t p = {};
+    p.scan_rst.search_evt = ESP_GAP_SEARCH_INQ_RES_EVT;
+    for (int i = 0; i < ESP_BD_ADDR_LEN; i++) p.scan_rst.bda[i] = (uint8_t)a[i];
+    p.scan_rst.rssi = rssi;
+    bleGapCb(ESP_GAP_BLE_SCAN_RESULT_EVT, &p);
+    return;
+  }
+  fprintf(stderr, "sim: unknown command '%s'\n", cmd);
+}
+
+static void simQueueSerial(const char* line) {
+  for (int i = 0;; i++) {
+    int next = (serialRxHead + 1) % (int)sizeof(serialRx);
+    if (next == serialRxTail) break;
+    serialRx[serialRxHead] = line[i] ? line[i] : '\n';
+    serialRxHead = next;
+    if (!line[i]) break;
+  }
+}
+
+static int simEventCompare(const void* a, const void* b) {
+  const SimEvent* x = (const SimEvent*)a;
+  const SimEvent* y = (const SimEvent*)b;
+  return x->atUs < y->atUs ? -1 : x->atUs > y->atUs ? 1 : 0;
+}
+
+bool simScheduleInput(uint64_t atUs, int pin, uint32_t holdMs) {
+  if (simEventCount >= SIM_MAX_EVENTS || pin < 0 || pin >= SIM_PINS) return false;
+  SimEvent& e = simEvents[simEventCount++];
+  e.atUs    = atUs;
+  e.pin     = pin;
+  e.holdMs  = holdMs;
+  e.text[0] = '\0';
+  simEventsSorted = false;
+  return true;
+}
+
+bool simScheduleSerial(uint64_t atUs, const char* line) {
+  if (simEventCount >= SIM_MAX_EVENTS) return false;
+  SimEvent& e = simEvents[simEventCount++];
+  e.atUs   = atUs;
+  e.pin    = -1;
+  e.holdMs = 0;
+  snprintf(e.text, sizeof(e.text), "%s", line);
+  simEventsSorted = false;
+  return true;
+}
+
+static void simRunEvents() {
+  if (!simEventsSorted) {
+    qsort(simEvents + simEventNext, simEventCount - simEventNext, sizeof(SimEvent),
+          simEventCompare);
+    simEventsSorted = true;
+  }
+  while (simEventNext < simEventCount && simEvents[simEventNext].atUs <= virtualUs) {
+    const SimEvent& e = simEvents[simEventNext++];
+    if (e.pin < 0 && e.text[0] == '!') {
+      simHandleCommand(e.text);
+    } else if (e.pin < 0) {
+      simQueueSerial(e.text);
+    } else {
+      simSetInput(e.pin, LOW);
+      pinReleaseUs[e.pin] = virtualUs + (uint64_t)e.holdMs * 1000;
+    }
+  }
+}
+
+static void simPollStdin() {
+  char c;
+  while (read(STDIN_FILENO, &c, 1) == 1) {
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (stdinLen < (int)sizeof(stdinLine) - 1) stdinLine[stdinLen++] = c;
+      continue;
+    }
+    stdinLine[stdinLen] = '\0';
+    if (stdinLine[0] == '!') {
+      simHandleCommand(stdinLine);
+    } else {
+      simQueueSerial(stdinLine);
+    }
+    stdinLen = 0;
+  }
+}
+
+static void simPollEspNow() {
+  if (espNowFd < 0) return;
+  uint8_t     buf[256];
+  sockaddr_in from;
+  socklen_t   fromLen = sizeof(from);
+  ssize_t     n;
+  while ((n = recvfrom(espNowFd, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen)) > 0) {
+    int     node   = ntohs(from.sin_port) - SIM_ESPNOW_PORT;
+    uint8_t src[6] = {0x02, 0, 0, 0, 0, (uint8_t)node};
+    uint8_t dst[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    esp_now_recv_info_t info = {src, dst, nullptr};
+    if (espNowCb) espNowCb(&info, buf, (int)n);
+    fromLen = sizeof(from);
+  }
+}
+
+static void simShowLcd() {
+  if ((!simConfig.showLcd && !simConfig.trace) || simLcd == nullptr) return;
+  if (strcmp(lastLcd[0], simLcd->line(0)) == 0 &&
+      strcmp(lastLcd[1], simLcd->line(1)) == 0) return;
+  strcpy(lastLcd[0], simLcd->line(0));
+  strcpy(lastLcd[1], simLcd->line(1));
+  if (simConfig.trace) {
+    fprintf(simConfig.trace, "%llu L |%s|%s|\n",
+            (unsigned long long)(virtualUs / 1000), lastLcd[0], lastLcd[1]);
+  }
+  if (simConfig.showLcd) {
+    fprintf(stderr, "[%8.3f] LCD |%-16s|%-16s|\n", virtualUs / 1e6, lastLcd[0], lastLcd[1]);
+  }
+}
+
+// Advance virtual time in 1 ms steps, servicing inputs and the network
+void delay(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    virtualUs += 1000;
+
+    for (int p = 0; p < SIM_PINS; p++) {
+      if (pinReleaseUs[p] != 0 && virtualUs >= pinReleaseUs[p]) {
+        simSetInput(p, simRestLevel(p));
+        pinReleaseUs[p] = 0;
+      }
+    }
+    simRunEvents();
+    if (!simConfig.offline) {
+      simPollStdin();
+      simPollEspNow();
+    }
+
+    if (simConfig.realtime) {
+      uint64_t target = wallStartUs + virtualUs;
+      uint64_t now    = wallUs();
+      if (target > now) usleep((useconds_t)(target - now));
+    }
+  }
+  simShowLcd();
+
+  if (simConfig.stopAfterUs != 0 && virtualUs >= simConfig.stopAfterUs) {
+    fflush(stdout);
+    if (simConfig.trace) fflush(simConfig.trace);
+    exit(0);
+  }
+}
+
+void delayMicroseconds(uint32_t us) { virtualUs += us; }
+unsigned long millis() { return (unsigned long)(virtualUs / 1000); }
+unsigned long micros() { return (unsigned long)virtualUs; }
+uint64_t simNowUs() { return virtualUs; }
+int64_t esp_timer_get_time() { return (int64_t)virtualUs; }
+uint32_t esp_cpu_get_cycle_count() { return (uint32_t)(virtualUs * 240); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static uint32_t frame[4];
+  static void*    tcb[1] = {frame};   // pxTopOfStack -> saved frame
+  return tcb;
+}
+
+// No FreeRTOS tasks to look up: "RAM" prints no stack lines
+TaskHandle_t xTaskGetHandle(const char* name) {
+  (void)name;
+  return nullptr;
+}
+
+uint32_t uxTaskGetStackHighWaterMark(TaskHandle_t t) {
+  (void)t;
+  return 0;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  return mallinfo2().fordblks;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  return heap_caps_get_free_size(caps);
+}
+
+void simInit() {
+  wallStartUs = wallUs();
+  if (!simConfig.offline) {
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+}
+
+// ============= PRINT / SERIAL =============
+
+size_t Print::printf(const char* fmt, ...) {
+  char    buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, strlen(buf));
+}
+
+size_t Print::printf_(const char* fmt, ...) {
+  char    buf[64];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, strlen(buf));
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (c == '\r') return 1;
+  if (!simConfig.trace) {
+    putchar(c);
+    return 1;
+  }
+  if (c != '\n' && serialTxLen < (int)sizeof(serialTx) - 1) {
+    serialTx[serialTxLen++] = (char)c;
+  } else if (c == '\n') {
+    serialTx[serialTxLen] = '\0';
+    fprintf(simConfig.trace, "%llu S %s\n", (unsigned long long)(virtualUs / 1000), serialTx);
+    serialTxLen = 0;
+  }
+  return 1;
+}
+
+int HardwareSerial::available() {
+  return (serialRxHead - serialRxTail + (int)sizeof(serialRx)) % (int)sizeof(serialRx);
+}
+
+int HardwareSerial::read() {
+  if (serialRxHead == serialRxTail) return -1;
+  int c = (uint8_t)serialRx[serialRxTail];
+  serialRxTail = (serialRxTail + 1) % (int)sizeof(serialRx);
+  return c;
+}
+
+// ============= LCD =============
+
+// PCF8574 backpack at 100 kHz: each byte goes out as two nibbles of
+// three expander writes (~1.3 ms); clear also waits 2 ms
+const uint32_t SIM_LCD_BYTE_US  = 1300;
+const uint32_t SIM_LCD_CLEAR_US = 3300;
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows)
+    : cols_(cols), rows_(rows), col_(0), row_(0) {
+  (void)addr;
+  clear();
+}
+
+void LiquidCrystal_I2C::init() {
+  simLcd = this;
+  clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+  if (simLcd == this) delayMicroseconds(SIM_LCD_CLEAR_US);
+  memset(text_, 0, sizeof(text_));
+  col_ = 0;
+  row_ = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  if (simLcd == this) delayMicroseconds(SIM_LCD_BYTE_US);
+  col_ = col;
+  row_ = row < rows_ ? row : rows_ - 1;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+  if (simLcd == this) delayMicroseconds(SIM_LCD_BYTE_US);
+  if (col_ >= cols_ || col_ >= 16 || row_ >= 2) return 0;
+  for (int i = 0; i < col_; i++) {
+    if (text_[row_][i] == '\0') text_[row_][i] = ' ';
+  }
+  text_[row_][col_++] = (char)c;
+  return 1;
+}
+
+// ============= UDP =============
+
+static sockaddr_in loopbackAddr(uint16_t port) {
+  sockaddr_in a = {};
+  a.sin_family      = AF_INET;
+  a.sin_port        = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return a;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd_ < 0) return 0;
+  int on = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in a = loopbackAddr(port);
+  return bind(fd_, (sockaddr*)&a, sizeof(a)) == 0 ? 1 : 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  (void)ip;
+  if (simConfig.offline) return 0;
+  if (fd_ < 0) fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  port_  = port;
+  txLen_ = 0;
+  return fd_ >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(const uint8_t* buf, size_t len) {
+  if (txLen_ + len > sizeof(tx_)) len = sizeof(tx_) - txLen_;
+  memcpy(tx_ + txLen_, buf, len);
+  txLen_ += len;
+  return len;
+}
+
+int WiFiUDP::endPacket() {
+  if (fd_ < 0) return 0;
+  sockaddr_in a = loopbackAddr(port_);
+  return sendto(fd_, tx_, txLen_, 0, (sockaddr*)&a, sizeof(a)) >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+  if (fd_ < 0) return 0;
+  ssize_t n = recv(fd_, rx_, sizeof(rx_), 0);
+  rxLen_ = n > 0 ? (size_t)n : 0;
+  rxPos_ = 0;
+  return (int)rxLen_;
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t len) {
+  size_t n = rxLen_ - rxPos_;
+  if (n > len) n = len;
+  memcpy(buf, rx_ + rxPos_, n);
+  rxPos_ += n;
+  return (int)n;
+}
+
+// ============= ESP-NOW =============
+
+esp_err_t esp_now_init() {
+  if (simConfig.offline) return ESP_OK;   // sends are dropped
+  espNowFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (espNowFd < 0) return ESP_FAIL;
+  sockaddr_in a = loopbackAddr((uint16_t)(SIM_ESPNOW_PORT + simConfig.nodeId));
+  if (bind(espNowFd, (sockaddr*)&a, sizeof(a)) != 0) {
+    perror("esp_now_init: bind");
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  espNowCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+  (void)peer;
+  return ESP_OK;
+}
+
+// Every send is treated as a broadcast to all other nodes
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len) {
+  (void)peer_addr;
+  if (espNowFd < 0) return ESP_FAIL;
+  for (int node = 1; node <= SIM_ESPNOW_MAX_NODES; node++) {
+    if (node == simConfig.nodeId) continue;
+    sockaddr_in a = loopbackAddr((uint16_t)(SIM_ESPNOW_PORT + node));
+    sendto(espNowFd, data, len, 0, (sockaddr*)&a, sizeof(a));
+  }
+  return ESP_OK;
+}
+
+// ============= SNTP =============
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) {
+  ntpSyncCb = cb;
+}
+
+// ============= BLE SCAN =============
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t cb) {
+  bleGapCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t* params) {
+  (void)params;
+  esp_ble_gap_cb_param_t p = {};
+  if (bleGapCb) bleGapCb(ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT, &p);
+  return ESP_OK;
+}
+
+// Runs until the sim exits: no INQ_CMPL
+esp_err_t esp_ble_gap_start_scanning(uint32_t durationSec) {
+  (void)durationSec;
+  bleScanning = true;
+  esp_ble_gap_cb_param_t p = {};
+  if (bleGapCb) bleGapCb(ESP_GAP_BLE_SCAN_START_COMPLETE_EVT, &p);
+  return ESP_OK;
+}
+
+// ============= UART (pty) =============
+
+esp_err_t uart_driver_install(uart_port_t port, int rxBufSize, int txBufSize, int queueSize,
+                              QueueHandle_t* queue, int intrFlags) {
+  (void)rxBufSize; (void)txBufSize; (void)queueSize; (void)queue; (void)intrFlags;
+  if (port < 0 || port >= UART_NUM_MAX || uartMasterFd[port] >= 0) return ESP_FAIL;
+  if (simConfig.offline) return ESP_OK;   // writes are dropped
+
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+    perror("uart_driver_install: pty");
+    if (fd >= 0) close(fd);
+    return ESP_FAIL;
+  }
+  const char* path  = ptsname(fd);
+  int         slave = open(path, O_RDWR | O_NOCTTY);
+  termios     tio;
+  if (slave < 0 || tcgetattr(slave, &tio) != 0) {
+    perror("uart_driver_install: slave");
+    close(fd);
+    return ESP_FAIL;
+  }
+  cfmakeraw(&tio);   // bytes through untouched, both ways
+  tcsetattr(slave, TCSANOW, &tio);
+
+  uartMasterFd[port] = fd;
+  uartSlaveFd[port]  = slave;
+  fprintf(stderr, "sim: UART%d on %s\n", port, path);
+  if (simConfig.uartLink) {
+    unlink(simConfig.uartLink);
+    if (symlink(path, simConfig.uartLink) != 0) perror("uart_driver_install: --uart-link");
+  }
+  return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* cfg) {
+  (void)port; (void)cfg;
+  return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) {
+  (void)port; (void)tx; (void)rx; (void)rts; (void)cts;
+  return ESP_OK;
+}
+
+esp_err_t uart_set_mode(uart_port_t port, uart_mode_t mode) {
+  (void)port; (void)mode;
+  return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const void* src, size_t size) {
+  if (port < 0 || port >= UART_NUM_MAX) return -1;
+  int fd = uartMasterFd[port];
+  if (fd < 0) return simConfig.offline ? (int)size : -1;
+  ssize_t n = write(fd, src, size);
+  if (n < 0) {
+    // Nobody reading the far end: drop the backlog, like a bus with
+    // no cabinet on it, and send again
+    tcflush(uartSlaveFd[port], TCIFLUSH);
+    n = write(fd, src, size);
+  }
+  return n < 0 ? -1 : (int)n;
+}
+
+int uart_read_bytes(uart_port_t port, void* buf, uint32_t length, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  if (port < 0 || port >= UART_NUM_MAX || uartMasterFd[port] < 0) return 0;
+  ssize_t n = read(uartMasterFd[port], buf, length);
+  return n < 0 ? 0 : (int)n;
+}
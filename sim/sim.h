@@ -0,0 +1,50 @@
+/****************************************************
+ * SIMULATOR CONTROLS
+ * - Settings filled in by sim_main.cpp from argv
+ * - Stdin lines starting with '!' are simulator
+ *   commands, everything else is fed to Serial:
+ *     !press <pin> [ms]   hold an input low (default 100 ms)
+ *     !pin <pin> <0|1>    force an input level
+ *   Inputs rest high, except GPIO26 (the rail relay's
+ *   NC contact), which rests low: a train is "!pin 26 1"
+ *   with "!pin 17 0"
+ *     !ble <addr> [rssi]  one BLE advertisement heard
+ *                         (addr aa:bb:cc:dd:ee:ff), once
+ *                         the firmware has started a scan
+ *     !ntp <sec>          NTP sync: true time is <sec>.0
+ * - Scenario runs (trace_main.cpp) go offline (no
+ *   stdin / sockets), schedule their inputs up front
+ *   and record a timestamped trace of every output:
+ *     <ms> P <pin> <level>        output pin change
+ *     <ms> L |<line0>|<line1>|    LCD text change
+ *     <ms> S <text>               Serial line
+ ****************************************************/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct SimConfig {
+  int         nodeId;        // ESP-NOW node / port offset
+  bool        realtime;      // pace virtual time to the wall clock
+  bool        showLcd;       // print LCD text when it changes
+  bool        showPins;      // print output pin changes
+  uint64_t    stopAfterUs;   // 0 = run forever
+  bool        offline;       // no stdin commands, no sockets / ptys
+  FILE*       trace;         // output trace sink, or nullptr
+  const char* uartLink;      // symlink to the UART pty, or nullptr
+};
+
+extern SimConfig simConfig;
+
+void     simInit();
+uint64_t simNowUs();
+
+// Scenario inputs, applied when virtual time reaches atUs; a
+// line starting with '!' is a simulator command, not Serial
+bool simScheduleInput(uint64_t atUs, int pin, uint32_t holdMs);
+bool simScheduleSerial(uint64_t atUs, const char* line);
+
+#endif
@@ -0,0 +1,77 @@
+/****************************************************
+ * LINUX SIMULATION BUILD OF main.cpp
+ * - Runs the unmodified controller against the shims
+ *   in this directory
+ * - Several instances with different --id values can
+ *   run side by side; their ESP-NOW traffic goes over
+ *   loopback UDP (see esp_now.h)
+ *
+ * Build:
+ *   g++ -std=gnu++20 -O2 -Isim -o controller_sim \
+ *       main.cpp sim/sim.cpp sim/sim_main.cpp
+ *
+ * Usage:
+ *   controller_sim [--id N] [--upstream N] [--seconds S]
+ *                  [--fast] [--lcd] [--pins] [--uart-link PATH]
+ *                  [--snmp-port N]
+ *   --fast       run in virtual time (no wall-clock pacing)
+ *   --uart-link  symlink PATH to the cabinet bus pty
+ *                (SIGNAL_OUTPUT / DETECTOR_INPUT 3)
+ *   --snmp-port  SNMP agent port (default 16160 + id, as
+ *                161 needs root; 0 = no agent)
+ * Inputs: type "!press 12" etc. on stdin (see sim.h).
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "sim.h"
+
+// Per-unit settings from main.cpp
+extern int intersectionId;
+extern int coordUpstreamId;
+extern int snmpPort;
+
+static const int SIM_SNMP_PORT_BASE = 16160;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [--id N] [--upstream N] [--seconds S] [--fast] [--lcd] [--pins]\n"
+          "          [--uart-link PATH] [--snmp-port N]\n",
+          prog);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  int port = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--id") == 0 && i + 1 < argc) {
+      intersectionId   = atoi(argv[++i]);
+      simConfig.nodeId = intersectionId;
+    } else if (strcmp(argv[i], "--upstream") == 0 && i + 1 < argc) {
+      coordUpstreamId = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      simConfig.stopAfterUs = (uint64_t)atol(argv[++i]) * 1000000ULL;
+    } else if (strcmp(argv[i], "--fast") == 0) {
+      simConfig.realtime = false;
+    } else if (strcmp(argv[i], "--lcd") == 0) {
+      simConfig.showLcd = true;
+    } else if (strcmp(argv[i], "--pins") == 0) {
+      simConfig.showPins = true;
+    } else if (strcmp(argv[i], "--uart-link") == 0 && i + 1 < argc) {
+      simConfig.uartLink = argv[++i];
+    } else if (strcmp(argv[i], "--snmp-port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (simConfig.nodeId < 1 || simConfig.nodeId > 16 || port > 65535) usage(argv[0]);
+  snmpPort = port >= 0 ? port : SIM_SNMP_PORT_BASE + simConfig.nodeId;
+
+  simInit();
+  setup();
+  for (;;) loop();
+}
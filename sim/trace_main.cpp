@@ -0,0 +1,319 @@
+/****************************************************
+ * SCENARIO TRACE RUNNER (Linux build of main.cpp)
+ * - Runs the unmodified controller against many input
+ *   scenarios, one forked process each (so every run
+ *   starts from main.cpp's initial globals), several
+ *   at a time, in virtual time
+ * - A scenario is a button timeline (plus optional
+ *   Serial lines), from a file or generated from a seed
+ * - The output trace (pins, LCD, Serial; see sim.h) is
+ *   recorded as a reference, or compared against one:
+ *     --record DIR    write DIR/<scenario>.trace
+ *     --compare DIR   report the first differing line
+ *   so a change to phase timing shows up as a trace diff
+ *
+ * Build:
+ *   g++ -std=gnu++20 -O2 -Isim -o controller_trace \
+ *       main.cpp sim/sim.cpp sim/trace_main.cpp
+ *
+ * Usage:
+ *   controller_trace (--record DIR | --compare DIR)
+ *                    [--seeds A-B] [--seconds S] [--jobs N]
+ *                    [file.scn ...]
+ *
+ * Scenario file (one input per line, '#' comments):
+ *   <ms> press <pin> [holdMs]
+ *   <ms> pin <pin> <0|1>      level held until changed
+ *   <ms> serial <text>        '!' text: a sim.h command
+ *
+ * Reference traces live in scenarios/golden, one per
+ * scenarios .scn file plus seeds 1-20, 600 s each. A
+ * change to behaviour re-records them in its own commit
+ * (and --compare checks them), from scenarios/:
+ *   controller_trace --record golden --seeds 1-20 \
+ *       --seconds 600 *.scn
+ ****************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "sim.h"
+
+// Per-unit setting from main.cpp
+extern int snmpPort;
+
+const int TRACE_OK      = 0;
+const int TRACE_DIFF    = 1;
+const int TRACE_MISSING = 2;
+const int TRACE_ERROR   = 3;
+
+// Inputs the generated scenarios drive (see main.cpp)
+const int SCN_PIN_NS  = 12;
+const int SCN_PIN_EW  = 13;
+const int SCN_PIN_PED = 14;
+
+struct Scenario {
+  const char* file;   // nullptr: generated from seed
+  int         seed;
+  char        name[64];
+};
+
+static const char* traceDir   = nullptr;
+static bool        recordMode = false;
+static Scenario    current;
+static char*       traceBuf   = nullptr;
+static size_t      traceLen   = 0;
+
+// ============= SCENARIOS =============
+
+static uint32_t rngState;
+
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static uint32_t rngRange(uint32_t lo, uint32_t hi) {
+  return lo + rngNext() % (hi - lo + 1);
+}
+
+// Random arrivals per input; each seed picks its own demand levels
+static void generateScenario(int seed, uint64_t endUs) {
+  rngState = (uint32_t)seed * 2654435761u + 1;
+  static const int PINS[] = {SCN_PIN_NS, SCN_PIN_EW, SCN_PIN_PED};
+  for (int pin : PINS) {
+    uint32_t meanGapMs = pin == SCN_PIN_PED ? rngRange(5000, 60000) : rngRange(400, 8000);
+    uint64_t t         = 2000000 + (uint64_t)rngRange(0, meanGapMs) * 1000;
+    while (t < endUs) {
+      if (!simScheduleInput(t, pin, rngRange(60, 400))) return;
+      t += (uint64_t)rngRange(meanGapMs / 4, meanGapMs * 7 / 4) * 1000;
+    }
+  }
+}
+
+static bool loadScenario(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[128];
+  int  lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    line[strcspn(line, "\r\n")] = '\0';
+
+    unsigned long long ms;
+    int pin, hold = 100, used = 0;
+    char kind[16];
+    if (sscanf(line, " %llu %15s %n", &ms, kind, &used) < 2) {
+      if (strspn(line, " \t") != strlen(line)) {
+        fprintf(stderr, "%s:%d: bad line\n", path, lineNo);
+        fclose(f);
+        return false;
+      }
+      continue;
+    }
+    bool ok;
+    int  level;
+    if (strcmp(kind, "press") == 0 && sscanf(line + used, "%d %d", &pin, &hold) >= 1) {
+      ok = simScheduleInput(ms * 1000, pin, (uint32_t)hold);
+    } else if (strcmp(kind, "pin") == 0 && sscanf(line + used, "%d %d", &pin, &level) == 2) {
+      char cmd[32];
+      snprintf(cmd, sizeof(cmd), "!pin %d %d", pin, level ? 1 : 0);
+      ok = simScheduleSerial(ms * 1000, cmd);
+    } else if (strcmp(kind, "serial") == 0) {
+      ok = simScheduleSerial(ms * 1000, line + used);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "%s:%d: bad or too many inputs\n", path, lineNo);
+      fclose(f);
+      return false;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// ============= TRACE CHECK (in the child) =============
+
+static int compareTrace(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "%s: no reference trace\n", current.name);
+    return TRACE_MISSING;
+  }
+
+  FILE* got = fmemopen(traceBuf, traceLen, "r");
+  char  want[256], have[256];
+  int   lineNo = 0;
+  for (;;) {
+    lineNo++;
+    bool w = fgets(want, sizeof(want), f) != nullptr;
+    bool h = got && traceLen > 0 && fgets(have, sizeof(have), got) != nullptr;
+    if (!w && !h) break;
+    if (w && h && strcmp(want, have) == 0) continue;
+
+    want[strcspn(want, "\n")] = '\0';
+    have[strcspn(have, "\n")] = '\0';
+    fprintf(stderr, "%s: line %d\n  expected: %s\n  got:      %s\n", current.name, lineNo,
+            w ? want : "<end of trace>", h ? have : "<end of trace>");
+    fclose(f);
+    if (got) fclose(got);
+    return TRACE_DIFF;
+  }
+  fclose(f);
+  if (got) fclose(got);
+  return TRACE_OK;
+}
+
+// Runs when the sim stops the sketch (exit() from delay())
+static void finishTrace() {
+  fclose(simConfig.trace);
+  simConfig.trace = nullptr;
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s.trace", traceDir, current.name);
+
+  int status = TRACE_OK;
+  if (recordMode) {
+    FILE* f = fopen(path, "w");
+    if (!f || fwrite(traceBuf, 1, traceLen, f) != traceLen) {
+      perror(path);
+      status = TRACE_ERROR;
+    }
+    if (f) fclose(f);
+  } else {
+    status = compareTrace(path);
+  }
+  _exit(status);
+}
+
+static void runChild(uint64_t endUs) {
+  simConfig.offline     = true;
+  snmpPort              = 0;   // no agent socket
+  simConfig.realtime    = false;
+  simConfig.stopAfterUs = endUs;
+
+  bool ok = current.file ? loadScenario(current.file) : (generateScenario(current.seed, endUs), true);
+  if (!ok) _exit(TRACE_ERROR);
+
+  simConfig.trace = open_memstream(&traceBuf, &traceLen);
+  if (!simConfig.trace) _exit(TRACE_ERROR);
+  atexit(finishTrace);
+
+  simInit();
+  setup();
+  for (;;) loop();
+}
+
+// ============= PARENT =============
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s (--record DIR | --compare DIR) [--seeds A-B] [--seconds S]\n"
+          "          [--jobs N] [file.scn ...]\n",
+          prog);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  int  seedFirst = 0, seedLast = -1;
+  long seconds   = 300;
+  long jobs      = sysconf(_SC_NPROCESSORS_ONLN);
+
+  Scenario* scenarios = (Scenario*)calloc((size_t)argc + 1, sizeof(Scenario));
+  int       count     = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      traceDir   = argv[++i];
+      recordMode = true;
+    } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+      traceDir   = argv[++i];
+      recordMode = false;
+    } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%d-%d", &seedFirst, &seedLast) != 2) usage(argv[0]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = atol(argv[++i]);
+    } else if (argv[i][0] != '-') {
+      Scenario& s = scenarios[count++];
+      s.file = argv[i];
+      const char* base = strrchr(argv[i], '/');
+      base = base ? base + 1 : argv[i];
+      snprintf(s.name, sizeof(s.name), "%.*s", (int)strcspn(base, "."), base);
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (!traceDir || seconds <= 0 || jobs < 1) usage(argv[0]);
+  int total = count + (seedLast >= seedFirst ? seedLast - seedFirst + 1 : 0);
+  if (total == 0) usage(argv[0]);
+
+  uint64_t endUs = (uint64_t)seconds * 1000000ULL;
+  timespec t0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  int results[4] = {0, 0, 0, 0};
+  int started = 0, running = 0;
+  fflush(stdout);
+  fflush(stderr);
+
+  while (started < total || running > 0) {
+    if (started < total && running < jobs) {
+      if (started < count) {
+        current = scenarios[started];
+      } else {
+        current.file = nullptr;
+        current.seed = seedFirst + (started - count);
+        snprintf(current.name, sizeof(current.name), "seed-%d", current.seed);
+      }
+      started++;
+
+      pid_t pid = fork();
+      if (pid == 0) runChild(endUs);
+      if (pid < 0) {
+        perror("fork");
+        results[TRACE_ERROR]++;
+        continue;
+      }
+      running++;
+      continue;
+    }
+
+    int   st;
+    pid_t pid = wait(&st);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    running--;
+    int code = WIFEXITED(st) ? WEXITSTATUS(st) : TRACE_ERROR;
+    results[code <= TRACE_ERROR ? code : TRACE_ERROR]++;
+  }
+
+  timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  printf("trace: %d scenarios x %lds, %s, %d %s, %d differ, %d missing, %d errors (%.1fs)\n",
+         total, seconds, recordMode ? "record" : "compare", results[TRACE_OK],
+         recordMode ? "recorded" : "match", results[TRACE_DIFF], results[TRACE_MISSING],
+         results[TRACE_ERROR], wall);
+  free(scenarios);
+  return (results[TRACE_DIFF] || results[TRACE_MISSING] || results[TRACE_ERROR]) ? 1 : 0;
+}
@@ -0,0 +1,432 @@
+/****************************************************
+ * SNMP v2c AGENT (subset)
+ * - GetRequest, GetNextRequest and GetBulkRequest over
+ *   a static object table sorted by OID (SnmpObject);
+ *   SetRequest is answered notWritable (read-only)
+ * - The request is parsed in place: community, request
+ *   id and OIDs stay pointers into the datagram, OIDs
+ *   are compared arc by arc straight from their BER
+ * - The response is BER-encoded straight into the send
+ *   buffer in one pass: constructed types get a fixed
+ *   3-byte length (0x82 hi lo), patched on close
+ * - A wrong community is dropped without an answer
+ *   (counted), as v2c agents do
+ ****************************************************/
+
+#ifndef SNMP_H
+#define SNMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============= TAGS =============
+
+const uint8_t BER_INTEGER      = 0x02;
+const uint8_t BER_OCTET_STRING = 0x04;
+const uint8_t BER_NULL         = 0x05;
+const uint8_t BER_OID          = 0x06;
+const uint8_t BER_SEQUENCE     = 0x30;
+
+const uint8_t SNMP_COUNTER32 = 0x41;
+const uint8_t SNMP_GAUGE32   = 0x42;
+const uint8_t SNMP_TIMETICKS = 0x43;
+
+const uint8_t SNMP_NO_SUCH_OBJECT   = 0x80;
+const uint8_t SNMP_NO_SUCH_INSTANCE = 0x81;
+const uint8_t SNMP_END_OF_MIB_VIEW  = 0x82;
+
+const uint8_t SNMP_PDU_GET      = 0xA0;
+const uint8_t SNMP_PDU_GETNEXT  = 0xA1;
+const uint8_t SNMP_PDU_RESPONSE = 0xA2;
+const uint8_t SNMP_PDU_SET      = 0xA3;
+const uint8_t SNMP_PDU_GETBULK  = 0xA5;
+
+const int SNMP_VERSION_2C = 1;
+
+const uint8_t SNMP_ERR_NONE         = 0;
+const uint8_t SNMP_ERR_TOO_BIG      = 1;
+const uint8_t SNMP_ERR_NOT_WRITABLE = 17;
+
+const uint16_t SNMP_PORT         = 161;
+const int      SNMP_MAX_ARCS     = 16;
+const int      SNMP_MAX_VARBINDS = 16;
+const size_t   SNMP_MAX_MESSAGE  = 484;   // every manager accepts this much
+
+// ============= OBJECT TABLE =============
+
+struct SnmpObject {
+  uint16_t    oid[SNMP_MAX_ARCS];
+  uint8_t     len;     // arcs used
+  uint8_t     item;    // what the getter reports
+  uint8_t     index;   // table row (phase, detector, ...), 0 for scalars
+  const char* name;
+};
+
+struct SnmpValue {
+  uint8_t     type;    // BER_INTEGER, SNMP_COUNTER32, ..., BER_OCTET_STRING
+  int64_t     num;
+  const char* str;
+  char        text[32];   // for strings the getter builds
+};
+
+// Context for a community string, nullptr = not ours
+typedef void* (*SnmpCommunityFn)(const uint8_t* name, size_t len);
+// Value of one object; false = no such instance right now
+typedef bool (*SnmpGetFn)(void* ctx, const SnmpObject& obj, SnmpValue& v);
+
+struct SnmpAgent {
+  const SnmpObject* table;
+  int               count;
+  SnmpCommunityFn   community;
+  SnmpGetFn         get;
+  uint32_t          inPkts, outPkts, badCommunity, parseErrors;
+};
+
+// Table row from its arcs, e.g. snmpObject(ITEM, 0, "sysName.0", 1, 3, 6, 1, 2, 1, 1, 5, 0)
+template <typename... Arcs>
+constexpr SnmpObject snmpObject(uint8_t item, uint8_t index, const char* name, Arcs... arcs) {
+  static_assert(sizeof...(arcs) <= SNMP_MAX_ARCS, "OID too long (SNMP_MAX_ARCS)");
+  return {{(uint16_t)arcs...}, (uint8_t)sizeof...(arcs), item, index, name};
+}
+
+constexpr bool snmpObjectLess(const SnmpObject& a, const SnmpObject& b) {
+  for (int i = 0; i < a.len && i < b.len; i++) {
+    if (a.oid[i] != b.oid[i]) return a.oid[i] < b.oid[i];
+  }
+  return a.len < b.len;
+}
+
+constexpr bool snmpTableSorted(const SnmpObject* t, int count) {
+  for (int i = 1; i < count; i++) {
+    if (!snmpObjectLess(t[i - 1], t[i])) return false;
+  }
+  return true;
+}
+
+// ============= BER READ =============
+
+struct BerTlv {
+  uint8_t        tag;
+  const uint8_t* val;
+  size_t         len;
+};
+
+// Next TLV at p (definite lengths up to 64K); advances p past it
+inline bool berRead(const uint8_t*& p, const uint8_t* end, BerTlv& t) {
+  if (end - p < 2) return false;
+  t.tag      = *p++;
+  size_t len = *p++;
+  if (len & 0x80) {
+    int n = (int)(len & 0x7F);
+    if (n == 0 || n > 2 || end - p < n) return false;
+    len = 0;
+    while (n--) len = len << 8 | *p++;
+  }
+  if ((size_t)(end - p) < len) return false;
+  t.val = p;
+  t.len = len;
+  p += len;
+  return true;
+}
+
+inline bool berInt(const BerTlv& t, int32_t& v) {
+  if (t.tag != BER_INTEGER || t.len < 1 || t.len > 4) return false;
+  uint32_t u = t.val[0] & 0x80 ? 0xFFFFFFFF : 0;
+  for (size_t i = 0; i < t.len; i++) u = u << 8 | t.val[i];
+  v = (int32_t)u;
+  return true;
+}
+
+// -1 / 0 / 1 for a BER-encoded OID against table arcs, decoding the
+// BER one sub-identifier at a time; 'common' = leading arcs equal
+inline int snmpOidCompare(const uint8_t* ber, size_t berLen, const uint16_t* arcs, int n,
+                          int& common) {
+  size_t   i = 0;
+  uint32_t second  = 0;
+  bool     pending = false;   // second arc of the first sub-identifier
+  for (common = 0;; common++) {
+    bool     haveA = true;
+    uint32_t a     = 0;
+    if (pending) {
+      a       = second;
+      pending = false;
+    } else if (i < berLen) {
+      bool first = i == 0;
+      do {
+        a = a << 7 | (ber[i] & 0x7F);
+      } while ((ber[i++] & 0x80) && i < berLen);
+      if (first) {
+        uint32_t top = a < 40 ? 0 : a < 80 ? 1 : 2;
+        second  = a - 40 * top;
+        a       = top;
+        pending = true;
+      }
+    } else {
+      haveA = false;
+    }
+    bool haveB = common < n;
+    if (!haveA || !haveB) return (int)haveA - (int)haveB;
+    uint32_t b = arcs[common];
+    if (a != b) return a < b ? -1 : 1;
+  }
+}
+
+inline int snmpOidCompare(const uint8_t* ber, size_t berLen, const uint16_t* arcs, int n) {
+  int common;
+  return snmpOidCompare(ber, berLen, arcs, n, common);
+}
+
+// First row whose OID is >= (orEqual) or > the BER OID
+inline int snmpFind(const SnmpAgent& a, const BerTlv& oid, bool orEqual) {
+  int lo = 0, hi = a.count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    int c   = snmpOidCompare(oid.val, oid.len, a.table[mid].oid, a.table[mid].len);
+    if (c > 0 || (c == 0 && !orEqual)) lo = mid + 1;
+    else                               hi = mid;
+  }
+  return lo;
+}
+
+// ============= BER WRITE =============
+
+struct BerWriter {
+  uint8_t* buf;
+  size_t   cap;
+  size_t   pos;
+  bool     full;
+};
+
+inline void berByte(BerWriter& w, uint8_t b) {
+  if (w.pos < w.cap) w.buf[w.pos++] = b;
+  else               w.full = true;
+}
+
+inline void berLength(BerWriter& w, size_t len) {
+  if (len >= 256) {
+    berByte(w, 0x82);
+    berByte(w, (uint8_t)(len >> 8));
+  } else if (len >= 128) {
+    berByte(w, 0x81);
+  }
+  berByte(w, (uint8_t)len);
+}
+
+// Constructed type of unknown length: returns where its contents start
+inline size_t berOpen(BerWriter& w, uint8_t tag) {
+  berByte(w, tag);
+  berByte(w, 0x82);
+  berByte(w, 0);
+  berByte(w, 0);
+  return w.pos;
+}
+
+inline void berClose(BerWriter& w, size_t start) {
+  if (w.full) return;
+  size_t len = w.pos - start;
+  w.buf[start - 2] = (uint8_t)(len >> 8);
+  w.buf[start - 1] = (uint8_t)len;
+}
+
+inline void berBytes(BerWriter& w, uint8_t tag, const void* p, size_t len) {
+  berByte(w, tag);
+  berLength(w, len);
+  if (w.pos + len > w.cap) {
+    w.full = true;
+    return;
+  }
+  memcpy(w.buf + w.pos, p, len);
+  w.pos += len;
+}
+
+// Shortest two's complement; unsigned types get a leading 0 as needed
+inline void berInteger(BerWriter& w, uint8_t tag, int64_t v) {
+  int n = 8;
+  while (n > 1) {
+    int64_t top = v >> (8 * (n - 1) - 1);   // the dropped byte and the next sign bit
+    if (top != 0 && top != -1) break;
+    n--;
+  }
+  berByte(w, tag);
+  berByte(w, (uint8_t)n);
+  for (int i = n - 1; i >= 0; i--) berByte(w, (uint8_t)(v >> (8 * i)));
+}
+
+inline void berOid(BerWriter& w, const uint16_t* arcs, int n) {
+  uint8_t body[3 * SNMP_MAX_ARCS];
+  size_t  len = 0;
+  for (int i = 1; i < n; i++) {
+    uint32_t x = i == 1 ? 40u * arcs[0] + arcs[1] : arcs[i];
+    if (x >= 1u << 14) body[len++] = (uint8_t)(0x80 | x >> 14);
+    if (x >= 1u << 7)  body[len++] = (uint8_t)(0x80 | (x >> 7 & 0x7F));
+    body[len++] = (uint8_t)(x & 0x7F);
+  }
+  berBytes(w, BER_OID, body, len);
+}
+
+inline void snmpPutValue(BerWriter& w, const SnmpValue& v) {
+  if (v.type == BER_OCTET_STRING) berBytes(w, BER_OCTET_STRING, v.str, strlen(v.str));
+  else                            berInteger(w, v.type, v.num);
+}
+
+// ============= AGENT =============
+
+// One varbind for the first row at or after 'row' that has a value;
+// endOfMibView (named by 'reqOid') past the end. Returns the row used.
+inline int snmpPutNext(SnmpAgent& a, void* ctx, BerWriter& w, int row, const BerTlv& reqOid) {
+  SnmpValue v;
+  for (; row < a.count; row++) {
+    if (a.get(ctx, a.table[row], v)) break;
+  }
+  size_t vb = berOpen(w, BER_SEQUENCE);
+  if (row < a.count) {
+    berOid(w, a.table[row].oid, a.table[row].len);
+    snmpPutValue(w, v);
+  } else {
+    berBytes(w, BER_OID, reqOid.val, reqOid.len);
+    berBytes(w, SNMP_END_OF_MIB_VIEW, nullptr, 0);
+  }
+  berClose(w, vb);
+  return row;
+}
+
+inline void snmpPutGet(SnmpAgent& a, void* ctx, BerWriter& w, const BerTlv& reqOid) {
+  size_t vb  = berOpen(w, BER_SEQUENCE);
+  int    row = snmpFind(a, reqOid, true);
+  berBytes(w, BER_OID, reqOid.val, reqOid.len);
+  // No such instance when a neighbour row is the same object (all
+  // but its last arc match), no such object otherwise
+  SnmpValue v;
+  int       common = 0;
+  bool      exact  = row < a.count && snmpOidCompare(reqOid.val, reqOid.len, a.table[row].oid,
+                                                     a.table[row].len, common) == 0;
+  bool      known  = row < a.count && common >= a.table[row].len - 1;
+  if (!exact && row > 0) {
+    snmpOidCompare(reqOid.val, reqOid.len, a.table[row - 1].oid, a.table[row - 1].len, common);
+    known = known || common >= a.table[row - 1].len - 1;
+  }
+  if (exact && a.get(ctx, a.table[row], v)) snmpPutValue(w, v);
+  else if (exact || known)                  berBytes(w, SNMP_NO_SUCH_INSTANCE, nullptr, 0);
+  else                                      berBytes(w, SNMP_NO_SUCH_OBJECT, nullptr, 0);
+  berClose(w, vb);
+}
+
+// Request datagram in, response out; 0 = nothing to send
+inline size_t snmpHandle(SnmpAgent& a, const uint8_t* req, size_t reqLen, uint8_t* out,
+                         size_t cap) {
+  a.inPkts++;
+  const uint8_t* p   = req;
+  const uint8_t* end = req + reqLen;
+  BerTlv         msg, version, community, pdu, reqId, e1, e2, vbl;
+  int32_t        ver, nonRep = 0, maxRep = 0;
+
+  bool ok = berRead(p, end, msg) && msg.tag == BER_SEQUENCE;
+  if (ok) {
+    p   = msg.val;
+    end = msg.val + msg.len;
+    ok  = berRead(p, end, version) && berInt(version, ver) && ver == SNMP_VERSION_2C &&
+          berRead(p, end, community) && community.tag == BER_OCTET_STRING &&
+          berRead(p, end, pdu);
+  }
+  if (ok) {
+    p   = pdu.val;
+    end = pdu.val + pdu.len;
+    ok  = berRead(p, end, reqId) && reqId.tag == BER_INTEGER &&
+          berRead(p, end, e1) && berInt(e1, nonRep) &&
+          berRead(p, end, e2) && berInt(e2, maxRep) &&
+          berRead(p, end, vbl) && vbl.tag == BER_SEQUENCE;
+  }
+  if (!ok || (pdu.tag != SNMP_PDU_GET && pdu.tag != SNMP_PDU_GETNEXT &&
+              pdu.tag != SNMP_PDU_GETBULK && pdu.tag != SNMP_PDU_SET)) {
+    a.parseErrors++;
+    return 0;
+  }
+  void* ctx = a.community(community.val, community.len);
+  if (!ctx) {
+    a.badCommunity++;
+    return 0;
+  }
+
+  // Requested OIDs, still inside the datagram
+  BerTlv oids[SNMP_MAX_VARBINDS];
+  int    n = 0;
+  p   = vbl.val;
+  end = vbl.val + vbl.len;
+  while (p < end) {
+    BerTlv         vb, value;
+    const uint8_t* q = nullptr;
+    if (!berRead(p, end, vb) || vb.tag != BER_SEQUENCE || n == SNMP_MAX_VARBINDS ||
+        !berRead(q = vb.val, vb.val + vb.len, oids[n]) || oids[n].tag != BER_OID ||
+        !berRead(q, vb.val + vb.len, value)) {
+      a.parseErrors++;
+      return 0;
+    }
+    n++;
+  }
+
+  BerWriter w = {out, cap < SNMP_MAX_MESSAGE ? cap : SNMP_MAX_MESSAGE, 0, false};
+  size_t    m = berOpen(w, BER_SEQUENCE);
+  berInteger(w, BER_INTEGER, SNMP_VERSION_2C);
+  berBytes(w, BER_OCTET_STRING, community.val, community.len);
+  size_t r = berOpen(w, SNMP_PDU_RESPONSE);
+  berBytes(w, BER_INTEGER, reqId.val, reqId.len);
+  size_t status = w.pos + 2;   // one-byte error-status / error-index, patched below
+  berInteger(w, BER_INTEGER, SNMP_ERR_NONE);
+  berInteger(w, BER_INTEGER, 0);
+  size_t vblOpen = w.pos;
+  size_t l       = berOpen(w, BER_SEQUENCE);
+  uint8_t err = SNMP_ERR_NONE, errIndex = 0;
+
+  if (pdu.tag == SNMP_PDU_GET) {
+    for (int i = 0; i < n; i++) snmpPutGet(a, ctx, w, oids[i]);
+  } else if (pdu.tag == SNMP_PDU_GETNEXT) {
+    for (int i = 0; i < n; i++) snmpPutNext(a, ctx, w, snmpFind(a, oids[i], false), oids[i]);
+  } else if (pdu.tag == SNMP_PDU_SET) {
+    berClose(w, l);
+    w.pos = vblOpen;
+    berBytes(w, BER_SEQUENCE, vbl.val, vbl.len);   // echoed as received
+    err      = SNMP_ERR_NOT_WRITABLE;
+    errIndex = 1;
+  } else {
+    // GetBulk: non-repeaters once, then rows of repeaters until the
+    // message is full, max-repetitions is reached or all hit the end
+    if (nonRep < 0) nonRep = 0;
+    if (nonRep > n) nonRep = n;
+    for (int i = 0; i < nonRep; i++) snmpPutNext(a, ctx, w, snmpFind(a, oids[i], false), oids[i]);
+    int rows[SNMP_MAX_VARBINDS];
+    for (int i = nonRep; i < n; i++) rows[i] = snmpFind(a, oids[i], false);
+    for (int rep = 0; rep < maxRep && !w.full && nonRep < n; rep++) {
+      size_t rowStart = w.pos;
+      bool   allEnd   = true;
+      for (int i = nonRep; i < n; i++) {
+        rows[i] = snmpPutNext(a, ctx, w, rows[i], oids[i]) + 1;
+        if (rows[i] <= a.count) allEnd = false;
+      }
+      if (w.full) {
+        w.pos  = rowStart;   // drop the partial row; what fits is sent
+        w.full = false;
+        break;
+      }
+      if (allEnd) break;
+    }
+  }
+  if (pdu.tag != SNMP_PDU_SET) berClose(w, l);
+
+  if (w.full) {
+    // Nothing useful fits: empty varbind list and tooBig
+    w.pos  = vblOpen;
+    w.full = false;
+    berClose(w, berOpen(w, BER_SEQUENCE));
+    err = SNMP_ERR_TOO_BIG;
+  }
+  w.buf[status]     = err;
+  w.buf[status + 3] = errIndex;
+  berClose(w, r);
+  berClose(w, m);
+  if (w.full) return 0;
+  a.outPkts++;
+  return w.pos;
+}
+
+#endif
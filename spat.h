@@ -0,0 +1,115 @@
+/****************************************************
+ * SPaT (SIGNAL PHASE AND TIMING) MESSAGE
+ * - Per-movement state + min/max time-to-change
+ * - UPER-like bit packing (no byte alignment inside)
+ * - States use SAE J2735 MovementPhaseState values
+ * - Times are tenths of a second relative to the
+ *   message timestamp (J2735 uses absolute TimeMark)
+ *
+ * Frame layout (MSB first):
+ *   msgCount(7) intersectionId(16) timestampDs(16)
+ *   movementCount(3)
+ *   per movement:
+ *     signalGroup(4) state(4)
+ *     minEndDs(12) maxEndDs(12) likelyDs(12)
+ *   crc8 (byte aligned)
+ ****************************************************/
+
+#ifndef SPAT_H
+#define SPAT_H
+
+#include "bitpack.h"
+
+// ============= CONSTANTS =============
+
+const int SPAT_UDP_PORT       = 7400;
+const int SPAT_MAX_MOVEMENTS  = 7;
+const int SPAT_MAX_FRAME      = 48;
+
+const uint16_t SPAT_TIME_UNKNOWN = 4095;   // 12-bit "unknown" marker
+const uint16_t SPAT_TIME_MAX     = 4094;   // 409.4 s
+
+// Signal groups
+const uint8_t SG_NS_VEHICLE = 1;
+const uint8_t SG_EW_VEHICLE = 2;
+const uint8_t SG_PEDESTRIAN = 3;
+
+// J2735 MovementPhaseState (subset used here)
+const uint8_t MPS_DARK                = 1;
+const uint8_t MPS_STOP_AND_REMAIN     = 3;
+const uint8_t MPS_PROTECTED_ALLOWED   = 6;
+const uint8_t MPS_PROTECTED_CLEARANCE = 8;
+
+// ============= MESSAGE =============
+
+struct SpatMovement {
+  uint8_t  signalGroup;
+  uint8_t  state;       // MPS_*
+  uint16_t minEndDs;    // earliest change, tenths of a second
+  uint16_t maxEndDs;    // latest change, or SPAT_TIME_UNKNOWN
+  uint16_t likelyDs;    // best estimate, or SPAT_TIME_UNKNOWN
+};
+
+struct SpatMessage {
+  uint8_t      msgCount;        // 0..127, wraps
+  uint16_t     intersectionId;
+  uint16_t     timestampDs;     // tenths of a second within the hour
+  uint8_t      movementCount;
+  SpatMovement movements[SPAT_MAX_MOVEMENTS];
+};
+
+// Negative values are treated as unknown
+inline uint16_t spatClampDs(long ds) {
+  if (ds < 0) return SPAT_TIME_UNKNOWN;
+  if (ds > SPAT_TIME_MAX) return SPAT_TIME_MAX;
+  return (uint16_t)ds;
+}
+
+// ============= ENCODER / DECODER =============
+
+inline size_t spatEncode(const SpatMessage& m, uint8_t* out, size_t cap) {
+  BitWriter w;
+  bitsBegin(w, out, cap);
+
+  bitsPut(w, m.msgCount, 7);
+  bitsPut(w, m.intersectionId, 16);
+  bitsPut(w, m.timestampDs, 16);
+  bitsPut(w, m.movementCount, 3);
+  for (int i = 0; i < m.movementCount; i++) {
+    const SpatMovement& mv = m.movements[i];
+    bitsPut(w, mv.signalGroup, 4);
+    bitsPut(w, mv.state, 4);
+    bitsPut(w, mv.minEndDs, 12);
+    bitsPut(w, mv.maxEndDs, 12);
+    bitsPut(w, mv.likelyDs, 12);
+  }
+
+  size_t n = bitsBytes(w);
+  bitsPut(w, 0, (int)(n * 8 - w.bitPos));
+  if (w.overflow || n + 1 > cap) return 0;
+  out[n] = crc8(out, n);
+  return n + 1;
+}
+
+inline bool spatDecode(const uint8_t* in, size_t len, SpatMessage& m) {
+  if (len < 2 || crc8(in, len - 1) != in[len - 1]) return false;
+
+  BitReader r;
+  bitsBeginRead(r, in, len - 1);
+
+  m.msgCount       = (uint8_t)bitsGet(r, 7);
+  m.intersectionId = (uint16_t)bitsGet(r, 16);
+  m.timestampDs    = (uint16_t)bitsGet(r, 16);
+  m.movementCount  = (uint8_t)bitsGet(r, 3);
+  for (int i = 0; i < m.movementCount; i++) {
+    SpatMovement& mv = m.movements[i];
+    mv.signalGroup = (uint8_t)bitsGet(r, 4);
+    mv.state       = (uint8_t)bitsGet(r, 4);
+    mv.minEndDs    = (uint16_t)bitsGet(r, 12);
+    mv.maxEndDs    = (uint16_t)bitsGet(r, 12);
+    mv.likelyDs    = (uint16_t)bitsGet(r, 12);
+  }
+  return !r.underflow;
+}
+
+#endif
@@ -0,0 +1,165 @@
+/****************************************************
+ * BATCH CONTROLLER SIMULATION (host tool)
+ * - Runs many independent intersections through
+ *   tools/batch_sim.h and prints demand, delay and
+ *   throughput, plus the simulation rate in
+ *   controller-seconds per second
+ * - Demand per lane is spread evenly over the given
+ *   range (probability of an arrival per second)
+ * - --check runs the SIMD and the scalar kernel on the
+ *   same seeds and fails if any lane differs
+ *
+ * Build:  g++ -O3 -march=native -o batch_sim tools/batch_sim.cpp
+ * Usage:  batch_sim [--plan FILE] [--lanes N] [--seconds S] [--seed N]
+ *                   [--ns P[:P2]] [--ew P[:P2]] [--ped P[:P2]]
+ *                   [--scalar | --check]
+ *   FILE holds "PLAN <hex>" from tools/plan_compiler;
+ *   default is the built-in plan (default_plan.h)
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch_sim.h"
+#include "tool_io.h"
+#include "../default_plan.h"
+
+struct Range {
+  double lo, hi;
+};
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [--plan FILE] [--lanes N] [--seconds S] [--seed N]\n"
+          "          [--ns P[:P2]] [--ew P[:P2]] [--ped P[:P2]] [--scalar | --check]\n",
+          prog);
+  exit(2);
+}
+
+static Range parseRange(const char* s) {
+  Range r;
+  if (sscanf(s, "%lf:%lf", &r.lo, &r.hi) != 2) r.hi = r.lo = atof(s);
+  return r;
+}
+
+static double rangeAt(const Range& r, int lane, int lanes) {
+  return lanes > 1 ? r.lo + (r.hi - r.lo) * lane / (lanes - 1) : r.lo;
+}
+
+static double nowSec() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static bool setup(BatchSim& s, const PhasePlan& plan, int lanes, uint32_t seed,
+                  const Range& ns, const Range& ew, const Range& ped) {
+  if (!batchInit(s, lanes, plan, seed)) {
+    fprintf(stderr, "out of memory\n");
+    return false;
+  }
+  for (int l = 0; l < s.lanes; l++) {
+    batchSetDemand(s, l, rangeAt(ns, l, s.lanes), rangeAt(ew, l, s.lanes),
+                   rangeAt(ped, l, s.lanes));
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* planPath = nullptr;
+  int         lanes    = 4096;
+  long        seconds  = 3600;
+  uint32_t    seed     = 1;
+  Range       ns = {0.10, 0.10}, ew = {0.10, 0.10}, ped = {0.01, 0.01};
+  bool        scalar = false, check = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--plan") == 0 && i + 1 < argc) {
+      planPath = argv[++i];
+    } else if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+      lanes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--ns") == 0 && i + 1 < argc) {
+      ns = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--ew") == 0 && i + 1 < argc) {
+      ew = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--ped") == 0 && i + 1 < argc) {
+      ped = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--scalar") == 0) {
+      scalar = true;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (lanes < 1 || seconds < 1) usage(argv[0]);
+
+  PhasePlan plan;
+  if (planPath) {
+    if (!readPlanFile(planPath, plan)) return 1;
+  } else if (planLoad(DEFAULT_PLAN, sizeof(DEFAULT_PLAN), plan) != PLAN_OK) {
+    fprintf(stderr, "built-in plan rejected\n");
+    return 1;
+  }
+
+  BatchSim s;
+  if (!setup(s, plan, lanes, seed, ns, ew, ped)) return 1;
+
+  double t0 = nowSec();
+  batchRun(s, (uint64_t)seconds, scalar);
+  double wall = nowSec() - t0;
+
+  BatchTotals sum = {};
+  for (int l = 0; l < s.lanes; l++) {
+    const BatchTotals& t = s.totals[l];
+    sum.arriveNs  += t.arriveNs;
+    sum.arriveEw  += t.arriveEw;
+    sum.departNs  += t.departNs;
+    sum.departEw  += t.departEw;
+    sum.delayNs   += t.delayNs;
+    sum.delayEw   += t.delayEw;
+    sum.pedDelay  += t.pedDelay;
+    sum.pedServed += t.pedServed;
+  }
+
+  double laneSec = (double)s.lanes * seconds;
+  printf("%d lanes x %lds, %s kernel (%d-wide)\n", s.lanes, seconds,
+         scalar ? "scalar" : "SIMD", scalar ? 1 : BATCH_WIDTH);
+  printf("NS: %.1f veh/h in, %.1f out, delay %.1f s/veh\n", sum.arriveNs * 3600.0 / laneSec,
+         sum.departNs * 3600.0 / laneSec,
+         sum.departNs ? (double)sum.delayNs / sum.departNs : 0.0);
+  printf("EW: %.1f veh/h in, %.1f out, delay %.1f s/veh\n", sum.arriveEw * 3600.0 / laneSec,
+         sum.departEw * 3600.0 / laneSec,
+         sum.departEw ? (double)sum.delayEw / sum.departEw : 0.0);
+  printf("ped: %.1f walks/h, %.1f waiting ped-s/h\n", sum.pedServed * 3600.0 / laneSec,
+         sum.pedDelay * 3600.0 / laneSec);
+  printf("%.3fs, %.1fM controller-seconds/s\n", wall, laneSec / wall / 1e6);
+
+  if (check) {
+    BatchSim ref;
+    if (!setup(ref, plan, lanes, seed, ns, ew, ped)) return 1;
+    batchRun(ref, (uint64_t)seconds, !scalar);
+    int bad = 0;
+    for (int l = 0; l < s.lanes; l++) {
+      if (memcmp(&s.totals[l], &ref.totals[l], sizeof(BatchTotals)) != 0 ||
+          s.phase[l] != ref.phase[l] || s.remDs[l] != ref.remDs[l] ||
+          s.queueNs[l] != ref.queueNs[l] || s.queueEw[l] != ref.queueEw[l]) {
+        if (bad++ < 5) fprintf(stderr, "lane %d differs between kernels\n", l);
+      }
+    }
+    printf("check: %d of %d lanes differ\n", bad, s.lanes);
+    batchFree(ref);
+    if (bad) {
+      batchFree(s);
+      return 1;
+    }
+  }
+  batchFree(s);
+  return 0;
+}
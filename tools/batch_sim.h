@@ -0,0 +1,346 @@
+/****************************************************
+ * BATCH CONTROLLER SIMULATION (host, header-only)
+ * - Steps many independent copies of the main.cpp
+ *   phase logic in lock-step, one second per step;
+ *   structure-of-arrays state, one SIMD lane per
+ *   intersection
+ * - Same rules as the firmware: a compiled timing plan
+ *   (phaseprog.h) is interpreted per lane, counts are
+ *   taken only while the approach is red, green = base
+ *   + count steps, the count resets when its green is
+ *   served, the ped phase runs only when latched and
+ *   presses during WALK / STOP are lost
+ * - Queue model per approach: Bernoulli arrivals each
+ *   second (xorshift32 per lane), discharge at
+ *   saturation flow while green; delay = queued
+ *   vehicle-seconds. Not modelled: coordination cuts,
+ *   detector faults, sub-second button timing
+ * - The kernel is written once over a lane type: GCC
+ *   vector extensions give AVX-512 / AVX2 / SSE2 code
+ *   (build with -march=native), int32_t gives the
+ *   scalar path. Both produce identical results.
+ *   Phase changes (rare per lane) run scalar over the
+ *   lanes whose interval ran out
+ ****************************************************/
+
+#ifndef BATCH_SIM_H
+#define BATCH_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../phaseprog.h"
+
+// ============= CONSTANTS =============
+
+#if defined(__AVX512F__)
+const int BATCH_WIDTH = 16;
+#elif defined(__AVX2__)
+const int BATCH_WIDTH = 8;
+#else
+const int BATCH_WIDTH = 4;
+#endif
+
+const int BATCH_DS_PER_STEP = 10;      // one step = 1 s
+const int BATCH_SAT_FLOW_Q8 = 128;     // departures per green second x 256 (1800 veh/h)
+const int BATCH_TILE_LANES  = 512;     // lanes stepped together (state stays in L2)
+const int BATCH_CHUNK_STEPS = 32768;   // int32 accumulators are flushed this often
+
+// Lane phases; the first five match the Phase enum in main.cpp
+const int BATCH_NS_GREEN  = 0;
+const int BATCH_NS_YELLOW = 1;
+const int BATCH_EW_GREEN  = 2;
+const int BATCH_EW_YELLOW = 3;
+const int BATCH_PED_WALK  = 4;
+const int BATCH_PED_STOP  = 5;
+
+typedef int32_t  BatchVec  __attribute__((vector_size(BATCH_WIDTH * 4)));
+typedef uint32_t BatchUVec __attribute__((vector_size(BATCH_WIDTH * 4)));
+
+// ============= STATE =============
+
+// Per-lane results since batchInit()
+struct BatchTotals {
+  uint64_t seconds;
+  uint64_t arriveNs, arriveEw;
+  uint64_t departNs, departEw;
+  uint64_t delayNs, delayEw;     // queued vehicle-seconds
+  uint64_t pedDelay;             // waiting pedestrian-seconds
+  uint64_t pedServed;            // WALK phases
+};
+
+struct BatchSim {
+  int       lanes;               // multiple of BATCH_WIDTH
+  PhasePlan plan;
+  uint8_t   nextPc[PLAN_MAX_OPS];
+
+  // Controller state
+  int32_t* phase;
+  int32_t* pc;
+  int32_t* remDs;                // left in the current interval
+  int32_t* countNs;              // trafficCountNS
+  int32_t* countEw;
+  int32_t* pedLatch;             // pedRequest
+
+  // World state
+  int32_t*  queueNs;
+  int32_t*  queueEw;
+  int32_t*  creditNs;            // saturation-flow credit x 256
+  int32_t*  creditEw;
+  int32_t*  pedQueue;
+  uint32_t* rng;
+  uint32_t* probNs;              // arrival probability per second x 2^32
+  uint32_t* probEw;
+  uint32_t* probPed;
+
+  // Accumulators since the last flush
+  int32_t* accArriveNs;
+  int32_t* accArriveEw;
+  int32_t* accDepartNs;
+  int32_t* accDepartEw;
+  int32_t* accDelayNs;
+  int32_t* accDelayEw;
+  int32_t* accPedDelay;
+  int32_t* accPedServed;
+
+  BatchTotals* totals;
+};
+
+// ============= LANE HELPERS =============
+
+template <typename T>
+inline T batchLoad(const void* p) {
+  T v;
+  memcpy(&v, p, sizeof(T));
+  return v;
+}
+
+template <typename T>
+inline void batchStore(void* p, const T& v) {
+  memcpy(p, &v, sizeof(T));
+}
+
+// Comparison results as all-ones / zero lanes
+inline int32_t  batchMask(bool b)     { return -(int32_t)b; }
+inline BatchVec batchMask(BatchVec m) { return m; }
+
+inline int32_t batchLane(int32_t v, int k)  { (void)k; return v; }
+inline int32_t batchLane(BatchVec v, int k) { return v[k]; }
+
+template <typename V>
+inline V batchSelect(V mask, V a, V b) {
+  return (mask & a) | (~mask & b);
+}
+
+// ============= PHASE CHANGES (scalar) =============
+
+// Start op 'pc' in lane l; its length is added to remDs
+inline void batchEnter(BatchSim& s, int l, int pc) {
+  const PhasePlan& p  = s.plan;
+  const PlanOp     op = p.ops[pc];
+  s.pc[l] = pc;
+  switch (op.code) {
+    case OP_GREEN:
+      if (op.arg == PLAN_APPROACH_NS) {
+        s.phase[l]  = BATCH_NS_GREEN;
+        s.remDs[l] += planGreenSeconds(p, PLAN_APPROACH_NS, s.countNs[l]) * 10;
+        s.countNs[l] = 0;   // main.cpp resets at green end; no counts on green
+      } else {
+        s.phase[l]  = BATCH_EW_GREEN;
+        s.remDs[l] += planGreenSeconds(p, PLAN_APPROACH_EW, s.countEw[l]) * 10;
+        s.countEw[l] = 0;
+      }
+      break;
+    case OP_YELLOW:
+      s.phase[l]  = op.arg == PLAN_APPROACH_NS ? BATCH_NS_YELLOW : BATCH_EW_YELLOW;
+      s.remDs[l] += p.yellowSec * 10;
+      break;
+    case OP_PED:
+      if (s.pedLatch[l]) {
+        s.phase[l]    = BATCH_PED_WALK;
+        s.remDs[l]   += p.pedSec * 10;
+        s.pedQueue[l] = 0;
+      }
+      break;   // not latched: zero length, the previous phase stays
+  }
+}
+
+inline void batchAdvance(BatchSim& s, int l) {
+  while (s.remDs[l] <= 0) {
+    if (s.phase[l] == BATCH_PED_WALK) {
+      s.phase[l]  = BATCH_PED_STOP;
+      s.remDs[l] += s.plan.pedStopDs;
+      continue;
+    }
+    if (s.phase[l] == BATCH_PED_STOP) {
+      s.pedLatch[l] = 0;
+      s.accPedServed[l]++;
+      s.phase[l] = BATCH_EW_YELLOW;   // placeholder until the next op sets it
+    }
+    batchEnter(s, l, s.nextPc[s.pc[l]]);
+  }
+}
+
+// ============= KERNEL =============
+
+// One second for lanes [first, last); V / U are the lane types
+template <typename V, typename U>
+inline void batchStepTile(BatchSim& s, int first, int last) {
+  const int W = (int)(sizeof(V) / 4);
+  for (int i = first; i < last; i += W) {
+    U x = batchLoad<U>(s.rng + i);
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    V arrNs = batchMask(x < batchLoad<U>(s.probNs + i));
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    V arrEw = batchMask(x < batchLoad<U>(s.probEw + i));
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    V arrPed = batchMask(x < batchLoad<U>(s.probPed + i));
+    batchStore(s.rng + i, x);
+
+    V ph      = batchLoad<V>(s.phase + i);
+    V nsGreen = batchMask(ph == BATCH_NS_GREEN);
+    V ewGreen = batchMask(ph == BATCH_EW_GREEN);
+    V nsRed   = ~(nsGreen | batchMask(ph == BATCH_NS_YELLOW));
+    V ewRed   = ~(ewGreen | batchMask(ph == BATCH_EW_YELLOW));
+    V walk    = batchMask(ph == BATCH_PED_WALK);
+
+    // Arrivals join the queue; the detector counts them only on red
+    V qNs = batchLoad<V>(s.queueNs + i) - arrNs;
+    V qEw = batchLoad<V>(s.queueEw + i) - arrEw;
+    batchStore(s.countNs + i, batchLoad<V>(s.countNs + i) - (arrNs & nsRed));
+    batchStore(s.countEw + i, batchLoad<V>(s.countEw + i) - (arrEw & ewRed));
+    batchStore(s.accArriveNs + i, batchLoad<V>(s.accArriveNs + i) - arrNs);
+    batchStore(s.accArriveEw + i, batchLoad<V>(s.accArriveEw + i) - arrEw);
+
+    // Discharge at saturation flow while green
+    V crNs  = (batchLoad<V>(s.creditNs + i) + BATCH_SAT_FLOW_Q8) & nsGreen;
+    V crEw  = (batchLoad<V>(s.creditEw + i) + BATCH_SAT_FLOW_Q8) & ewGreen;
+    V depNs = batchMask(crNs >= 256) & batchMask(qNs > 0);
+    V depEw = batchMask(crEw >= 256) & batchMask(qEw > 0);
+    qNs  += depNs;
+    qEw  += depEw;
+    crNs -= depNs & 256;
+    crEw -= depEw & 256;
+    V zero = crNs - crNs;
+    batchStore(s.creditNs + i, batchSelect(batchMask(crNs > 256), zero + 256, crNs));
+    batchStore(s.creditEw + i, batchSelect(batchMask(crEw > 256), zero + 256, crEw));
+    batchStore(s.queueNs + i, qNs);
+    batchStore(s.queueEw + i, qEw);
+    batchStore(s.accDepartNs + i, batchLoad<V>(s.accDepartNs + i) - depNs);
+    batchStore(s.accDepartEw + i, batchLoad<V>(s.accDepartEw + i) - depEw);
+    batchStore(s.accDelayNs + i, batchLoad<V>(s.accDelayNs + i) + qNs);
+    batchStore(s.accDelayEw + i, batchLoad<V>(s.accDelayEw + i) + qEw);
+
+    // Pedestrians arriving during WALK cross at once
+    batchStore(s.pedLatch + i, batchLoad<V>(s.pedLatch + i) | (arrPed & 1));
+    V pq = batchLoad<V>(s.pedQueue + i) - (arrPed & ~walk);
+    batchStore(s.pedQueue + i, pq);
+    batchStore(s.accPedDelay + i, batchLoad<V>(s.accPedDelay + i) + pq);
+
+    V rem = batchLoad<V>(s.remDs + i) - BATCH_DS_PER_STEP;
+    batchStore(s.remDs + i, rem);
+    V due = batchMask(rem <= 0);
+    for (int k = 0; k < W; k++) {
+      if (batchLane(due, k)) batchAdvance(s, i + k);
+    }
+  }
+}
+
+// ============= API =============
+
+inline void batchFlush(BatchSim& s, uint64_t steps) {
+  for (int l = 0; l < s.lanes; l++) {
+    BatchTotals& t = s.totals[l];
+    t.seconds   += steps;
+    t.arriveNs  += (uint32_t)s.accArriveNs[l];
+    t.arriveEw  += (uint32_t)s.accArriveEw[l];
+    t.departNs  += (uint32_t)s.accDepartNs[l];
+    t.departEw  += (uint32_t)s.accDepartEw[l];
+    t.delayNs   += (uint32_t)s.accDelayNs[l];
+    t.delayEw   += (uint32_t)s.accDelayEw[l];
+    t.pedDelay  += (uint32_t)s.accPedDelay[l];
+    t.pedServed += (uint32_t)s.accPedServed[l];
+    s.accArriveNs[l] = s.accArriveEw[l] = s.accDepartNs[l] = s.accDepartEw[l] = 0;
+    s.accDelayNs[l] = s.accDelayEw[l] = s.accPedDelay[l] = s.accPedServed[l] = 0;
+  }
+}
+
+// Start measuring afresh (after a warm-up); state is kept
+inline void batchResetTotals(BatchSim& s) {
+  memset(s.totals, 0, (size_t)s.lanes * sizeof(BatchTotals));
+}
+
+inline uint32_t batchProb(double p) {
+  if (p <= 0) return 0;
+  if (p >= 1) return 0xFFFFFFFF;
+  return (uint32_t)(p * 4294967296.0);
+}
+
+// Per-lane arrival probabilities per second
+inline void batchSetDemand(BatchSim& s, int lane, double ns, double ew, double ped) {
+  s.probNs[lane]  = batchProb(ns);
+  s.probEw[lane]  = batchProb(ew);
+  s.probPed[lane] = batchProb(ped);
+}
+
+// All lanes start at op 0 with empty queues, no demand
+inline bool batchInit(BatchSim& s, int lanes, const PhasePlan& plan, uint32_t seed) {
+  s.lanes = (lanes + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+  s.plan  = plan;
+  for (int pc = 0; pc < plan.opCount; pc++) s.nextPc[pc] = (uint8_t)planNextPc(plan, pc);
+
+  int32_t** fields[] = {
+    &s.phase, &s.pc, &s.remDs, &s.countNs, &s.countEw, &s.pedLatch,
+    &s.queueNs, &s.queueEw, &s.creditNs, &s.creditEw, &s.pedQueue,
+    (int32_t**)&s.rng, (int32_t**)&s.probNs, (int32_t**)&s.probEw, (int32_t**)&s.probPed,
+    &s.accArriveNs, &s.accArriveEw, &s.accDepartNs, &s.accDepartEw,
+    &s.accDelayNs, &s.accDelayEw, &s.accPedDelay, &s.accPedServed,
+  };
+  size_t bytes = (size_t)s.lanes * 4;
+  for (int32_t** f : fields) {
+    *f = (int32_t*)aligned_alloc(64, (bytes + 63) / 64 * 64);
+    if (!*f) return false;
+    memset(*f, 0, bytes);
+  }
+  s.totals = (BatchTotals*)calloc((size_t)s.lanes, sizeof(BatchTotals));
+  if (!s.totals) return false;
+
+  for (int l = 0; l < s.lanes; l++) {
+    uint32_t x = (seed + (uint32_t)l) * 2654435761u;
+    s.rng[l] = x ? x : 1;
+    batchEnter(s, l, 0);
+    batchAdvance(s, l);
+  }
+  return true;
+}
+
+inline void batchFree(BatchSim& s) {
+  void* fields[] = {
+    s.phase, s.pc, s.remDs, s.countNs, s.countEw, s.pedLatch,
+    s.queueNs, s.queueEw, s.creditNs, s.creditEw, s.pedQueue,
+    s.rng, s.probNs, s.probEw, s.probPed,
+    s.accArriveNs, s.accArriveEw, s.accDepartNs, s.accDepartEw,
+    s.accDelayNs, s.accDelayEw, s.accPedDelay, s.accPedServed, s.totals,
+  };
+  for (void* f : fields) free(f);
+}
+
+// Advance every lane by 'seconds'; scalar = use the int32_t kernel
+inline void batchRun(BatchSim& s, uint64_t seconds, bool scalar = false) {
+  while (seconds > 0) {
+    uint64_t steps = seconds < (uint64_t)BATCH_CHUNK_STEPS ? seconds : BATCH_CHUNK_STEPS;
+    for (int first = 0; first < s.lanes; first += BATCH_TILE_LANES) {
+      int last = first + BATCH_TILE_LANES < s.lanes ? first + BATCH_TILE_LANES : s.lanes;
+      for (uint64_t t = 0; t < steps; t++) {
+        if (scalar) batchStepTile<int32_t, uint32_t>(s, first, last);
+        else        batchStepTile<BatchVec, BatchUVec>(s, first, last);
+      }
+    }
+    batchFlush(s, steps);
+    seconds -= steps;
+  }
+}
+
+#endif
@@ -0,0 +1,224 @@
+/****************************************************
+ * CABINET BUS STAND-IN (host tool)
+ * - The cabinet end of the controller's bus (see
+ *   cabbus.h): opens the simulator's UART pty, decodes
+ *   every output frame and answers it with the current
+ *   detector input frame
+ * - Prints the signal heads whenever a lamp changes,
+ *   and flags conflicting greens / WALK the way a
+ *   conflict monitor would
+ * - No frame for 1 s: "FLASH" (the cabinet would put
+ *   the intersection into flash), "RUN" when they
+ *   come back
+ * - Stdin commands (detector input n = bit n):
+ *     press <n> [ms]   input low for ms (default 100)
+ *     hold <n>         input low until released
+ *     release <n>
+ *     train <h> <0|1>  head h's crossing relay: both
+ *                      call contacts change over
+ * - Each head's rail NC contact starts closed (low),
+ *   so no train is signalled until "train h 1"
+ * - --corrupt N flips a bit in every Nth answer, to
+ *   exercise the controller's FCS check
+ *
+ * Build:  g++ -O2 -o cabinet_sim tools/cabinet_sim.cpp
+ * Usage:  cabinet_sim [--heads N] [--seconds S] [--corrupt N] TTY
+ *   TTY is the "sim: UART2 on /dev/pts/N" path, or the
+ *   controller_sim --uart-link PATH
+ ****************************************************/
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../cabbus.h"
+#include "../sigout.h"
+#include "../detin.h"
+
+static const double SILENT_FLASH_SEC = 1.0;
+
+static double nowSec() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [--heads N] [--seconds S] [--corrupt N] TTY\n", prog);
+  exit(2);
+}
+
+// R / Y / G of one vehicle head; '-' dark, '!' more than one lit
+static char vehicleLamp(SigFrame f, int red) {
+  int lit = sigIsOn(f, red) + sigIsOn(f, red + 1) + sigIsOn(f, red + 2);
+  if (lit == 0) return '-';
+  if (lit > 1) return '!';
+  return sigIsOn(f, red) ? 'R' : sigIsOn(f, red + 1) ? 'Y' : 'G';
+}
+
+static void printHeads(double t, SigFrame f, int heads) {
+  printf("%9.3f", t);
+  for (int h = 0; h < heads; h++) {
+    int  base = h * SIG_HEAD_OUTPUTS;
+    bool walk = sigIsOn(f, base + SIG_PED_GREEN);
+    bool dont = sigIsOn(f, base + SIG_PED_RED);
+    printf("  #%d NS:%c EW:%c PED:%s", h, vehicleLamp(f, base + SIG_NS_RED),
+           vehicleLamp(f, base + SIG_EW_RED),
+           walk && dont ? "!" : walk ? "WALK" : dont ? "DONT" : "-");
+  }
+  printf("\n");
+}
+
+// Conflicting movements lit at once, per head
+static bool conflict(SigFrame f, int heads) {
+  for (int h = 0; h < heads; h++) {
+    int  base = h * SIG_HEAD_OUTPUTS;
+    bool ns   = sigIsOn(f, base + SIG_NS_GREEN) || sigIsOn(f, base + SIG_NS_YELLOW);
+    bool ew   = sigIsOn(f, base + SIG_EW_GREEN) || sigIsOn(f, base + SIG_EW_YELLOW);
+    bool walk = sigIsOn(f, base + SIG_PED_GREEN);
+    if ((ns && ew) || (walk && (ns || ew))) return true;
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  const char* path     = nullptr;
+  int         heads    = 1;
+  double      seconds  = 0;
+  int         corruptN = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--heads") == 0 && i + 1 < argc) {
+      heads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--corrupt") == 0 && i + 1 < argc) {
+      corruptN = atoi(argv[++i]);
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (!path || heads < 1 || heads > SIG_MAX_OUTPUTS / SIG_HEAD_OUTPUTS) usage(argv[0]);
+
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(path);
+    return 1;
+  }
+  termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+
+  CabDecoder dec;
+  cabDecoderReset(dec);
+  DetFrame inputs = ~(DetFrame)0;
+  double   releaseAt[DET_MAX_INPUTS] = {};   // 0 = not a timed press
+  for (int h = 0; h < heads && (h + 1) * DET_HEAD_INPUTS <= DET_MAX_INPUTS; h++) {
+    inputs &= ~((DetFrame)1 << (h * DET_HEAD_INPUTS + DET_RAIL));
+  }
+  SigFrame lamps     = 0;
+  bool     haveLamps = false, flashing = false, conflicted = false;
+  long     answers   = 0, writeErrors = 0;
+  double   start = nowSec(), lastFrame = start;
+  char     line[128];
+  int      lineLen = 0;
+  bool     stdinOpen = true;
+
+  for (;;) {
+    double now = nowSec();
+    if (seconds > 0 && now - start >= seconds) break;
+    for (int i = 0; i < DET_MAX_INPUTS; i++) {
+      if (releaseAt[i] > 0 && now >= releaseAt[i]) {
+        releaseAt[i] = 0;
+        inputs |= (DetFrame)1 << i;
+      }
+    }
+    if (!flashing && now - lastFrame > SILENT_FLASH_SEC) {
+      flashing = true;
+      printf("%9.3f  FLASH (no frames for %.1f s)\n", now - start, SILENT_FLASH_SEC);
+      fflush(stdout);
+    }
+
+    pollfd fds[2] = {{fd, POLLIN, 0}, {stdinOpen ? 0 : -1, POLLIN, 0}};
+    if (poll(fds, 2, 10) < 0) break;
+
+    if (fds[0].revents & POLLIN) {
+      uint8_t buf[256];
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) break;
+      for (ssize_t i = 0; i < n; i++) {
+        CabFrame f;
+        if (!cabDecodeByte(dec, buf[i], f)) continue;
+        if (f.addr != CAB_ADDR_CABINET || f.type != CAB_TYPE_OUTPUTS) continue;
+        lastFrame = now;
+        if (flashing) {
+          flashing = false;
+          printf("%9.3f  RUN\n", now - start);
+        }
+        if (!haveLamps || f.data != lamps) {
+          lamps     = f.data;
+          haveLamps = true;
+          printHeads(now - start, lamps, heads);
+          bool c = conflict(lamps, heads);
+          if (c && !conflicted) printf("%9.3f  CONFLICT\n", now - start);
+          conflicted = c;
+        }
+
+        CabFrame answer = {CAB_ADDR_CABINET, CAB_TYPE_INPUTS, f.seq, inputs};
+        uint8_t  wire[CAB_MAX_WIRE];
+        size_t   len = cabEncode(answer, wire, sizeof(wire));
+        answers++;
+        if (corruptN > 0 && answers % corruptN == 0) wire[len / 2] ^= 0x01;
+        if (write(fd, wire, len) != (ssize_t)len) writeErrors++;
+      }
+      fflush(stdout);
+    } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char c;
+      if (read(0, &c, 1) <= 0) {
+        stdinOpen = false;
+        continue;
+      }
+      if (c != '\n') {
+        if (lineLen < (int)sizeof(line) - 1) line[lineLen++] = c;
+        continue;
+      }
+      line[lineLen] = '\0';
+      lineLen = 0;
+      int in = -1, ms = 100, on = 0;
+      if (sscanf(line, "train %d %d", &in, &on) == 2 && in >= 0 &&
+          (in + 1) * DET_HEAD_INPUTS <= DET_MAX_INPUTS) {
+        DetFrame nc = (DetFrame)1 << (in * DET_HEAD_INPUTS + DET_RAIL);
+        DetFrame no = (DetFrame)1 << (in * DET_HEAD_INPUTS + DET_RAIL_CHECK);
+        inputs = on ? (inputs | nc) & ~no : (inputs & ~nc) | no;
+      } else if (sscanf(line, "press %d %d", &in, &ms) >= 1 && in >= 0 && in < DET_MAX_INPUTS) {
+        inputs &= ~((DetFrame)1 << in);
+        releaseAt[in] = now + ms / 1000.0;
+      } else if (sscanf(line, "hold %d", &in) == 1 && in >= 0 && in < DET_MAX_INPUTS) {
+        inputs &= ~((DetFrame)1 << in);
+        releaseAt[in] = 0;
+      } else if (sscanf(line, "release %d", &in) == 1 && in >= 0 && in < DET_MAX_INPUTS) {
+        inputs |= (DetFrame)1 << in;
+        releaseAt[in] = 0;
+      } else {
+        fprintf(stderr, "? %s\n", line);
+      }
+    }
+  }
+
+  fprintf(stderr, "%lu frames, %lu bad, %ld answers, %ld write errors\n",
+          (unsigned long)dec.good, (unsigned long)dec.bad, answers, writeErrors);
+  close(fd);
+  return 0;
+}
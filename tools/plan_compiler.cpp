@@ -0,0 +1,198 @@
+/****************************************************
+ * TIMING PLAN COMPILER (host tool)
+ * - Compiles a .plan text file (see plans/default.plan)
+ *   into the binary phase program of phaseprog.h
+ * - The image is run through the firmware's own
+ *   planLoad() verifier before it is written out
+ * - Default output is one "PLAN <hex>" line, ready to
+ *   send to the controller's serial port; --c writes a
+ *   C header for the built-in default plan
+ *
+ * Build:  g++ -O2 -o plan_compiler tools/plan_compiler.cpp
+ * Usage:  plan_compiler [--c NAME] file.plan
+ *
+ * Plan syntax (one statement per line, '#' comments):
+ *   yellow <sec>
+ *   ped <sec>
+ *   ped_stop_ms <ms>                 (multiple of 100)
+ *   approach ns|ew base <sec> [step <count> +<sec>]...
+ *   sequence
+ *     green ns|ew
+ *     yellow ns|ew
+ *     ped
+ *     loop                           (optional: repeat from here)
+ *   repeat
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../phaseprog.h"
+
+static const char* planFile = "";
+static int         lineNo   = 0;
+
+static void fail(const char* msg, const char* arg) {
+  fprintf(stderr, "%s:%d: %s%s%s\n", planFile, lineNo, msg,
+          arg ? ": " : "", arg ? arg : "");
+  exit(1);
+}
+
+static int parseInt(const char* tok, int lo, int hi) {
+  if (!tok) fail("missing number", nullptr);
+  char* end;
+  long v = strtol(tok, &end, 10);
+  if (*end != '\0' || v < lo || v > hi) fail("bad number", tok);
+  return (int)v;
+}
+
+static uint8_t parseApproach(const char* tok) {
+  if (tok && strcmp(tok, "ns") == 0) return PLAN_APPROACH_NS;
+  if (tok && strcmp(tok, "ew") == 0) return PLAN_APPROACH_EW;
+  fail("expected ns or ew", tok);
+  return 0;
+}
+
+static void addOp(PhasePlan& p, uint8_t code, uint8_t arg) {
+  if (p.opCount >= PLAN_MAX_OPS) fail("too many ops", nullptr);
+  p.ops[p.opCount].code = code;
+  p.ops[p.opCount].arg  = arg;
+  p.opCount++;
+}
+
+static void compile(FILE* in, PhasePlan& p) {
+  memset(&p, 0, sizeof(p));
+  bool haveApproach[PLAN_APPROACHES] = {false, false};
+  bool inSequence = false, repeated = false;
+  int  loopStart  = 0;
+
+  char line[256];
+  while (fgets(line, sizeof(line), in)) {
+    lineNo++;
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+
+    char* tok = strtok(line, " \t\r\n");
+    if (!tok) continue;
+    if (repeated) fail("statement after repeat", tok);
+
+    if (inSequence) {
+      if (strcmp(tok, "green") == 0) {
+        addOp(p, OP_GREEN, parseApproach(strtok(nullptr, " \t\r\n")));
+      } else if (strcmp(tok, "yellow") == 0) {
+        addOp(p, OP_YELLOW, parseApproach(strtok(nullptr, " \t\r\n")));
+      } else if (strcmp(tok, "ped") == 0) {
+        addOp(p, OP_PED, 0);
+      } else if (strcmp(tok, "loop") == 0) {
+        loopStart = p.opCount;
+      } else if (strcmp(tok, "repeat") == 0) {
+        addOp(p, OP_JUMP, (uint8_t)loopStart);
+        repeated = true;
+      } else {
+        fail("unknown op", tok);
+      }
+      continue;
+    }
+
+    if (strcmp(tok, "yellow") == 0) {
+      p.yellowSec = (uint8_t)parseInt(strtok(nullptr, " \t\r\n"), 0, 255);
+    } else if (strcmp(tok, "ped") == 0) {
+      p.pedSec = (uint8_t)parseInt(strtok(nullptr, " \t\r\n"), 0, 255);
+    } else if (strcmp(tok, "ped_stop_ms") == 0) {
+      int ms = parseInt(strtok(nullptr, " \t\r\n"), 0, 25500);
+      if (ms % 100 != 0) fail("ped_stop_ms must be a multiple of 100", nullptr);
+      p.pedStopDs = (uint8_t)(ms / 100);
+    } else if (strcmp(tok, "approach") == 0) {
+      uint8_t a = parseApproach(strtok(nullptr, " \t\r\n"));
+      if (haveApproach[a]) fail("approach defined twice", nullptr);
+      haveApproach[a] = true;
+
+      PlanApproach& ap = p.approaches[a];
+      char* kw = strtok(nullptr, " \t\r\n");
+      if (!kw || strcmp(kw, "base") != 0) fail("expected base", kw);
+      ap.baseSec = (uint8_t)parseInt(strtok(nullptr, " \t\r\n"), 0, 255);
+
+      while ((kw = strtok(nullptr, " \t\r\n")) != nullptr) {
+        if (strcmp(kw, "step") != 0) fail("expected step", kw);
+        if (ap.stepCount >= PLAN_MAX_STEPS) fail("too many steps", nullptr);
+        int   count = parseInt(strtok(nullptr, " \t\r\n"), 0, 255);
+        char* extra = strtok(nullptr, " \t\r\n");
+        if (!extra || extra[0] != '+') fail("expected +<sec>", extra);
+        ap.steps[ap.stepCount].minCount = (uint8_t)count;
+        ap.steps[ap.stepCount].extraSec = (uint8_t)parseInt(extra + 1, 0, 255);
+        ap.stepCount++;
+      }
+    } else if (strcmp(tok, "sequence") == 0) {
+      inSequence = true;
+    } else {
+      fail("unknown statement", tok);
+    }
+  }
+
+  if (!haveApproach[PLAN_APPROACH_NS] || !haveApproach[PLAN_APPROACH_EW]) {
+    fail("both approaches must be defined", nullptr);
+  }
+  if (!repeated) fail("sequence must end with repeat", nullptr);
+}
+
+int main(int argc, char** argv) {
+  const char* cName = nullptr;
+  const char* path  = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--c") == 0 && i + 1 < argc) {
+      cName = argv[++i];
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [--c NAME] file.plan\n", argv[0]);
+      return 2;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [--c NAME] file.plan\n", argv[0]);
+    return 2;
+  }
+
+  FILE* in = fopen(path, "r");
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  planFile = path;
+  PhasePlan plan;
+  compile(in, plan);
+  fclose(in);
+
+  uint8_t image[PLAN_MAX_BYTES];
+  size_t  len = planSerialize(plan, image, sizeof(image));
+  if (len == 0) {
+    fprintf(stderr, "%s: plan too large\n", path);
+    return 1;
+  }
+
+  // Same verifier the firmware runs on upload
+  PhasePlan check;
+  int err = planLoad(image, len, check);
+  if (err != PLAN_OK) {
+    fprintf(stderr, "%s: rejected: %s\n", path, planErrorName(err));
+    return 1;
+  }
+
+  if (cName) {
+    printf("// Generated by tools/plan_compiler from %s - do not edit\n", path);
+    printf("#ifndef %s_H\n#define %s_H\n\n#include <stdint.h>\n\n", cName, cName);
+    printf("const uint8_t %s[%u] = {", cName, (unsigned)len);
+    for (size_t i = 0; i < len; i++) {
+      printf("%s0x%02X%s", i % 12 == 0 ? "\n  " : "", image[i], i + 1 < len ? "," : "");
+      if (i + 1 < len && i % 12 != 11) printf(" ");
+    }
+    printf("\n};\n\n#endif\n");
+  } else {
+    printf("PLAN ");
+    for (size_t i = 0; i < len; i++) printf("%02X", image[i]);
+    printf("\n");
+  }
+  fprintf(stderr, "%s: %u bytes, %u ops\n", path, (unsigned)len, plan.opCount);
+  return 0;
+}
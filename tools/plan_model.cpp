@@ -0,0 +1,585 @@
+/****************************************************
+ * TIMING PLAN -> TLA+ MODEL EXPORT (host tool)
+ * - Reads a compiled plan ("PLAN <hex>" as printed by
+ *   tools/plan_compiler) and writes a TLA+ spec of the
+ *   phase logic plus a TLC config with its properties
+ * - Model follows main.cpp: the plan interpreter in
+ *   phaseScript(), counting only on red (isNsRed() /
+ *   isEwRed()), the ped latch, the coordination cut of
+ *   EW green, the plan switch at a cycle wrap and the
+ *   railroad preemption in railPreempt(), for up to
+ *   RailCalls trains
+ * - Each plan is modelled as weatherScalePlan() times
+ *   it for every weather level (longer yellow, all-red
+ *   after every yellow, stretched greens); the level
+ *   may change at any phase boundary, as weatherApply()
+ *   lets it. Every scaled plan must pass the plan
+ *   verifier too. --weather pins one level.
+ * - With --from, the model starts on the OLD plan and
+ *   may switch to the NEW one, so the hand-over is
+ *   checked as well
+ *
+ * Safety:   NoConflict, RedClearance, YellowFull,
+ *           AllRedFull, GreenBounded, TrackClear,
+ *           GreenThenYellow, YellowThenRed
+ * Liveness: NsServed, EwServed, PedServed,
+ *           Ns/EwVehiclesServed
+ *
+ * Build:  g++ -O2 -o plan_model tools/plan_model.cpp
+ * Usage:  plan_model [--from OLD.hex] [--weather dry|wet|ice]
+ *                    [--out DIR/Name] NEW.hex
+ *         java -cp tla2tools.jar tlc2.TLC -config Name.cfg Name.tla
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../phaseprog.h"
+#include "../rail.h"
+#include "../weather.h"
+#include "tool_io.h"
+
+const int MAX_LEVELS = 2 * PLAN_MAX_STEPS + 2;
+
+// Count thresholds at which any green length can change. Level k
+// stands for counts in [thresholds[k], thresholds[k+1]), so green
+// lengths are exact while the state space stays small.
+static int buildLevels(const PhasePlan* plans, int planCount, int* thresholds) {
+  int n = 0;
+  thresholds[n++] = 0;
+  thresholds[n++] = 1;   // "someone is waiting"
+  for (int p = 0; p < planCount; p++) {
+    for (int a = 0; a < PLAN_APPROACHES; a++) {
+      const PlanApproach& ap = plans[p].approaches[a];
+      for (int i = 0; i < ap.stepCount; i++) {
+        int c = ap.steps[i].minCount;
+        int j = n;
+        while (j > 0 && thresholds[j - 1] > c) j--;
+        if (j > 0 && thresholds[j - 1] == c) continue;
+        memmove(&thresholds[j + 1], &thresholds[j], (n - j) * sizeof(int));
+        thresholds[j] = c;
+        n++;
+      }
+    }
+  }
+  return n;
+}
+
+static void writeTuple(FILE* f, const int* v, int n) {
+  fprintf(f, "<<");
+  for (int i = 0; i < n; i++) fprintf(f, "%s%d", i ? ", " : "", v[i]);
+  fprintf(f, ">>");
+}
+
+// Tables indexed by variant (plan p under modelled weather w) list
+// V(p, w) = (p - 1) * NumWeather + w + 1 in order
+static void writeSpec(FILE* f, const char* module, const char* source,
+                      const PhasePlan* plans, int planCount,
+                      const PhasePlan* variants, const WeatherLevel* weathers,
+                      int weatherCount) {
+  static const char* OP_NAMES[] = {"", "GREEN", "YELLOW", "PED", "JUMP"};
+  const int variantCount = planCount * weatherCount;
+
+  // Scaling leaves count thresholds alone, so the plans' levels serve
+  int thresholds[MAX_LEVELS];
+  int levels = buildLevels(plans, planCount, thresholds);
+
+  fprintf(f, "---------------------------- MODULE %s ----------------------------\n", module);
+  fprintf(f, "\\* Generated by tools/plan_model from %s - do not edit.\n", source);
+  fprintf(f, "\\* One Tick is one second. Vehicle counts are kept as the policy\n");
+  fprintf(f, "\\* level they reach (count thresholds: ");
+  for (int i = 0; i < levels; i++) fprintf(f, "%s%d", i ? ", " : "", thresholds[i]);
+  fprintf(f, "),\n\\* which is exact for green lengths.\n");
+  fprintf(f, "EXTENDS Integers, Sequences\n\n");
+  fprintf(f, "CONSTANT CoordCut   \\* EW green may be cut after base green\n");
+  fprintf(f, "CONSTANT RailCalls  \\* trains (preemption calls) per behaviour\n\n");
+  fprintf(f, "NumPlans == %d\n\n", planCount);
+
+  fprintf(f, "\\* Weather levels modelled (weatherScalePlan()):");
+  for (int w = 0; w < weatherCount; w++) {
+    fprintf(f, " %d = %s%s", w, WEATHER_PROFILES[weathers[w]].name,
+            w + 1 < weatherCount ? "," : "\n");
+  }
+  fprintf(f, "NumWeather == %d\nWeathers   == 0..NumWeather - 1\n", weatherCount);
+  fprintf(f, "V(p, wl)   == (p - 1) * NumWeather + wl + 1\n\n");
+
+  // Ops without the closing JUMP; the JUMP target becomes Loop
+  fprintf(f, "\\* Per plan: ops as <<code, approach>> (approach 0 = NS, 1 = EW)\n");
+  fprintf(f, "OpsTab == <<\n");
+  for (int p = 0; p < planCount; p++) {
+    fprintf(f, "  << ");
+    for (int i = 0; i < plans[p].opCount - 1; i++) {
+      fprintf(f, "%s<<\"%s\", %d>>", i ? ", " : "", OP_NAMES[plans[p].ops[i].code],
+              plans[p].ops[i].arg);
+    }
+    fprintf(f, " >>%s\n", p + 1 < planCount ? "," : "");
+  }
+  fprintf(f, ">>\n");
+
+  int v[PLAN_MAX_OPS];
+  for (int p = 0; p < planCount; p++) v[p] = planLoopStart(plans[p]) + 1;
+  fprintf(f, "Loop      == ");
+  writeTuple(f, v, planCount);
+  // Walk plus the STOP hold, rounded up to whole seconds
+  for (int p = 0; p < planCount; p++) v[p] = plans[p].pedSec + (plans[p].pedStopDs + 9) / 10;
+  fprintf(f, "\nWalkSec   == ");
+  writeTuple(f, v, planCount);
+  fprintf(f, "\n\n");
+
+  fprintf(f, "\\* Per variant V(p, wl)\n");
+  for (int i = 0; i < variantCount; i++) v[i] = variants[i].yellowSec;
+  fprintf(f, "YellowSec   == ");
+  writeTuple(f, v, variantCount);
+  for (int i = 0; i < variantCount; i++) v[i] = variants[i].allRedSec;
+  fprintf(f, "\nAllRedSec   == ");
+  writeTuple(f, v, variantCount);
+  for (int i = 0; i < variantCount; i++) v[i] = railEntryRedSec(variants[i]);
+  fprintf(f, "\nEntryRedSec == ");
+  writeTuple(f, v, variantCount);
+
+  fprintf(f, "\nBaseSec     == << ");
+  for (int i = 0; i < variantCount; i++) {
+    for (int a = 0; a < PLAN_APPROACHES; a++) v[a] = variants[i].approaches[a].baseSec;
+    fprintf(f, "%s", i ? ", " : "");
+    writeTuple(f, v, PLAN_APPROACHES);
+  }
+  fprintf(f, " >>\n\n");
+
+  fprintf(f, "MaxLevel == %d\nLevels   == 0..MaxLevel\n\n", levels - 1);
+
+  fprintf(f, "\\* railPreempt() timing (rail.h)\n");
+  fprintf(f, "Track     == %d\nDwell     == 1 - Track\n", RAIL_TRACK_APPROACH);
+  fprintf(f, "TrackSec  == %d\nMinDwell  == %d\n\n", RAIL_TRACK_CLEAR_SEC, RAIL_MIN_DWELL_SEC);
+  fprintf(f, "\\* GreenTab[V(p, wl)][approach + 1][level + 1] = green seconds "
+             "(planGreenSeconds)\n");
+  fprintf(f, "GreenTab == <<\n");
+  for (int i = 0; i < variantCount; i++) {
+    fprintf(f, "  << ");
+    for (int a = 0; a < PLAN_APPROACHES; a++) {
+      for (int k = 0; k < levels; k++) v[k] = planGreenSeconds(variants[i], a, thresholds[k]);
+      fprintf(f, "%s", a ? ", " : "");
+      writeTuple(f, v, levels);
+    }
+    fprintf(f, " >>%s\n", i + 1 < variantCount ? "," : "");
+  }
+  fprintf(f, ">>\n\n");
+
+  // Where a plan starts, by approach whose yellow just ended: the new
+  // plan at the switch, either plan after a preemption
+  fprintf(f, "\\* SwitchTab[plan][lastYellow + 2] = planSwitchStart() + 1\n");
+  fprintf(f, "SwitchTab == << ");
+  for (int p = 0; p < planCount; p++) {
+    for (int ly = -1; ly < PLAN_APPROACHES; ly++) v[ly + 1] = planSwitchStart(plans[p], ly) + 1;
+    fprintf(f, "%s", p ? ", " : "");
+    writeTuple(f, v, PLAN_APPROACHES + 1);
+  }
+  fprintf(f, " >>\n");
+  for (int p = 0; p < planCount; p++) v[p] = (plans[p].pedStopDs + 9) / 10;
+  fprintf(f, "StopSec   == ");
+  writeTuple(f, v, planCount);
+  fprintf(f, "\n\n");
+
+  fputs(
+    "Ops(p) == OpsTab[p]\n"
+    "GreenSec(v, a, lv) == GreenTab[v][a + 1][lv + 1]\n"
+    "\n"
+    "VARIABLES plan, wx, pc, ar, t, dur, level, pedReq, walking, pending, lastYellow,\n"
+    "          rail, ry, rt, call, calls\n"
+    "railVars == <<rail, ry, rt, call, calls>>\n"
+    "vars == <<plan, wx, pc, ar, t, dur, level, pedReq, walking, pending, lastYellow,\n"
+    "          railVars>>\n"
+    "\n"
+    "\\* Timing in force: the plan as scaled for the weather level applied (wx)\n"
+    "Cur == V(plan, wx)\n"
+    "\n"
+    "\\* ar: the all-red after the yellow at pc is showing\n"
+    "Op == Ops(plan)[pc]\n"
+    "IsGreen(a)  == Op[1] = \"GREEN\"  /\\ Op[2] = a\n"
+    "IsYellow(a) == Op[1] = \"YELLOW\" /\\ Op[2] = a /\\ ~ar\n"
+    "\n"
+    "RailStates == {\"idle\", \"entry\", \"red\", \"track\", \"trackY\", \"trackR\", \"hold\",\n"
+    "               \"exit\", \"exitR\"}\n"
+    "\n"
+    "\\* railPreempt(): entry (yellow ry runs out), red (entry red clearance),\n"
+    "\\* track (track clearance green), trackY, hold (dwell green), exit (dwell\n"
+    "\\* yellow); trackR and exitR are the all-reds after the last two\n"
+    "RailLight(a) ==\n"
+    "  CASE rail = \"entry\"  -> IF a = ry THEN \"yellow\" ELSE \"red\"\n"
+    "    [] rail = \"track\"  -> IF a = Track THEN \"green\" ELSE \"red\"\n"
+    "    [] rail = \"trackY\" -> IF a = Track THEN \"yellow\" ELSE \"red\"\n"
+    "    [] rail = \"hold\"   -> IF a = Dwell THEN \"green\" ELSE \"red\"\n"
+    "    [] rail = \"exit\"   -> IF a = Dwell THEN \"yellow\" ELSE \"red\"\n"
+    "    [] OTHER           -> \"red\"\n"
+    "\n"
+    "PlanLight(a) == IF IsGreen(a) THEN \"green\"\n"
+    "                ELSE IF IsYellow(a) THEN \"yellow\" ELSE \"red\"\n"
+    "Light(a) == IF rail = \"idle\" THEN PlanLight(a) ELSE RailLight(a)\n"
+    "PedLight == IF rail = \"idle\" /\\ Op[1] = \"PED\" /\\ walking THEN \"green\" ELSE \"red\"\n"
+    "\n"
+    "\\* Length of op i of plan p under weather wl when entered (a PED op\n"
+    "\\* without a request is skipped)\n"
+    "Duration(p, wl, i, lv, ped) ==\n"
+    "  LET o == Ops(p)[i] IN\n"
+    "  CASE o[1] = \"GREEN\"  -> GreenSec(V(p, wl), o[2], lv[o[2]])\n"
+    "    [] o[1] = \"YELLOW\" -> YellowSec[V(p, wl)]\n"
+    "    [] OTHER           -> IF ped THEN WalkSec[p] ELSE 0\n"
+    "\n"
+    "Init == /\\ plan = 1\n"
+    "        /\\ wx \\in Weathers\n"
+    "        /\\ pc = 1\n"
+    "        /\\ ar = FALSE\n"
+    "        /\\ level = [a \\in {0, 1} |-> 0]\n"
+    "        /\\ pedReq = FALSE\n"
+    "        /\\ walking = FALSE\n"
+    "        /\\ pending = FALSE\n"
+    "        /\\ lastYellow = -1\n"
+    "        /\\ dur = Duration(1, wx, 1, [a \\in {0, 1} |-> 0], FALSE)\n"
+    "        /\\ t = dur\n"
+    "        /\\ rail = \"idle\"\n"
+    "        /\\ ry = -1\n"
+    "        /\\ rt = 0\n"
+    "        /\\ call = FALSE\n"
+    "        /\\ calls = 0\n"
+    "\n"
+    "\\* One countdown second\n"
+    "Tick == /\\ rail = \"idle\"\n"
+    "        /\\ t > 0\n"
+    "        /\\ t' = t - 1\n"
+    "        /\\ UNCHANGED <<plan, wx, pc, ar, dur, level, pedReq, walking, pending, lastYellow,\n"
+    "                       railVars>>\n"
+    "\n"
+    "\\* coordShouldEndEwGreen(): EW green ends early once past base green\n"
+    "Cut == /\\ CoordCut\n"
+    "       /\\ rail = \"idle\"\n"
+    "       /\\ IsGreen(1)\n"
+    "       /\\ t > 0\n"
+    "       /\\ dur - t >= BaseSec[Cur][2]\n"
+    "       /\\ t' = 0\n"
+    "       /\\ UNCHANGED <<plan, wx, pc, ar, dur, level, pedReq, walking, pending, lastYellow,\n"
+    "                      railVars>>\n"
+    "\n"
+    "\\* Vehicle counted: only while that approach is red\n"
+    "Arrive(a) == /\\ Light(a) = \"red\"\n"
+    "             /\\ level[a] < MaxLevel\n"
+    "             /\\ level' = [level EXCEPT ![a] = @ + 1]\n"
+    "             /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, pedReq, walking, pending, lastYellow,\n"
+    "                            railVars>>\n"
+    "\n"
+    "\\* Ped button latches a request\n"
+    "Press == /\\ ~pedReq\n"
+    "         /\\ pedReq' = TRUE\n"
+    "         /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, level, walking, pending, lastYellow,\n"
+    "                        railVars>>\n"
+    "\n"
+    "\\* \"PLAN <hex>\" accepted: the new plan waits for the cycle wrap\n"
+    "Upload == /\\ NumPlans = 2\n"
+    "          /\\ plan = 1\n"
+    "          /\\ ~pending\n"
+    "          /\\ pending' = TRUE\n"
+    "          /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, level, pedReq, walking, lastYellow,\n"
+    "                         railVars>>\n"
+    "\n"
+    "\\* Interval over. After a yellow, phaseAllRed() when the weather has one\n"
+    "\\* (same op, same timing); otherwise the effects of the op just finished,\n"
+    "\\* then weatherApply() may change the level before the next op.\n"
+    "Advance ==\n"
+    "  /\\ rail = \"idle\"\n"
+    "  /\\ t = 0\n"
+    "  /\\ IF Op[1] = \"YELLOW\" /\\ ~ar /\\ AllRedSec[Cur] > 0\n"
+    "       THEN /\\ ar' = TRUE\n"
+    "            /\\ dur' = AllRedSec[Cur]\n"
+    "            /\\ t' = dur'\n"
+    "            /\\ UNCHANGED <<plan, wx, pc, level, pedReq, walking, pending, lastYellow,\n"
+    "                           railVars>>\n"
+    "       ELSE LET lv2  == IF Op[1] = \"GREEN\" THEN [level EXCEPT ![Op[2]] = 0] ELSE level\n"
+    "                ly2  == CASE Op[1] = \"GREEN\"  -> -1\n"
+    "                          [] Op[1] = \"YELLOW\" -> Op[2]\n"
+    "                          [] OTHER            -> lastYellow\n"
+    "                ped2 == IF Op[1] = \"PED\" /\\ walking THEN FALSE ELSE pedReq\n"
+    "                wrap == pc = Len(Ops(plan))\n"
+    "                sw   == wrap /\\ pending\n"
+    "                p2   == IF sw THEN 2 ELSE plan\n"
+    "                pc2  == CASE sw    -> SwitchTab[2][ly2 + 2]\n"
+    "                          [] wrap  -> Loop[plan]\n"
+    "                          [] OTHER -> pc + 1\n"
+    "            IN /\\ plan' = p2\n"
+    "               /\\ wx' \\in Weathers\n"
+    "               /\\ pc' = pc2\n"
+    "               /\\ ar' = FALSE\n"
+    "               /\\ level' = lv2\n"
+    "               /\\ lastYellow' = ly2\n"
+    "               /\\ pedReq' = ped2\n"
+    "               /\\ pending' = (pending /\\ ~sw)\n"
+    "               /\\ walking' = (Ops(p2)[pc2][1] = \"PED\" /\\ ped2)\n"
+    "               /\\ dur' = Duration(p2, wx', pc2, lv2, ped2)\n"
+    "               /\\ t' = dur'\n"
+    "               /\\ UNCHANGED railVars\n"
+    "\n"
+    "\\* Crossing call begins. From idle, railPreemptStart() on the same scan: the\n"
+    "\\* plan is frozen, a dwell green is served and turns yellow, a yellow or an\n"
+    "\\* all-red runs out, WALK goes to its STOP (which clears like a red), a\n"
+    "\\* track green goes on.\n"
+    "CallOn ==\n"
+    "  /\\ ~call\n"
+    "  /\\ calls < RailCalls\n"
+    "  /\\ call' = TRUE\n"
+    "  /\\ calls' = calls + 1\n"
+    "  /\\ IF rail /= \"idle\"\n"
+    "       THEN UNCHANGED <<plan, wx, pc, ar, t, dur, level, pedReq, walking, pending,\n"
+    "                        lastYellow, rail, ry, rt>>\n"
+    "       ELSE /\\ CASE IsGreen(Track)   -> (rail' = \"track\" /\\ rt' = TrackSec /\\ ry' = -1)\n"
+    "                 [] IsGreen(Dwell)   -> (/\\ rail' = \"entry\"\n"
+    "                                         /\\ rt' = YellowSec[Cur]\n"
+    "                                         /\\ ry' = Dwell)\n"
+    "                 [] (Op[1] = \"YELLOW\" /\\ ~ar) ->\n"
+    "                                        (rail' = \"entry\" /\\ rt' = t /\\ ry' = Op[2])\n"
+    "                 [] (Op[1] = \"YELLOW\" /\\ ar) ->\n"
+    "                                        (rail' = \"entry\" /\\ rt' = t /\\ ry' = -1)\n"
+    "                 [] OTHER            -> (/\\ rail' = \"entry\"\n"
+    "                                         /\\ rt' = (IF walking THEN StopSec[plan] ELSE 0)\n"
+    "                                         /\\ ry' = (IF walking THEN -1 ELSE lastYellow))\n"
+    "            /\\ level' = IF IsGreen(Dwell) THEN [level EXCEPT ![Dwell] = 0] ELSE level\n"
+    "            /\\ walking' = FALSE\n"
+    "            /\\ ar' = FALSE\n"
+    "            /\\ UNCHANGED <<plan, wx, pc, t, dur, pedReq, pending, lastYellow>>\n"
+    "\n"
+    "CallOff == /\\ call\n"
+    "           /\\ call' = FALSE\n"
+    "           /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, level, pedReq, walking, pending,\n"
+    "                          lastYellow, rail, ry, rt, calls>>\n"
+    "\n"
+    "\\* One countdown second of a rail interval\n"
+    "RailTick == /\\ rail /= \"idle\"\n"
+    "            /\\ rt > 0\n"
+    "            /\\ rt' = rt - 1\n"
+    "            /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, level, pedReq, walking, pending,\n"
+    "                           lastYellow, rail, ry, call, calls>>\n"
+    "\n"
+    "\\* endGreen() of a rail green clears that approach's queue (lv)\n"
+    "RailTo(r, sec, ly, lv) == /\\ rail' = r\n"
+    "                          /\\ rt' = sec\n"
+    "                          /\\ lastYellow' = ly\n"
+    "                          /\\ level' = lv\n"
+    "                          /\\ UNCHANGED <<plan, wx, pc, ar, t, dur, pedReq, walking,\n"
+    "                                         pending, ry, call, calls>>\n"
+    "\n"
+    "\\* Preemption over: the plan resumes where planSwitchStart() puts it after\n"
+    "\\* the dwell yellow, on the pending plan if one was uploaded, under the\n"
+    "\\* weather level weatherApply() finds then\n"
+    "RailEnd ==\n"
+    "  LET p2  == IF pending THEN 2 ELSE plan\n"
+    "      pc2 == SwitchTab[p2][Dwell + 2]\n"
+    "  IN /\\ rail' = \"idle\"\n"
+    "     /\\ ry' = -1\n"
+    "     /\\ plan' = p2\n"
+    "     /\\ wx' \\in Weathers\n"
+    "     /\\ pc' = pc2\n"
+    "     /\\ pending' = FALSE\n"
+    "     /\\ lastYellow' = Dwell\n"
+    "     /\\ walking' = (Ops(p2)[pc2][1] = \"PED\" /\\ pedReq)\n"
+    "     /\\ dur' = Duration(p2, wx', pc2, level, pedReq)\n"
+    "     /\\ t' = dur'\n"
+    "     /\\ UNCHANGED <<ar, level, pedReq, rt, call, calls>>\n"
+    "\n"
+    "\\* Rail interval over; the hold lasts while the call does, and a call\n"
+    "\\* back during the exit yellow or all-red clears the tracks again. The\n"
+    "\\* timing is the level in force when the preemption began.\n"
+    "RailAdvance ==\n"
+    "  /\\ rail /= \"idle\"\n"
+    "  /\\ rt = 0\n"
+    "  /\\ rail = \"hold\" => ~call\n"
+    "  /\\ LET served(a) == [level EXCEPT ![a] = 0]\n"
+    "         ys        == YellowSec[Cur]\n"
+    "         rs        == AllRedSec[Cur]\n"
+    "         exitDone  == (rail = \"exit\" /\\ rs = 0) \\/ rail = \"exitR\"\n"
+    "     IN CASE rail = \"entry\" /\\ ry = -1  -> RailTo(\"track\", TrackSec, -1, level)\n"
+    "          [] rail = \"entry\" /\\ ry /= -1 -> RailTo(\"red\", EntryRedSec[Cur], ry, level)\n"
+    "          [] rail = \"red\"               -> RailTo(\"track\", TrackSec, -1, level)\n"
+    "          [] rail = \"track\"             -> RailTo(\"trackY\", ys, -1, served(Track))\n"
+    "          [] rail = \"trackY\" /\\ rs > 0  -> RailTo(\"trackR\", rs, Track, level)\n"
+    "          [] rail = \"trackY\" /\\ rs = 0  -> RailTo(\"hold\", MinDwell, Track, level)\n"
+    "          [] rail = \"trackR\"            -> RailTo(\"hold\", MinDwell, Track, level)\n"
+    "          [] rail = \"hold\"              -> RailTo(\"exit\", ys, -1, served(Dwell))\n"
+    "          [] rail = \"exit\" /\\ rs > 0    -> RailTo(\"exitR\", rs, Dwell, level)\n"
+    "          [] exitDone /\\ call           -> RailTo(\"track\", TrackSec, Dwell, level)\n"
+    "          [] exitDone /\\ ~call          -> RailEnd\n"
+    "\n"
+    "Next == \\/ Tick \\/ Advance \\/ Cut \\/ Press \\/ Upload \\/ \\E a \\in {0, 1} : Arrive(a)\n"
+    "        \\/ CallOn \\/ CallOff \\/ RailTick \\/ RailAdvance\n"
+    "\n"
+    "Spec == /\\ Init /\\ [][Next]_vars\n"
+    "        /\\ WF_vars(Tick) /\\ WF_vars(Advance)\n"
+    "        /\\ WF_vars(RailTick) /\\ WF_vars(RailAdvance) /\\ WF_vars(CallOff)\n"
+    "\n"
+    "-----------------------------------------------------------------------------\n"
+    "\n"
+    "TypeOK == /\\ plan \\in 1..NumPlans\n"
+    "          /\\ wx \\in Weathers\n"
+    "          /\\ pc \\in 1..Len(Ops(plan))\n"
+    "          /\\ ar \\in BOOLEAN\n"
+    "          /\\ ar => Op[1] = \"YELLOW\"\n"
+    "          /\\ dur \\in 0..63\n"
+    "          /\\ t \\in 0..dur\n"
+    "          /\\ level \\in [{0, 1} -> Levels]\n"
+    "          /\\ pedReq \\in BOOLEAN\n"
+    "          /\\ walking \\in BOOLEAN\n"
+    "          /\\ pending \\in BOOLEAN\n"
+    "          /\\ lastYellow \\in {-1, 0, 1}\n"
+    "          /\\ rail \\in RailStates\n"
+    "          /\\ ry \\in {-1, 0, 1}\n"
+    "          /\\ rt \\in 0..63\n"
+    "          /\\ call \\in BOOLEAN\n"
+    "          /\\ calls \\in 0..RailCalls\n"
+    "\n"
+    "\\* Never two movements released at once\n"
+    "NoConflict == /\\ Light(0) = \"red\" \\/ Light(1) = \"red\"\n"
+    "              /\\ PedLight = \"green\" => Light(0) = \"red\" /\\ Light(1) = \"red\"\n"
+    "\n"
+    "\\* An approach never goes green straight after its own yellow\n"
+    "RedClearance == \\A a \\in {0, 1} : Light(a) = \"green\" => lastYellow /= a\n"
+    "\n"
+    "\\* Yellow runs the full time of the weather level in force, at least 3 s\n"
+    "YellowFull == \\A a \\in {0, 1} :\n"
+    "                rail = \"idle\" /\\ IsYellow(a) => dur = YellowSec[Cur] /\\ dur >= 3\n"
+    "\n"
+    "\\* The all-red after a yellow runs its full time\n"
+    "AllRedFull == rail = \"idle\" /\\ ar => dur = AllRedSec[Cur] /\\ dur > 0\n"
+    "\n"
+    "\\* Greens start at no less than base green\n"
+    "GreenBounded == \\A a \\in {0, 1} :\n"
+    "                  rail = \"idle\" /\\ IsGreen(a) => dur >= BaseSec[Cur][a + 1]\n"
+    "\n"
+    "\\* Until the track clearance ends, only the track approach may go green\n"
+    "TrackClear == rail \\in {\"entry\", \"red\", \"track\", \"trackY\", \"trackR\"} =>\n"
+    "                Light(Dwell) /= \"green\"\n"
+    "\n"
+    "GreenThenYellow(a) == [][Light(a) = \"green\" /\\ Light(a)' /= \"green\" => Light(a)' = \"yellow\"]_vars\n"
+    "YellowThenRed(a)   == [][Light(a) = \"yellow\" /\\ Light(a)' /= \"yellow\" => Light(a)' = \"red\"]_vars\n"
+    "NsGreenThenYellow  == GreenThenYellow(0)\n"
+    "EwGreenThenYellow  == GreenThenYellow(1)\n"
+    "NsYellowThenRed    == YellowThenRed(0)\n"
+    "EwYellowThenRed    == YellowThenRed(1)\n"
+    "\n"
+    "\\* No starvation\n"
+    "NsServed       == []<>(Light(0) = \"green\")\n"
+    "EwServed       == []<>(Light(1) = \"green\")\n"
+    "PedServed      == pedReq ~> (PedLight = \"green\")\n"
+    "VehiclesServed(a) == (level[a] > 0) ~> (Light(a) = \"green\")\n"
+    "NsVehiclesServed  == VehiclesServed(0)\n"
+    "EwVehiclesServed  == VehiclesServed(1)\n"
+    "\n"
+    "=============================================================================\n",
+    f);
+}
+
+// weatherScalePlan() of each plan for each modelled level, put back
+// through planLoad() so a scaled plan the firmware could never have
+// loaded is rejected rather than modelled
+static bool scaleVariants(const PhasePlan* plans, const char* const* paths, int planCount,
+                          const WeatherLevel* weathers, int weatherCount, PhasePlan* variants) {
+  for (int p = 0; p < planCount; p++) {
+    for (int w = 0; w < weatherCount; w++) {
+      PhasePlan& scaled = variants[p * weatherCount + w];
+      weatherScalePlan(plans[p], weathers[w], scaled);
+
+      uint8_t   image[PLAN_MAX_BYTES];
+      PhasePlan check;
+      size_t    len = planSerialize(scaled, image, sizeof(image));
+      int       err = len ? planLoad(image, len, check) : PLAN_ERR_LENGTH;
+      if (err != PLAN_OK) {
+        fprintf(stderr, "%s: %s timing rejected: %s\n", paths[p],
+                WEATHER_PROFILES[weathers[w]].name, planErrorName(err));
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void writeConfig(FILE* f) {
+  fputs(
+    "SPECIFICATION Spec\n"
+    "CONSTANT CoordCut = TRUE\n"
+    "CONSTANT RailCalls = 2\n"
+    "INVARIANT TypeOK NoConflict RedClearance YellowFull AllRedFull GreenBounded\n"
+    "INVARIANT TrackClear\n"
+    "PROPERTY NsGreenThenYellow EwGreenThenYellow NsYellowThenRed EwYellowThenRed\n"
+    "PROPERTY NsServed EwServed PedServed NsVehiclesServed EwVehiclesServed\n",
+    f);
+}
+
+int main(int argc, char** argv) {
+  const char* fromPath = nullptr;
+  const char* newPath  = nullptr;
+  const char* out      = "TrafficPlan";
+  const char* weather  = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+      fromPath = argv[++i];
+    } else if (strcmp(argv[i], "--weather") == 0 && i + 1 < argc) {
+      weather = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    } else if (!newPath && argv[i][0] != '-') {
+      newPath = argv[i];
+    } else {
+      newPath = nullptr;
+      break;
+    }
+  }
+  // Every level unless --weather names one
+  WeatherLevel weathers[WEATHER_LEVELS];
+  int weatherCount = 0;
+  for (int w = 0; w < WEATHER_LEVELS; w++) {
+    if (!weather || strcmp(weather, WEATHER_PROFILES[w].name) == 0) {
+      weathers[weatherCount++] = (WeatherLevel)w;
+    }
+  }
+  if (!newPath || weatherCount == 0) {
+    fprintf(stderr,
+            "usage: %s [--from OLD.hex] [--weather dry|wet|ice] [--out DIR/Name] NEW.hex\n",
+            argv[0]);
+    return 2;
+  }
+
+  PhasePlan   plans[2];
+  const char* paths[2];
+  int planCount = 0;
+  if (fromPath) {
+    paths[planCount] = fromPath;
+    if (!readPlanFile(fromPath, plans[planCount++])) return 1;
+  }
+  paths[planCount] = newPath;
+  if (!readPlanFile(newPath, plans[planCount++])) return 1;
+
+  PhasePlan variants[2 * WEATHER_LEVELS];
+  if (!scaleVariants(plans, paths, planCount, weathers, weatherCount, variants)) return 1;
+
+  // TLA+ wants the module name to match the file name
+  const char* module = strrchr(out, '/');
+  module = module ? module + 1 : out;
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s.tla", out);
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  writeSpec(f, module, newPath, plans, planCount, variants, weathers, weatherCount);
+  fclose(f);
+
+  snprintf(path, sizeof(path), "%s.cfg", out);
+  f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  writeConfig(f);
+  fclose(f);
+
+  fprintf(stderr, "wrote %s.tla / %s.cfg (%d plan%s, %d weather level%s)\n", out, out,
+          planCount, planCount > 1 ? "s" : "", weatherCount, weatherCount > 1 ? "s" : "");
+  return 0;
+}
@@ -0,0 +1,263 @@
+/****************************************************
+ * MONTE CARLO POLICY EVALUATION (host tool)
+ * - Compares two timing plans (green-time thresholds,
+ *   phase order, ...) on the batch simulator
+ *   (tools/batch_sim.h): every replication is one lane,
+ *   run under both plans with the same random arrivals
+ *   (common random numbers), so the paired difference
+ *   has a much tighter interval than either mean
+ * - Replications run in rounds, one batch per thread;
+ *   after each round the B - A interval of the primary
+ *   metric (delay) is checked and the run stops once it
+ *   excludes zero. Each look uses alpha / rounds
+ *   (Bonferroni), so stopping early does not inflate
+ *   the error rate. With --tol it also stops once the
+ *   interval is narrower than +/- tol s/veh (any real
+ *   difference is too small to matter)
+ * - Metrics per replication: mean delay (s/veh),
+ *   throughput (veh/h) and pedestrian wait (ped-s/h)
+ *
+ * Build:  g++ -O3 -march=native -pthread -o policy_eval tools/policy_eval.cpp
+ * Usage:  policy_eval [--a FILE] [--b FILE] [--ns P[:P2]] [--ew P[:P2]]
+ *                     [--ped P[:P2]] [--seconds S] [--warmup S]
+ *                     [--lanes N] [--rounds N] [--jobs N]
+ *                     [--alpha A] [--tol S] [--seed N]
+ *   FILE holds "PLAN <hex>" from tools/plan_compiler;
+ *   a missing plan is the built-in default. Demand is
+ *   spread evenly over each range across the lanes.
+ ****************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "batch_sim.h"
+#include "tool_io.h"
+#include "../default_plan.h"
+
+const int METRIC_DELAY      = 0;   // primary: decides early stopping
+const int METRIC_THROUGHPUT = 1;
+const int METRIC_PED_WAIT   = 2;
+const int METRICS           = 3;
+
+static const char* METRIC_NAMES[METRICS] = {"delay s/veh", "throughput veh/h", "ped wait s/h"};
+static const bool  LOWER_IS_BETTER[METRICS] = {true, false, true};
+
+struct Range {
+  double lo, hi;
+};
+
+struct Config {
+  PhasePlan plans[2];
+  Range     ns, ew, ped;
+  long      seconds, warmup;
+  int       lanes;
+  uint32_t  seed;
+};
+
+// Running mean / variance (Welford)
+struct Stat {
+  double n, mean, m2;
+};
+
+static void statAdd(Stat& s, double x) {
+  s.n++;
+  double d = x - s.mean;
+  s.mean += d / s.n;
+  s.m2   += d * (x - s.mean);
+}
+
+static double statHalfWidth(const Stat& s, double z) {
+  return s.n > 1 ? z * sqrt(s.m2 / (s.n - 1) / s.n) : INFINITY;
+}
+
+// Two-sided normal quantile: P(|Z| > z) = alpha
+static double zForAlpha(double alpha) {
+  double lo = 0, hi = 10;
+  for (int i = 0; i < 100; i++) {
+    double mid = (lo + hi) / 2;
+    if (erfc(mid / sqrt(2.0)) > alpha) lo = mid;
+    else                               hi = mid;
+  }
+  return (lo + hi) / 2;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [--a FILE] [--b FILE] [--ns P[:P2]] [--ew P[:P2]] [--ped P[:P2]]\n"
+          "          [--seconds S] [--warmup S] [--lanes N] [--rounds N] [--jobs N]\n"
+          "          [--alpha A] [--tol S] [--seed N]\n",
+          prog);
+  exit(2);
+}
+
+static Range parseRange(const char* s) {
+  Range r;
+  if (sscanf(s, "%lf:%lf", &r.lo, &r.hi) != 2) r.hi = r.lo = atof(s);
+  return r;
+}
+
+static double rangeAt(const Range& r, int lane, int lanes) {
+  return lanes > 1 ? r.lo + (r.hi - r.lo) * lane / (lanes - 1) : r.lo;
+}
+
+// One batch: every lane under plan A and plan B, same seeds and demand.
+// out[(lane * 2 + plan) * METRICS + metric]
+static bool runBatch(const Config& c, uint32_t seed, double* out) {
+  for (int p = 0; p < 2; p++) {
+    BatchSim s;
+    if (!batchInit(s, c.lanes, c.plans[p], seed)) return false;
+    for (int l = 0; l < c.lanes; l++) {
+      batchSetDemand(s, l, rangeAt(c.ns, l, c.lanes), rangeAt(c.ew, l, c.lanes),
+                     rangeAt(c.ped, l, c.lanes));
+    }
+    if (c.warmup > 0) {
+      batchRun(s, (uint64_t)c.warmup);
+      batchResetTotals(s);
+    }
+    batchRun(s, (uint64_t)c.seconds);
+
+    for (int l = 0; l < c.lanes; l++) {
+      const BatchTotals& t = s.totals[l];
+      uint64_t departed = t.departNs + t.departEw;
+      double*  m        = out + ((size_t)l * 2 + p) * METRICS;
+      m[METRIC_DELAY]      = departed ? (double)(t.delayNs + t.delayEw) / departed : 0.0;
+      m[METRIC_THROUGHPUT] = departed * 3600.0 / t.seconds;
+      m[METRIC_PED_WAIT]   = t.pedDelay * 3600.0 / t.seconds;
+    }
+    batchFree(s);
+  }
+  return true;
+}
+
+static bool loadPlan(const char* path, PhasePlan& plan) {
+  if (path) return readPlanFile(path, plan);
+  return planLoad(DEFAULT_PLAN, sizeof(DEFAULT_PLAN), plan) == PLAN_OK;
+}
+
+int main(int argc, char** argv) {
+  const char* paths[2] = {nullptr, nullptr};
+  Config      c;
+  c.ns      = {0.10, 0.10};
+  c.ew      = {0.10, 0.10};
+  c.ped     = {0.01, 0.01};
+  c.seconds = 3600;
+  c.warmup  = 600;
+  c.lanes   = 1024;
+  c.seed    = 1;
+  int    rounds = 16;
+  int    jobs   = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  double alpha  = 0.05;
+  double tol    = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--a") == 0 && i + 1 < argc) {
+      paths[0] = argv[++i];
+    } else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc) {
+      paths[1] = argv[++i];
+    } else if (strcmp(argv[i], "--ns") == 0 && i + 1 < argc) {
+      c.ns = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--ew") == 0 && i + 1 < argc) {
+      c.ew = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--ped") == 0 && i + 1 < argc) {
+      c.ped = parseRange(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      c.seconds = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+      c.warmup = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+      c.lanes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+      alpha = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--tol") == 0 && i + 1 < argc) {
+      tol = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      c.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (c.seconds < 1 || c.warmup < 0 || c.lanes < 2 || rounds < 1 || jobs < 1 || alpha <= 0 ||
+      alpha >= 1) {
+    usage(argv[0]);
+  }
+  c.lanes = (c.lanes + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+  for (int p = 0; p < 2; p++) {
+    if (!loadPlan(paths[p], c.plans[p])) return 1;
+  }
+
+  double z     = zForAlpha(alpha / rounds);   // per look
+  double zEach = zForAlpha(alpha);            // per-policy intervals, reported only
+  Stat   perPlan[2][METRICS] = {};
+  Stat   diff[METRICS]       = {};
+
+  size_t              perBatch = (size_t)c.lanes * 2 * METRICS;
+  std::vector<double> results(perBatch * jobs);
+  int                 round = 0;
+  bool                separated = false, settled = false;
+
+  while (round < rounds && !separated && !settled) {
+    std::vector<std::thread> threads;
+    std::vector<char>        ok(jobs, 0);
+    for (int j = 0; j < jobs; j++) {
+      uint32_t seed = c.seed + (uint32_t)((round * jobs + j) * c.lanes);
+      threads.emplace_back([&, j, seed] { ok[j] = runBatch(c, seed, &results[perBatch * j]); });
+    }
+    for (std::thread& t : threads) t.join();
+    round++;
+
+    for (int j = 0; j < jobs; j++) {
+      if (!ok[j]) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+      }
+      for (int l = 0; l < c.lanes; l++) {
+        const double* a = &results[perBatch * j + (size_t)l * 2 * METRICS];
+        const double* b = a + METRICS;
+        for (int m = 0; m < METRICS; m++) {
+          statAdd(perPlan[0][m], a[m]);
+          statAdd(perPlan[1][m], b[m]);
+          statAdd(diff[m], b[m] - a[m]);
+        }
+      }
+    }
+
+    const Stat& d = diff[METRIC_DELAY];
+    double      h = statHalfWidth(d, z);
+    separated     = d.mean - h > 0 || d.mean + h < 0;
+    settled       = !separated && h < tol;
+    fprintf(stderr, "round %d: %.0f replications, delay B-A %+.3f +/- %.3f\n", round, d.n,
+            d.mean, h);
+  }
+
+  printf("A: %s\nB: %s\n", paths[0] ? paths[0] : "built-in plan",
+         paths[1] ? paths[1] : "built-in plan");
+  printf("%.0f paired replications x %lds (after %lds warm-up), %d of %d rounds\n",
+         diff[0].n, c.seconds, c.warmup, round, rounds);
+  printf("%-18s %20s %20s %22s\n", "metric", "A", "B", "B - A");
+  for (int m = 0; m < METRICS; m++) {
+    const Stat& d = diff[m];
+    double      h = statHalfWidth(d, z);
+    const char* verdict = "no difference shown";
+    if (d.mean - h > 0 || d.mean + h < 0) {
+      verdict = (d.mean < 0) == LOWER_IS_BETTER[m] ? "B better" : "A better";
+    }
+    printf("%-18s %11.3f +/- %-6.3f %11.3f +/- %-6.3f %+11.3f +/- %-7.3f %s\n",
+           METRIC_NAMES[m], perPlan[0][m].mean, statHalfWidth(perPlan[0][m], zEach),
+           perPlan[1][m].mean, statHalfWidth(perPlan[1][m], zEach), d.mean, h, verdict);
+  }
+  printf("%s at %.0f%% (%.2f%% per look)\n",
+         separated ? "delay intervals separate"
+                   : settled ? "delay difference within tolerance" : "delay intervals still overlap",
+         100 * (1 - alpha), 100 * (1 - alpha / rounds));
+  return 0;
+}
@@ -0,0 +1,149 @@
+/****************************************************
+ * PROFILE SAMPLES -> FUNCTION HISTOGRAM (host tool)
+ * - Reads controller serial output on stdin and picks
+ *   up the "PF <hex> ..." dump lines (see profiler.h)
+ * - Resolves each distinct PC with addr2line against
+ *   the firmware ELF and prints samples per function
+ *   (default), per source line (--lines) or per source
+ *   file (--files: Wire, LiquidCrystal_I2C, Print, ...)
+ *
+ * Build:  g++ -O2 -o prof_symbolize tools/prof_symbolize.cpp
+ * Usage:  prof_symbolize --elf firmware.elf [--lines | --files]
+ *                        [--top N] [--addr2line CMD] < serial.log
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+static const size_t ADDR2LINE_BATCH = 256;   // addresses per addr2line run
+
+enum Grouping { BY_FUNCTION, BY_LINE, BY_FILE };
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s --elf FILE [--lines | --files] [--top N] [--addr2line CMD] < serial.log\n",
+          prog);
+  exit(2);
+}
+
+// Resolve one batch of PCs; two output lines per address
+static bool symbolize(const std::string& tool, const char* elf,
+                      const std::vector<uint32_t>& pcs, size_t first, size_t count,
+                      std::vector<std::string>& funcs, std::vector<std::string>& lines) {
+  std::string cmd = tool + " -f -C -e '" + elf + "'";
+  char addr[16];
+  for (size_t i = first; i < first + count; i++) {
+    snprintf(addr, sizeof(addr), " 0x%08x", pcs[i]);
+    cmd += addr;
+  }
+
+  FILE* p = popen(cmd.c_str(), "r");
+  if (!p) return false;
+  char func[1024], loc[1024];
+  for (size_t i = 0; i < count; i++) {
+    if (!fgets(func, sizeof(func), p) || !fgets(loc, sizeof(loc), p)) break;
+    func[strcspn(func, "\n")] = '\0';
+    loc[strcspn(loc, "\n")]   = '\0';
+    char* disc = strstr(loc, " (discriminator");
+    if (disc) *disc = '\0';
+    funcs.push_back(func);
+    lines.push_back(loc);
+  }
+  return pclose(p) == 0 && funcs.size() == first + count;
+}
+
+static std::string groupKey(Grouping g, const std::string& func, const std::string& loc) {
+  if (g == BY_FUNCTION) return func;
+  if (g == BY_LINE) return func + "  " + loc;
+  std::string file = loc.substr(0, loc.rfind(':'));
+  size_t slash = file.rfind('/');
+  return slash == std::string::npos ? file : file.substr(slash + 1);
+}
+
+int main(int argc, char** argv) {
+  const char* elf   = nullptr;
+  std::string tool  = "xtensa-esp32-elf-addr2line";
+  Grouping    group = BY_FUNCTION;
+  int         top   = 40;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--elf") == 0 && i + 1 < argc) {
+      elf = argv[++i];
+    } else if (strcmp(argv[i], "--addr2line") == 0 && i + 1 < argc) {
+      tool = argv[++i];
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--lines") == 0) {
+      group = BY_LINE;
+    } else if (strcmp(argv[i], "--files") == 0) {
+      group = BY_FILE;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (!elf || top < 1) usage(argv[0]);
+
+  // Samples per distinct PC
+  std::map<uint32_t, unsigned> perPc;
+  unsigned long total = 0, dropped = 0;
+  char line[1024];
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strncmp(line, "PF", 2) != 0) continue;
+    unsigned long n, d;
+    if (sscanf(line, "PF END %lu %lu", &n, &d) == 2) {
+      dropped += d;
+      continue;
+    }
+    char* s = line + 2;
+    char* end;
+    for (;;) {
+      unsigned long pc = strtoul(s, &end, 16);
+      if (end == s) break;
+      perPc[(uint32_t)pc]++;
+      total++;
+      s = end;
+    }
+  }
+  if (total == 0) {
+    fprintf(stderr, "no PF samples on stdin\n");
+    return 1;
+  }
+
+  std::vector<uint32_t> pcs;
+  for (const auto& e : perPc) pcs.push_back(e.first);
+
+  std::vector<std::string> funcs, locs;
+  for (size_t first = 0; first < pcs.size(); first += ADDR2LINE_BATCH) {
+    size_t count = pcs.size() - first < ADDR2LINE_BATCH ? pcs.size() - first : ADDR2LINE_BATCH;
+    if (!symbolize(tool, elf, pcs, first, count, funcs, locs)) {
+      fprintf(stderr, "%s failed on %s\n", tool.c_str(), elf);
+      return 1;
+    }
+  }
+
+  std::map<std::string, unsigned> perGroup;
+  for (size_t i = 0; i < pcs.size(); i++) {
+    perGroup[groupKey(group, funcs[i], locs[i])] += perPc[pcs[i]];
+  }
+
+  std::vector<std::pair<unsigned, std::string>> rows;
+  for (const auto& e : perGroup) rows.push_back({e.second, e.first});
+  std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+  });
+
+  printf("%lu samples, %zu distinct PCs, %lu dropped (buffer full)\n", total, pcs.size(),
+         dropped);
+  printf("%8s %6s  %s\n", "samples", "%", group == BY_FILE ? "file" : "function");
+  for (size_t i = 0; i < rows.size() && (int)i < top; i++) {
+    printf("%8u %5.1f%%  %s\n", rows[i].first, 100.0 * rows[i].first / total,
+           rows[i].second.c_str());
+  }
+  return 0;
+}
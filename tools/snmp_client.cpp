@@ -0,0 +1,324 @@
+/****************************************************
+ * SNMP v2c CLIENT (host tool)
+ * - Talks to the controller's agent (snmp.h) the way a
+ *   central system would: get / getnext / getbulk /
+ *   walk / set over UDP, printing one "name = value"
+ *   line per varbind (names from ntcip.h)
+ * - walk follows the subtree with GetBulk (or GetNext
+ *   with --next) until it leaves the OID given
+ *
+ * Build:  g++ -O2 -o snmp_client tools/snmp_client.cpp
+ * Usage:  snmp_client [--host IP] [--port N] [--community C] [--next]
+ *                     get OID... | next OID... | bulk N OID... |
+ *                     walk [OID] | set OID INT
+ *   Defaults: 127.0.0.1, port 161, community "public"
+ *   (controller_sim listens on 16160 + id)
+ ****************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../ntcip.h"
+
+static const int    TIMEOUT_MS = 1000;
+static const int    RETRIES    = 2;
+static const size_t MAX_REPLY  = 1500;
+
+struct Oid {
+  uint16_t arcs[SNMP_MAX_ARCS];
+  int      len;
+};
+
+static int         sock      = -1;
+static sockaddr_in agent;
+static const char* community = "public";
+static int32_t     requestId = 1;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [--host IP] [--port N] [--community C] [--next]\n"
+          "          get OID... | next OID... | bulk N OID... | walk [OID] | set OID INT\n",
+          prog);
+  exit(2);
+}
+
+static bool parseOid(const char* s, Oid& o) {
+  o.len = 0;
+  if (*s == '.') s++;
+  while (*s) {
+    char* end;
+    long  arc = strtol(s, &end, 10);
+    if (end == s || arc < 0 || arc > 65535 || o.len == SNMP_MAX_ARCS) return false;
+    o.arcs[o.len++] = (uint16_t)arc;
+    s = end;
+    if (*s == '.') s++;
+    else if (*s) return false;
+  }
+  return o.len >= 2;
+}
+
+// BER OID contents -> arcs; false if one does not fit 16 bits or too many
+static bool decodeOid(const uint8_t* p, size_t len, Oid& o) {
+  o.len = 0;
+  for (size_t i = 0; i < len;) {
+    uint32_t x = 0;
+    do {
+      x = x << 7 | (p[i] & 0x7F);
+    } while ((p[i++] & 0x80) && i < len);
+    if (o.len == SNMP_MAX_ARCS - (o.len == 0 ? 1 : 0)) return false;
+    if (o.len == 0) {
+      uint32_t top = x < 40 ? 0 : x < 80 ? 1 : 2;
+      o.arcs[o.len++] = (uint16_t)top;
+      x -= 40 * top;
+    }
+    if (x > 65535) return false;
+    o.arcs[o.len++] = (uint16_t)x;
+  }
+  return true;
+}
+
+static void formatOid(const Oid& o, char* out, size_t cap) {
+  size_t n = 0;
+  out[0] = '\0';
+  for (int i = 0; i < o.len && n < cap; i++) {
+    n += snprintf(out + n, cap - n, i ? ".%u" : "%u", o.arcs[i]);
+  }
+}
+
+static const char* nameOf(const Oid& o) {
+  for (const SnmpObject& obj : NTCIP_OBJECTS) {
+    if (obj.len == o.len && memcmp(obj.oid, o.arcs, o.len * sizeof(uint16_t)) == 0) {
+      return obj.name;
+    }
+  }
+  return nullptr;
+}
+
+static bool isUnder(const Oid& o, const Oid& root) {
+  return o.len > root.len && memcmp(o.arcs, root.arcs, root.len * sizeof(uint16_t)) == 0;
+}
+
+// request-id of a response message
+static bool responseId(const uint8_t* reply, size_t len, int32_t& id) {
+  const uint8_t* p   = reply;
+  const uint8_t* end = reply + len;
+  BerTlv         msg, ver, comm, pdu, rid;
+  if (!berRead(p, end, msg)) return false;
+  p   = msg.val;
+  end = msg.val + msg.len;
+  if (!berRead(p, end, ver) || !berRead(p, end, comm) || !berRead(p, end, pdu)) return false;
+  p = pdu.val;
+  return berRead(p, pdu.val + pdu.len, rid) && berInt(rid, id);
+}
+
+// One request / response exchange; the reply lands in 'reply'
+static ssize_t exchange(uint8_t pduType, int32_t e1, int32_t e2, const Oid* oids, int n,
+                        const int64_t* setValue, uint8_t* reply) {
+  uint8_t   msg[SNMP_MAX_MESSAGE];
+  BerWriter w = {msg, sizeof(msg), 0, false};
+  size_t    m = berOpen(w, BER_SEQUENCE);
+  berInteger(w, BER_INTEGER, SNMP_VERSION_2C);
+  berBytes(w, BER_OCTET_STRING, community, strlen(community));
+  size_t pdu = berOpen(w, pduType);
+  int32_t id = requestId++;
+  berInteger(w, BER_INTEGER, id);
+  berInteger(w, BER_INTEGER, e1);
+  berInteger(w, BER_INTEGER, e2);
+  size_t l = berOpen(w, BER_SEQUENCE);
+  for (int i = 0; i < n; i++) {
+    size_t vb = berOpen(w, BER_SEQUENCE);
+    berOid(w, oids[i].arcs, oids[i].len);
+    if (setValue) berInteger(w, BER_INTEGER, *setValue);
+    else          berBytes(w, BER_NULL, nullptr, 0);
+    berClose(w, vb);
+  }
+  berClose(w, l);
+  berClose(w, pdu);
+  berClose(w, m);
+  if (w.full) {
+    fprintf(stderr, "request too long\n");
+    return -1;
+  }
+
+  for (int attempt = 0; attempt <= RETRIES; attempt++) {
+    sendto(sock, msg, w.pos, 0, (sockaddr*)&agent, sizeof(agent));
+    pollfd pfd = {sock, POLLIN, 0};
+    while (poll(&pfd, 1, TIMEOUT_MS) > 0) {
+      ssize_t len = recv(sock, reply, MAX_REPLY, 0);
+      if (len <= 0) break;
+      int32_t got;
+      if (responseId(reply, (size_t)len, got) && got == id) return len;   // else stale
+    }
+  }
+  fprintf(stderr, "no response from %s:%u\n", inet_ntoa(agent.sin_addr), ntohs(agent.sin_port));
+  return -1;
+}
+
+// Prints the response; 'last' gets the final varbind's OID. Returns the
+// number of varbinds, -1 on a malformed reply. 'ended' = endOfMibView or
+// an OID outside 'root' seen (walks stop there).
+static int printResponse(const uint8_t* reply, size_t len, const Oid* root, Oid& last,
+                         bool& ended) {
+  const uint8_t* p   = reply;
+  const uint8_t* end = reply + len;
+  BerTlv         msg, ver, comm, pdu, rid, err, idx, vbl;
+  int32_t        errStatus, errIndex;
+  if (!berRead(p, end, msg)) return -1;
+  p   = msg.val;
+  end = msg.val + msg.len;
+  if (!berRead(p, end, ver) || !berRead(p, end, comm) || !berRead(p, end, pdu) ||
+      pdu.tag != SNMP_PDU_RESPONSE) {
+    return -1;
+  }
+  p   = pdu.val;
+  end = pdu.val + pdu.len;
+  if (!berRead(p, end, rid) || !berRead(p, end, err) || !berInt(err, errStatus) ||
+      !berRead(p, end, idx) || !berInt(idx, errIndex) || !berRead(p, end, vbl)) {
+    return -1;
+  }
+  if (errStatus != 0) printf("error-status %d index %d\n", errStatus, errIndex);
+
+  int count = 0;
+  ended     = false;
+  p   = vbl.val;
+  end = vbl.val + vbl.len;
+  while (p < end) {
+    BerTlv vb, oidTlv, val;
+    if (!berRead(p, end, vb)) return -1;
+    const uint8_t* q = vb.val;
+    if (!berRead(q, vb.val + vb.len, oidTlv) || !berRead(q, vb.val + vb.len, val)) return -1;
+    Oid o;
+    if (!decodeOid(oidTlv.val, oidTlv.len, o)) return -1;
+    count++;
+    last = o;
+    if (root && (!isUnder(o, *root) || val.tag == SNMP_END_OF_MIB_VIEW)) {
+      ended = true;
+      break;
+    }
+
+    char        text[96];
+    const char* name = nameOf(o);
+    formatOid(o, text, sizeof(text));
+    printf("%s", name ? name : text);
+
+    uint64_t u = val.tag == BER_INTEGER && val.len > 0 && (val.val[0] & 0x80) ? ~0ull : 0;
+    for (size_t i = 0; i < val.len; i++) u = u << 8 | val.val[i];
+    int64_t num = (int64_t)u;
+    switch (val.tag) {
+      case BER_INTEGER:    printf(" = INTEGER: %lld\n", (long long)num); break;
+      case SNMP_COUNTER32: printf(" = Counter32: %lld\n", (long long)num); break;
+      case SNMP_GAUGE32:   printf(" = Gauge32: %lld\n", (long long)num); break;
+      case SNMP_TIMETICKS:
+        printf(" = Timeticks: (%lld) %.2f s\n", (long long)num, num / 100.0);
+        break;
+      case BER_OCTET_STRING:
+        printf(" = STRING: \"%.*s\"\n", (int)val.len, val.val);
+        break;
+      case BER_NULL:              printf(" = NULL\n"); break;
+      case SNMP_NO_SUCH_OBJECT:   printf(" = No Such Object\n"); break;
+      case SNMP_NO_SUCH_INSTANCE: printf(" = No Such Instance\n"); break;
+      case SNMP_END_OF_MIB_VIEW:
+        printf(" = End of MIB View\n");
+        ended = true;
+        break;
+      default: printf(" = tag 0x%02X (%zu bytes)\n", val.tag, val.len); break;
+    }
+  }
+  return count;
+}
+
+int main(int argc, char** argv) {
+  const char* host    = "127.0.0.1";
+  int         port    = SNMP_PORT;
+  bool        useNext = false;
+  int         i       = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--community") == 0 && i + 1 < argc) {
+      community = argv[++i];
+    } else if (strcmp(argv[i], "--next") == 0) {
+      useNext = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (i >= argc) usage(argv[0]);
+  const char* cmd = argv[i++];
+
+  agent.sin_family = AF_INET;
+  agent.sin_port   = htons((uint16_t)port);
+  if (inet_pton(AF_INET, host, &agent.sin_addr) != 1) usage(argv[0]);
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    perror("socket");
+    return 1;
+  }
+
+  uint8_t reply[MAX_REPLY];
+  Oid     oids[SNMP_MAX_VARBINDS];
+  Oid     last;
+  bool    ended;
+  int     n = 0;
+
+  if (strcmp(cmd, "walk") == 0) {
+    Oid root;
+    if (!parseOid(i < argc ? argv[i] : "1.3.6.1", root)) usage(argv[0]);
+    Oid cur   = root;
+    int total = 0;
+    for (;;) {
+      ssize_t len = useNext ? exchange(SNMP_PDU_GETNEXT, 0, 0, &cur, 1, nullptr, reply)
+                            : exchange(SNMP_PDU_GETBULK, 0, 10, &cur, 1, nullptr, reply);
+      if (len < 0) return 1;
+      int got = printResponse(reply, (size_t)len, &root, last, ended);
+      if (got < 0) {
+        fprintf(stderr, "malformed response\n");
+        return 1;
+      }
+      total += got - (ended ? 1 : 0);
+      if (ended || got == 0) break;
+      cur = last;
+    }
+    fprintf(stderr, "%d objects\n", total);
+    return 0;
+  }
+
+  int32_t e1 = 0, e2 = 0;
+  uint8_t type;
+  int64_t setValue = 0;
+  if (strcmp(cmd, "get") == 0) {
+    type = SNMP_PDU_GET;
+  } else if (strcmp(cmd, "next") == 0) {
+    type = SNMP_PDU_GETNEXT;
+  } else if (strcmp(cmd, "bulk") == 0 && i < argc) {
+    type = SNMP_PDU_GETBULK;
+    e2   = atoi(argv[i++]);   // max-repetitions, no non-repeaters
+  } else if (strcmp(cmd, "set") == 0 && argc - i == 2) {
+    type     = SNMP_PDU_SET;
+    setValue = atoll(argv[argc - 1]);
+    argc--;
+  } else {
+    usage(argv[0]);
+  }
+  for (; i < argc; i++) {
+    if (n == SNMP_MAX_VARBINDS || !parseOid(argv[i], oids[n++])) usage(argv[0]);
+  }
+  if (n == 0) usage(argv[0]);
+
+  ssize_t len = exchange(type, e1, e2, oids, n, type == SNMP_PDU_SET ? &setValue : nullptr, reply);
+  if (len < 0) return 1;
+  if (printResponse(reply, (size_t)len, nullptr, last, ended) < 0) {
+    fprintf(stderr, "malformed response\n");
+    return 1;
+  }
+  close(sock);
+  return 0;
+}
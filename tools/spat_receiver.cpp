@@ -0,0 +1,121 @@
+/****************************************************
+ * SPaT HOST RECEIVER (host tool)
+ * - Listens for SPaT UDP broadcasts (spat.h)
+ * - Prints per-movement state and time-to-change
+ * - Reports message rate and lost msgCount values,
+ *   counted per intersection ID (one unit may send
+ *   several, and several units share the port)
+ *
+ * Build:  g++ -O2 -o spat_receiver tools/spat_receiver.cpp
+ * Usage:  spat_receiver [port]
+ ****************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../spat.h"
+
+// Last msgCount seen from each intersection ID, -1 = none yet
+static int8_t lastCount[1 << 16];
+
+static const char* stateName(uint8_t state) {
+  switch (state) {
+    case MPS_DARK:                return "DARK ";
+    case MPS_STOP_AND_REMAIN:     return "RED  ";
+    case MPS_PROTECTED_ALLOWED:   return "GREEN";
+    case MPS_PROTECTED_CLEARANCE: return "YELLO";
+    default:                      return "?    ";
+  }
+}
+
+static const char* groupName(uint8_t sg) {
+  switch (sg) {
+    case SG_NS_VEHICLE: return "NS";
+    case SG_EW_VEHICLE: return "EW";
+    case SG_PEDESTRIAN: return "PED";
+    default:            return "SG?";
+  }
+}
+
+static void printTime(uint16_t ds) {
+  if (ds == SPAT_TIME_UNKNOWN) {
+    printf("  ?  ");
+  } else {
+    printf("%5.1f", ds / 10.0);
+  }
+}
+
+int main(int argc, char** argv) {
+  int port = argc > 1 ? atoi(argv[1]) : SPAT_UDP_PORT;
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return 1;
+  }
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+
+  sockaddr_in addr = {};
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    return 1;
+  }
+
+  long received = 0, lost = 0, rejected = 0;
+  memset(lastCount, -1, sizeof(lastCount));
+  time_t windowStart = time(nullptr);
+  long   windowMsgs  = 0;
+
+  for (;;) {
+    uint8_t buf[256];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) continue;
+
+    SpatMessage m;
+    if (!spatDecode(buf, (size_t)n, m)) {
+      rejected++;
+      continue;
+    }
+    received++;
+    windowMsgs++;
+    int8_t& last = lastCount[m.intersectionId];
+    if (last >= 0) {
+      lost += (m.msgCount - last - 1 + 128) % 128;
+    }
+    last = (int8_t)m.msgCount;
+
+    printf("id=%u cnt=%3u t=%6.1f |", m.intersectionId, m.msgCount,
+           m.timestampDs / 10.0);
+    for (int i = 0; i < m.movementCount; i++) {
+      const SpatMovement& mv = m.movements[i];
+      printf(" %s %s ", groupName(mv.signalGroup), stateName(mv.state));
+      printTime(mv.minEndDs);
+      printf("..");
+      printTime(mv.maxEndDs);
+      printf(" ~");
+      printTime(mv.likelyDs);
+      printf(" |");
+    }
+    printf(" %zdB\n", n);
+
+    time_t now = time(nullptr);
+    if (now - windowStart >= 10) {
+      printf("-- %.1f msg/s, %ld received, %ld lost, %ld rejected\n",
+             windowMsgs / (double)(now - windowStart), received, lost, rejected);
+      windowStart = now;
+      windowMsgs  = 0;
+    }
+    fflush(stdout);
+  }
+}
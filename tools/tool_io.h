@@ -0,0 +1,66 @@
+/****************************************************
+ * HOST TOOL I/O HELPERS (header-only)
+ * - Hex as the firmware prints it on Serial ("UL",
+ *   "TR", "PLAN" lines): upper or lower case, two
+ *   digits per byte, no separators
+ * - Plan files as written from plan_compiler's output:
+ *   one line, "PLAN <hex>" or bare hex
+ ****************************************************/
+
+#ifndef TOOL_IO_H
+#define TOOL_IO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../phaseprog.h"
+
+// ============= HEX =============
+
+inline int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Bytes up to the first non-hex pair (or cap); returns the count
+inline size_t hexDecode(const char* s, uint8_t* out, size_t cap) {
+  size_t n = 0;
+  while (n < cap) {
+    int hi = hexNibble(s[0]);
+    int lo = hi < 0 ? -1 : hexNibble(s[1]);
+    if (lo < 0) break;
+    out[n++] = (uint8_t)((hi << 4) | lo);
+    s += 2;
+  }
+  return n;
+}
+
+// ============= PLAN FILES =============
+
+// Load and verify a plan from a file holding "PLAN <hex>" (or bare hex)
+inline bool readPlanFile(const char* path, PhasePlan& plan) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[8 + 2 * PLAN_MAX_BYTES + 8];
+  if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+  fclose(f);
+
+  const char* s = strncmp(line, "PLAN ", 5) == 0 ? line + 5 : line;
+  uint8_t image[PLAN_MAX_BYTES];
+  size_t  len = hexDecode(s, image, sizeof(image));
+
+  int err = planLoad(image, len, plan);
+  if (err != PLAN_OK) {
+    fprintf(stderr, "%s: rejected: %s\n", path, planErrorName(err));
+    return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,174 @@
+/****************************************************
+ * EVENT TRACE -> CHROME TRACE JSON (host tool)
+ * - Reads controller serial output on stdin and picks
+ *   up the "TR <hex>" dump lines (see tracebuf.h)
+ * - Writes Chrome trace JSON on stdout; open it in
+ *   ui.perfetto.dev or chrome://tracing
+ * - Track "loop": ticks, task resumes, button passes,
+ *   LCD I2C transfers, waits; track "phase" (then
+ *   "phase 1", ... with INTERSECTIONS > 1): one bar per
+ *   signal phase; counter "tick_late_us"
+ *
+ * Build:  g++ -O2 -o trace_export tools/trace_export.cpp
+ * Usage:  trace_export < serial.log > trace.json
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../tracebuf.h"
+#include "tool_io.h"
+
+// Slot order of the coroSpawn() calls in setup(); further slots are
+// the phase scripts of intersections 1, 2, ...
+static const char* TASK_NAMES[] = {
+  "phaseScript", "detectorTask", "networkTask", "housekeepingTask"
+};
+static const unsigned TASK_FIXED = sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0]);
+
+// Same order as the Phase enum in main.cpp
+static const char* PHASE_NAMES[] = {
+  "NS green", "NS yellow", "EW green", "EW yellow", "PED walk", "All red"
+};
+
+static const int TID_LOOP  = 1;
+static const int TID_PHASE = 2;   // + intersection index
+
+static const int MAX_UNITS = 16;
+
+static const char* spanName(const TraceRecord& r, char* buf, size_t cap) {
+  switch (r.id) {
+    case TRACE_ID_TICK:       return "tick";
+    case TRACE_ID_WAIT:       return "wait";
+    case TRACE_ID_BUTTONS:    return "readButtons";
+    case TRACE_ID_LCD_CLEAR:  return "lcd.clear";
+    case TRACE_ID_LCD_CURSOR: return "lcd.setCursor";
+    case TRACE_ID_LCD_WRITE:  return "lcd.write";
+    case TRACE_ID_I2C_PROBE:  return "i2c.probe";
+    case TRACE_ID_SPAT:       return "spatBroadcast";
+    case TRACE_ID_SERIAL:     return "serialCommand";
+    case TRACE_ID_TASK:
+      if (r.arg < TASK_FIXED) return TASK_NAMES[r.arg];
+      snprintf(buf, cap, "phaseScript%u", r.arg - TASK_FIXED + 1);
+      return buf;
+    default:
+      snprintf(buf, cap, "id %u", r.id);
+      return buf;
+  }
+}
+
+static bool first = true;
+
+static void emit(const char* fmt, double ts, int tid, const char* name, const char* extra) {
+  printf("%s\n  {\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.0f,\"pid\":1,\"tid\":%d%s}",
+         first ? "" : ",", name, fmt, ts, tid, extra);
+  first = false;
+}
+
+int main() {
+  TraceRecord* recs  = nullptr;
+  size_t       count = 0, cap = 0;
+
+  char line[1024];
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strncmp(line, "TR ", 3) != 0 || strncmp(line, "TR END", 6) == 0) continue;
+    const char* s = line + 3;
+    while (hexNibble(s[0]) >= 0) {
+      uint8_t raw[TRACE_RECORD_LEN];
+      size_t  n = hexDecode(s, raw, TRACE_RECORD_LEN);
+      s += 2 * n;
+      if (n < TRACE_RECORD_LEN) break;
+      if (count == cap) {
+        cap  = cap ? cap * 2 : 4096;
+        recs = (TraceRecord*)realloc(recs, cap * sizeof(TraceRecord));
+      }
+      traceDecode(raw, recs[count++]);
+    }
+  }
+  if (count == 0) {
+    fprintf(stderr, "no TR records on stdin\n");
+    return 1;
+  }
+
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  emit("M", 0, TID_LOOP, "thread_name", ",\"args\":{\"name\":\"loop\"}");
+
+  // Timestamps are 32-bit microseconds: unwrap, and start at zero
+  double   base  = recs[0].tsUs;
+  double   wraps = 0;
+  uint32_t prev  = recs[0].tsUs;
+
+  // The ring may start inside spans whose BEGIN was overwritten
+  const char* stack[64];
+  int         depth = 0;
+  int         phase[MAX_UNITS];
+  double      phaseStart[MAX_UNITS], ts = 0;
+  char        name[32], extra[64];
+  for (int u = 0; u < MAX_UNITS; u++) phase[u] = -1;
+
+  for (size_t i = 0; i < count; i++) {
+    const TraceRecord& r = recs[i];
+    if (r.tsUs < prev) wraps += 4294967296.0;
+    prev = r.tsUs;
+    ts   = r.tsUs + wraps - base;
+
+    switch (r.kind) {
+      case TRACE_BEGIN: {
+        const char* n = spanName(r, name, sizeof(name));
+        extra[0] = '\0';
+        if (r.id == TRACE_ID_LCD_WRITE && r.arg >= 0x20 && r.arg < 0x7F && r.arg != '"' &&
+            r.arg != '\\') {
+          snprintf(extra, sizeof(extra), ",\"args\":{\"char\":\"%c\"}", (char)r.arg);
+        }
+        emit("B", ts, TID_LOOP, n, extra);
+        if (depth < 64) stack[depth] = n;
+        depth++;
+        break;
+      }
+      case TRACE_END:
+        if (depth == 0) break;
+        depth--;
+        emit("E", ts, TID_LOOP, depth < 64 ? stack[depth] : "?", "");
+        break;
+      case TRACE_INSTANT:
+        if (r.id == TRACE_ID_PHASE) {
+          int u = (r.arg >> 8) % MAX_UNITS;   // intersection in the high byte
+          int p = r.arg & 0xFF;
+          if (phase[u] >= 0) {
+            snprintf(extra, sizeof(extra), ",\"dur\":%.0f", ts - phaseStart[u]);
+            emit("X", phaseStart[u], TID_PHASE + u, PHASE_NAMES[phase[u]], extra);
+          } else {
+            if (u == 0) snprintf(extra, sizeof(extra), ",\"args\":{\"name\":\"phase\"}");
+            else        snprintf(extra, sizeof(extra), ",\"args\":{\"name\":\"phase %d\"}", u);
+            emit("M", 0, TID_PHASE + u, "thread_name", extra);
+          }
+          phase[u]      = p < 6 ? p : 0;
+          phaseStart[u] = ts;
+        } else {
+          emit("i", ts, TID_LOOP, spanName(r, name, sizeof(name)), ",\"s\":\"t\"");
+        }
+        break;
+      case TRACE_COUNTER:
+        snprintf(extra, sizeof(extra), ",\"args\":{\"us\":%u}", r.arg);
+        emit("C", ts, TID_LOOP, "tick_late_us", extra);
+        break;
+    }
+  }
+
+  // Close whatever is still open at the end of the snapshot
+  for (int u = 0; u < MAX_UNITS; u++) {
+    if (phase[u] < 0) continue;
+    snprintf(extra, sizeof(extra), ",\"dur\":%.0f", ts - phaseStart[u]);
+    emit("X", phaseStart[u], TID_PHASE + u, PHASE_NAMES[phase[u]], extra);
+  }
+  while (depth > 0) {
+    depth--;
+    emit("E", ts, TID_LOOP, depth < 64 ? stack[depth] : "?", "");
+  }
+  printf("\n]}\n");
+
+  fprintf(stderr, "%zu records, %.3f s\n", count, ts / 1e6);
+  free(recs);
+  return 0;
+}
@@ -0,0 +1,103 @@
+/****************************************************
+ * LPWAN UPLINK STAND-IN GATEWAY (host tool)
+ * - Reads controller serial output on stdin
+ * - Decodes "UL <hex>" frames (FULL and DELTA); a
+ *   board running several intersections sends
+ *   "UL1 <hex>", ... for units 1 and up, each with its
+ *   own sequence and delta base
+ * - Writes "ACK <seq>" / "ACK1 <seq>" lines on stdout,
+ *   to be fed back to the controller's serial input
+ * - Prints decoded status and link usage on stderr
+ *
+ * Build:  g++ -O2 -o uplink_gateway tools/uplink_gateway.cpp
+ * Usage:  uplink_gateway [--drop N]   (drop every Nth ACK)
+ ****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../uplink.h"
+#include "tool_io.h"
+
+static const int MAX_UNITS = 10;   // one digit after "UL"
+
+static const char* PHASE_NAMES[] = {
+  "NS_GREEN", "NS_YELLOW", "EW_GREEN", "EW_YELLOW", "PED_GREEN", "ALL_RED"
+};
+
+int main(int argc, char** argv) {
+  int dropEvery = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--drop") == 0 && i + 1 < argc) {
+      dropEvery = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--drop N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  static UplinkStatus history[MAX_UNITS][UPLINK_SEQ_MOD];
+  static bool         haveHistory[MAX_UNITS][UPLINK_SEQ_MOD];
+
+  long frames = 0, bytes = 0, rejected = 0;
+  char line[256];
+
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strncmp(line, "UL", 2) != 0) continue;
+    const char* s    = line + 2;
+    int         unit = 0;
+    if (*s >= '0' && *s <= '9') unit = *s++ - '0';
+    if (*s != ' ') continue;
+
+    uint8_t frame[UPLINK_MAX_FRAME];
+    size_t  len = hexDecode(s + 1, frame, sizeof(frame));
+
+    bool    isDelta;
+    uint8_t seq, baseSeq;
+    if (!uplinkPeek(frame, len, isDelta, seq, baseSeq)) {
+      fprintf(stderr, "reject: unit %d bad CRC/header\n", unit);
+      rejected++;
+      continue;
+    }
+
+    const UplinkStatus* base = nullptr;
+    if (isDelta) {
+      if (!haveHistory[unit][baseSeq]) {
+        fprintf(stderr, "reject: unit %d seq %u delta on unknown base %u\n", unit, seq, baseSeq);
+        rejected++;
+        continue;
+      }
+      base = &history[unit][baseSeq];
+    }
+
+    UplinkStatus st;
+    if (!uplinkDecode(frame, len, base, st)) {
+      fprintf(stderr, "reject: unit %d seq %u truncated\n", unit, seq);
+      rejected++;
+      continue;
+    }
+
+    history[unit][seq]     = st;
+    haveHistory[unit][seq] = true;
+    frames++;
+    bytes += (long)len;
+
+    fprintf(stderr,
+            "unit=%d seq=%2u %-5s %2zuB phase=%s nsG=%u ewG=%u ped=%u "
+            "volNS=%u volEW=%u pedCalls=%u faults=0x%02X (avg %.1fB)\n",
+            unit, seq, isDelta ? "DELTA" : "FULL", len,
+            st.phase < 6 ? PHASE_NAMES[st.phase] : "?",
+            st.nsGreenSec, st.ewGreenSec, st.pedPending,
+            st.volNS, st.volEW, st.pedCalls, st.faults,
+            (double)bytes / (double)frames);
+
+    if (dropEvery > 0 && frames % dropEvery == 0) continue;
+    if (unit == 0) printf("ACK %u\n", seq);
+    else           printf("ACK%d %u\n", unit, seq);
+    fflush(stdout);
+  }
+
+  fprintf(stderr, "%ld frames, %ld bytes, %ld rejected\n", frames, bytes, rejected);
+  return 0;
+}
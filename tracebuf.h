@@ -0,0 +1,103 @@
+/****************************************************
+ * EVENT TRACE BUFFER
+ * - Fixed ring of 8-byte binary records (timestamp,
+ *   kind, id, arg); the newest records overwrite the
+ *   oldest, so a dump always holds the last few seconds
+ * - Recording is off until traceEnabled is set; when
+ *   off, a trace point costs one flag test
+ * - Dumped as "TR <hex>" lines; tools/trace_export
+ *   turns them into Chrome trace JSON (Perfetto,
+ *   chrome://tracing)
+ *
+ * Record (little-endian): u32 timestamp us, u8 kind,
+ * u8 id, u16 arg
+ ****************************************************/
+
+#ifndef TRACEBUF_H
+#define TRACEBUF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============= CONSTANTS =============
+
+const int    TRACE_CAPACITY   = 4096;   // records (32 KB)
+const size_t TRACE_RECORD_LEN = 8;
+
+// Kinds
+const uint8_t TRACE_BEGIN   = 0;   // span start
+const uint8_t TRACE_END     = 1;   // span end (matches the last BEGIN)
+const uint8_t TRACE_INSTANT = 2;
+const uint8_t TRACE_COUNTER = 3;   // arg is the value
+
+// Ids
+const uint8_t TRACE_ID_TICK       = 0;   // one scheduler pass
+const uint8_t TRACE_ID_WAIT       = 1;   // sleeping until the next tick
+const uint8_t TRACE_ID_TASK       = 2;   // task resume, arg = slot
+const uint8_t TRACE_ID_PHASE      = 3;   // phase start, arg = Phase
+const uint8_t TRACE_ID_BUTTONS    = 4;   // readButtons() pass
+const uint8_t TRACE_ID_LCD_CLEAR  = 5;   // I2C: clear command
+const uint8_t TRACE_ID_LCD_CURSOR = 6;   // I2C: set cursor
+const uint8_t TRACE_ID_LCD_WRITE  = 7;   // I2C: one character, arg = char
+const uint8_t TRACE_ID_I2C_PROBE  = 8;   // I2C: address probe
+const uint8_t TRACE_ID_TICK_LATE  = 9;   // counter: us behind the tick deadline
+const uint8_t TRACE_ID_SPAT       = 10;  // SPaT encode + send
+const uint8_t TRACE_ID_SERIAL     = 11;  // serial command handling
+
+// ============= BUFFER =============
+
+struct TraceRecord {
+  uint32_t tsUs;
+  uint8_t  kind;
+  uint8_t  id;
+  uint16_t arg;
+};
+
+inline TraceRecord traceRing[TRACE_CAPACITY];
+inline uint32_t    traceHead    = 0;      // records ever written
+inline bool        traceEnabled = false;
+
+inline void traceRecord(uint32_t tsUs, uint8_t kind, uint8_t id, uint16_t arg) {
+  if (!traceEnabled) return;
+  TraceRecord& r = traceRing[traceHead % TRACE_CAPACITY];
+  r.tsUs = tsUs;
+  r.kind = kind;
+  r.id   = id;
+  r.arg  = arg;
+  traceHead++;
+}
+
+inline void traceClear() {
+  traceHead = 0;
+}
+
+// Records held, oldest first: index 0 .. traceCount()-1
+inline uint32_t traceCount() {
+  return traceHead < (uint32_t)TRACE_CAPACITY ? traceHead : (uint32_t)TRACE_CAPACITY;
+}
+
+inline const TraceRecord& traceAt(uint32_t i) {
+  uint32_t first = traceHead - traceCount();
+  return traceRing[(first + i) % TRACE_CAPACITY];
+}
+
+inline void traceEncode(const TraceRecord& r, uint8_t out[TRACE_RECORD_LEN]) {
+  out[0] = (uint8_t)(r.tsUs);
+  out[1] = (uint8_t)(r.tsUs >> 8);
+  out[2] = (uint8_t)(r.tsUs >> 16);
+  out[3] = (uint8_t)(r.tsUs >> 24);
+  out[4] = r.kind;
+  out[5] = r.id;
+  out[6] = (uint8_t)(r.arg);
+  out[7] = (uint8_t)(r.arg >> 8);
+}
+
+inline void traceDecode(const uint8_t in[TRACE_RECORD_LEN], TraceRecord& r) {
+  r.tsUs = (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+  r.kind = in[4];
+  r.id   = in[5];
+  r.arg  = (uint16_t)(in[6] | (in[7] << 8));
+}
+
+#endif
@@ -0,0 +1,158 @@
+/****************************************************
+ * TIME-TO-CHANGE PREDICTOR
+ * - For every movement (NS, EW, pedestrian) estimates
+ *   when its displayed state will next change
+ * - Returns hard bounds [min, max] plus a likely value,
+ *   all in tenths of a second (TTC_UNKNOWN = unbounded)
+ * - Walks the ops of the active timing plan (phaseprog.h)
+ *   from the current one, until every movement has been
+ *   placed, so it is cheap enough for every poll
+ *
+ * Bounds follow from how main.cpp works:
+ *   - a green never changes length once started, except
+ *     where the caller says it may be cut (activeMinDs);
+ *     one still to come is at least greenMinSec, which
+ *     is base green when coordination may cut it
+ *   - a red approach's count only grows, so its green is
+ *     at least the policy value for today's count and at
+ *     most the policy maximum; once served, the count
+ *     restarts from zero (base green)
+ *   - a latched ped request is served at the next PED
+ *     op; an unlatched one may appear at any time
+ *   - every yellow is followed by the plan's all-red
+ *     (weather scaling, weather.h)
+ ****************************************************/
+
+#ifndef TTC_H
+#define TTC_H
+
+#include "phaseprog.h"
+
+// ============= CONSTANTS =============
+
+const long TTC_UNKNOWN = -1;
+
+// Indices into the estimate array (NS and EW match PLAN_APPROACH_*)
+const int TTC_NS  = 0;
+const int TTC_EW  = 1;
+const int TTC_PED = 2;
+
+// ============= INPUT / OUTPUT =============
+
+struct TtcInput {
+  const PhasePlan* plan;
+  int  pc;               // op being executed (a PED op only while walking)
+  long remainingDs;      // left in the current interval
+  bool allRed;           // in the all-red after the YELLOW op at pc
+  long activeMinDs;      // earliest it can end (< remainingDs if it may be cut)
+  int  greenNowSec[2];   // green for each approach's current count
+  int  greenMinSec[2];   // shortest it may run (< greenNowSec if it may be cut)
+  bool pedLatched;
+};
+
+struct TtcEstimate {
+  long minDs;
+  long likelyDs;
+  long maxDs;
+};
+
+// ============= PREDICTOR =============
+
+inline void ttcSet(TtcEstimate& e, long minDs, long likelyDs, long maxDs) {
+  e.minDs    = minDs;
+  e.likelyDs = likelyDs;
+  e.maxDs    = maxDs;
+}
+
+inline int ttcMovement(const PlanOp& op) {
+  return op.code == OP_PED ? TTC_PED : op.arg;
+}
+
+inline void ttcPredict(const TtcInput& in, TtcEstimate out[3]) {
+  const PhasePlan& p = *in.plan;
+  bool done[3]   = {false, false, false};
+  bool served[2] = {false, false};   // green already given in this walk
+
+  // The movement shown in the current interval changes when it ends
+  const PlanOp& cur = p.ops[in.pc];
+  long tMin = in.activeMinDs;
+  long tLik = in.remainingDs;
+  long tMax = in.remainingDs;
+
+  // In the all-red the yellowed movement is red already: its next
+  // change is a later green. A yellow still running has it to come.
+  int active = ttcMovement(cur);
+  if (!in.allRed) {
+    ttcSet(out[active], tMin, tLik, tMax);
+    done[active] = true;
+    if (cur.code == OP_YELLOW) {
+      tMin += p.allRedSec * 10L;
+      tLik += p.allRedSec * 10L;
+      tMax += p.allRedSec * 10L;
+    }
+  }
+  if (cur.code == OP_GREEN) served[cur.arg] = true;
+
+  // A running walk is followed by the STOP hold; the request is spent
+  bool pedPending = in.pedLatched;
+  if (active == TTC_PED) {
+    tMin += p.pedStopDs;
+    tLik += p.pedStopDs;
+    tMax += p.pedStopDs;
+    pedPending = false;
+  }
+
+  // Unlatched ped: earliest is the next PED op, latest is unbounded
+  bool pedMinSet = false;
+
+  // One pass through the loop visits every op that can ever run again
+  int pc    = in.pc;
+  int limit = p.opCount + 1;
+  for (int k = 0; k < limit && !(done[0] && done[1] && done[2]); k++) {
+    pc = planNextPc(p, pc);
+    const PlanOp& op = p.ops[pc];
+
+    if (op.code == OP_GREEN) {
+      int mv = op.arg;
+      if (!done[mv]) {
+        ttcSet(out[mv], tMin, tLik, tMax);
+        done[mv] = true;
+      }
+      int nowSec = served[mv] ? p.approaches[mv].baseSec : in.greenNowSec[mv];
+      int minSec = served[mv] ? p.approaches[mv].baseSec : in.greenMinSec[mv];
+      tMin += minSec * 10L;
+      tLik += nowSec * 10L;
+      tMax += planMaxGreenSeconds(p, mv) * 10L;
+      served[mv] = true;
+    } else if (op.code == OP_YELLOW) {
+      long clearDs = (p.yellowSec + p.allRedSec) * 10L;
+      tMin += clearDs;
+      tLik += clearDs;
+      tMax += clearDs;
+    } else {
+      long pedDs = p.pedSec * 10L + p.pedStopDs;
+      if (!done[TTC_PED]) {
+        if (pedPending) {
+          ttcSet(out[TTC_PED], tMin, tLik, tMax);
+          done[TTC_PED] = true;
+        } else if (!pedMinSet) {
+          ttcSet(out[TTC_PED], tMin, TTC_UNKNOWN, TTC_UNKNOWN);
+          pedMinSet = true;
+        }
+      }
+      // A request may be pressed before any later PED op, so max always pays
+      if (pedPending) {
+        tMin += pedDs;
+        tLik += pedDs;
+        pedPending = false;
+      }
+      tMax += pedDs;
+    }
+  }
+
+  if (!done[TTC_PED] && !pedMinSet) {
+    ttcSet(out[TTC_PED], TTC_UNKNOWN, TTC_UNKNOWN, TTC_UNKNOWN);
+  }
+}
+
+#endif
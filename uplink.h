@@ -0,0 +1,166 @@
+/****************************************************
+ * LPWAN UPLINK STATUS MESSAGE
+ * - Compact status/summary for LoRa-class links
+ * - FULL frame: every field at fixed width
+ * - DELTA frame: only changes vs. the last state the
+ *   gateway acknowledged (identified by its seq)
+ * - Trailing CRC-8 byte
+ *
+ * Frame layout (MSB first):
+ *   type(1) seq(6) [baseSeq(6) if DELTA] fields... crc8
+ *
+ * FULL fields:
+ *   phase(3) nsGreen(6) ewGreen(6) ped(1)
+ *   volNS(16) volEW(16) pedCalls(16) faults(8)
+ *
+ * DELTA fields:
+ *   changed(1)+phase(3), changed(1)+nsGreen(6),
+ *   changed(1)+ewGreen(6), ped(1),
+ *   var(volNS diff), var(volEW diff), var(pedCalls diff),
+ *   changed(1)+faults(8)
+ *   (volume diffs are modulo 65536, Exp-Golomb coded)
+ ****************************************************/
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include "bitpack.h"
+
+// ============= CONSTANTS =============
+
+const int UPLINK_TYPE_FULL  = 0;
+const int UPLINK_TYPE_DELTA = 1;
+
+const int UPLINK_SEQ_MOD    = 64;    // seq is 6 bits
+const int UPLINK_MAX_FRAME  = 16;    // worst-case FULL frame is 11 bytes
+
+// Fault bits
+const uint8_t FAULT_LCD_NACK      = 0x01;   // LCD did not ACK on I2C at startup
+const uint8_t FAULT_NS_BTN_STUCK  = 0x02;   // NS detector held low too long
+const uint8_t FAULT_EW_BTN_STUCK  = 0x04;   // EW detector held low too long
+const uint8_t FAULT_PED_BTN_STUCK = 0x08;   // Ped button held low too long
+const uint8_t FAULT_CORO_POOL     = 0x10;   // a coroutine frame did not fit the pool
+const uint8_t FAULT_HEAP_ALLOC    = 0x20;   // the loop allocated after setup()
+const uint8_t FAULT_SIGNAL_OUT    = 0x40;   // signal output backend rejected a frame
+const uint8_t FAULT_DETECTOR_IN   = 0x80;   // detector input backend did not answer
+
+// ============= STATUS RECORD =============
+
+struct UplinkStatus {
+  uint8_t  phase;        // Phase enum value
+  uint8_t  nsGreenSec;   // planned NS green (from current demand)
+  uint8_t  ewGreenSec;   // planned EW green (from current demand)
+  uint8_t  pedPending;   // 1 if a pedestrian request is latched
+  uint16_t volNS;        // cumulative NS vehicles served (wraps)
+  uint16_t volEW;        // cumulative EW vehicles served (wraps)
+  uint16_t pedCalls;     // cumulative pedestrian phases served (wraps)
+  uint8_t  faults;       // FAULT_* bits
+};
+
+// ============= ENCODER =============
+
+// Encode 'cur' into out[]. If base is non-null a DELTA frame against
+// base (acknowledged as baseSeq) is produced, otherwise a FULL frame.
+// Returns frame length in bytes (0 if it did not fit).
+inline size_t uplinkEncode(const UplinkStatus& cur, const UplinkStatus* base,
+                           uint8_t seq, uint8_t baseSeq,
+                           uint8_t* out, size_t cap) {
+  BitWriter w;
+  bitsBegin(w, out, cap);
+
+  if (base == nullptr) {
+    bitsPut(w, UPLINK_TYPE_FULL, 1);
+    bitsPut(w, seq, 6);
+    bitsPut(w, cur.phase, 3);
+    bitsPut(w, cur.nsGreenSec, 6);
+    bitsPut(w, cur.ewGreenSec, 6);
+    bitsPut(w, cur.pedPending, 1);
+    bitsPut(w, cur.volNS, 16);
+    bitsPut(w, cur.volEW, 16);
+    bitsPut(w, cur.pedCalls, 16);
+    bitsPut(w, cur.faults, 8);
+  } else {
+    bitsPut(w, UPLINK_TYPE_DELTA, 1);
+    bitsPut(w, seq, 6);
+    bitsPut(w, baseSeq, 6);
+
+    bitsPut(w, cur.phase != base->phase, 1);
+    if (cur.phase != base->phase) bitsPut(w, cur.phase, 3);
+
+    bitsPut(w, cur.nsGreenSec != base->nsGreenSec, 1);
+    if (cur.nsGreenSec != base->nsGreenSec) bitsPut(w, cur.nsGreenSec, 6);
+
+    bitsPut(w, cur.ewGreenSec != base->ewGreenSec, 1);
+    if (cur.ewGreenSec != base->ewGreenSec) bitsPut(w, cur.ewGreenSec, 6);
+
+    bitsPut(w, cur.pedPending, 1);
+
+    bitsPutVar(w, (uint16_t)(cur.volNS - base->volNS));
+    bitsPutVar(w, (uint16_t)(cur.volEW - base->volEW));
+    bitsPutVar(w, (uint16_t)(cur.pedCalls - base->pedCalls));
+
+    bitsPut(w, cur.faults != base->faults, 1);
+    if (cur.faults != base->faults) bitsPut(w, cur.faults, 8);
+  }
+
+  // Pad to a byte boundary, then append CRC over the packed bytes
+  size_t n = bitsBytes(w);
+  bitsPut(w, 0, (int)(n * 8 - w.bitPos));
+  if (w.overflow || n + 1 > cap) return 0;
+  out[n] = crc8(out, n);
+  return n + 1;
+}
+
+// ============= DECODER =============
+
+// Check CRC and read the frame header.
+inline bool uplinkPeek(const uint8_t* in, size_t len,
+                       bool& isDelta, uint8_t& seq, uint8_t& baseSeq) {
+  if (len < 2 || crc8(in, len - 1) != in[len - 1]) return false;
+
+  BitReader r;
+  bitsBeginRead(r, in, len - 1);
+  isDelta = bitsGet(r, 1) == UPLINK_TYPE_DELTA;
+  seq     = (uint8_t)bitsGet(r, 6);
+  baseSeq = isDelta ? (uint8_t)bitsGet(r, 6) : 0;
+  return !r.underflow;
+}
+
+// Decode a frame already accepted by uplinkPeek(). DELTA frames need
+// the state the gateway stored for baseSeq.
+inline bool uplinkDecode(const uint8_t* in, size_t len,
+                         const UplinkStatus* base, UplinkStatus& out) {
+  BitReader r;
+  bitsBeginRead(r, in, len - 1);
+
+  bool isDelta = bitsGet(r, 1) == UPLINK_TYPE_DELTA;
+  bitsGet(r, 6);   // seq
+
+  if (!isDelta) {
+    out.phase      = (uint8_t)bitsGet(r, 3);
+    out.nsGreenSec = (uint8_t)bitsGet(r, 6);
+    out.ewGreenSec = (uint8_t)bitsGet(r, 6);
+    out.pedPending = (uint8_t)bitsGet(r, 1);
+    out.volNS      = (uint16_t)bitsGet(r, 16);
+    out.volEW      = (uint16_t)bitsGet(r, 16);
+    out.pedCalls   = (uint16_t)bitsGet(r, 16);
+    out.faults     = (uint8_t)bitsGet(r, 8);
+    return !r.underflow;
+  }
+
+  if (base == nullptr) return false;
+  bitsGet(r, 6);   // baseSeq
+
+  out = *base;
+  if (bitsGet(r, 1)) out.phase      = (uint8_t)bitsGet(r, 3);
+  if (bitsGet(r, 1)) out.nsGreenSec = (uint8_t)bitsGet(r, 6);
+  if (bitsGet(r, 1)) out.ewGreenSec = (uint8_t)bitsGet(r, 6);
+  out.pedPending = (uint8_t)bitsGet(r, 1);
+  out.volNS    = (uint16_t)(base->volNS + bitsGetVar(r));
+  out.volEW    = (uint16_t)(base->volEW + bitsGetVar(r));
+  out.pedCalls = (uint16_t)(base->pedCalls + bitsGetVar(r));
+  if (bitsGet(r, 1)) out.faults = (uint8_t)bitsGet(r, 8);
+  return !r.underflow;
+}
+
+#endif
@@ -0,0 +1,81 @@
+/****************************************************
+ * WEATHER-RESPONSIVE TIMING
+ * - Road surface state from a wet / ice sensor (or a
+ *   stand-in feed over Serial) selects a profile that
+ *   scales the running timing plan:
+ *     yellow     longer stopping distance on a wet or
+ *                icy road
+ *     all-red    red clearance after every yellow, for
+ *                vehicles sliding through the stop line
+ *     saturation fewer vehicles discharge per second of
+ *                green, so each green policy value
+ *                (base and count steps) is stretched by
+ *                100 / satFlowPct
+ * - Plans are written for dry pavement: dry runs the
+ *   plan as uploaded, so it need not carry a
+ *   worst-case margin
+ * - Scaled values stay within the plan verifier's
+ *   ranges (phaseprog.h); rounding is always upward
+ ****************************************************/
+
+#ifndef WEATHER_H
+#define WEATHER_H
+
+#include <stdint.h>
+
+#include "phaseprog.h"
+
+// ============= PROFILES =============
+
+enum WeatherLevel : uint8_t {
+  WEATHER_DRY,
+  WEATHER_WET,
+  WEATHER_ICE
+};
+
+const int WEATHER_LEVELS = 3;
+
+struct WeatherProfile {
+  const char* name;
+  uint8_t     yellowPct;    // yellow, % of the plan's
+  uint8_t     allRedSec;    // after every yellow
+  uint8_t     satFlowPct;   // saturation flow, % of dry
+};
+
+const WeatherProfile WEATHER_PROFILES[WEATHER_LEVELS] = {
+  {"dry", 100, 0, 100},
+  {"wet", 125, 1,  90},
+  {"ice", 150, 2,  75},
+};
+
+// ============= SCALING =============
+
+inline int weatherCeilPct(int value, int num, int den) {
+  return (value * num + den - 1) / den;
+}
+
+// 'out' = 'plan' timed for 'level'; the op sequence is unchanged, so
+// a plan counter into one is valid in the other
+inline void weatherScalePlan(const PhasePlan& plan, WeatherLevel level, PhasePlan& out) {
+  const WeatherProfile& w = WEATHER_PROFILES[level];
+  out = plan;
+
+  int yellow = weatherCeilPct(plan.yellowSec, w.yellowPct, 100);
+  out.yellowSec = (uint8_t)(yellow < PLAN_MAX_YELLOW_SEC ? yellow : PLAN_MAX_YELLOW_SEC);
+  out.allRedSec = w.allRedSec;
+
+  for (int a = 0; a < PLAN_APPROACHES; a++) {
+    const PlanApproach& src = plan.approaches[a];
+    PlanApproach&       dst = out.approaches[a];
+    int base = weatherCeilPct(src.baseSec, 100, w.satFlowPct);
+    if (base > PLAN_MAX_GREEN_SEC) base = PLAN_MAX_GREEN_SEC;
+    dst.baseSec = (uint8_t)base;
+    for (int i = 0; i < src.stepCount; i++) {
+      int extra = weatherCeilPct(src.steps[i].extraSec, 100, w.satFlowPct);
+      if (base + extra > PLAN_MAX_GREEN_SEC) extra = PLAN_MAX_GREEN_SEC - base;
+      dst.steps[i].extraSec = (uint8_t)extra;
+    }
+  }
+}
+
+#endif